@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * ConstraintTable.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef CONSTRAINTTABLE_H_
+#define CONSTRAINTTABLE_H_
+
+#include "AbstractConstraintFunction.h"
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Values of a constraint function of the vessel level precomputed for the first LEVELS levels, so the hot loops
+ * read them from a flat array instead of calling the virtual AbstractConstraintFunction::getValue. Levels out of
+ * the table are evaluated by the function. The table must be compiled again if the function changes.
+ */
+template <class T> class ConstraintTable {
+	/**	Value of the function at each level. */
+	vector<T> values;
+	/**	Compiled function. */
+	AbstractConstraintFunction<T,int> *function;
+public:
+	/**	Amount of levels precomputed. */
+	static const int LEVELS = 256;
+
+	/**
+	 * Constructor of an empty table.
+	 */
+	ConstraintTable();
+	/**
+	 * Precomputes the values of @p function for the levels 0 to LEVELS - 1.
+	 * @param function	Constraint function of the vessel level (NULL empties the table).
+	 */
+	void compile(AbstractConstraintFunction<T,int> *function);
+	/**
+	 * Returns the value of the function at @p level.
+	 * @param level	Vessel level.
+	 * @return	Constraint function value.
+	 */
+	T getValue(int level) const {
+		if ((unsigned int) level < values.size()) {
+			return values[level];
+		}
+		return function->getValue(level);
+	}
+};
+
+template <class T>
+ConstraintTable<T>::ConstraintTable() {
+	this->function = NULL;
+}
+
+template <class T>
+void ConstraintTable<T>::compile(AbstractConstraintFunction<T,int> *function) {
+	this->function = function;
+	values.clear();
+	if (!function) {
+		return;
+	}
+	values.resize(LEVELS);
+	for (int i = 0; i < LEVELS; ++i) {
+		values[i] = function->getValue(i);
+	}
+}
+
+#endif /* CONSTRAINTTABLE_H_ */
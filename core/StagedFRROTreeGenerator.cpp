@@ -9,16 +9,23 @@
 
 #include "StagedFRROTreeGenerator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <cmath>
 #include <fstream>
+#include <sstream>
 #include<unordered_set>
 
 #include "../io/VTKObjectTreeElementalWriter.h"
 #include "../io/VTKObjectTreeSplinesNodalWriter.h"
+#include "../io/task/JournalCheckpointSavingTask.h"
 
 #include "../structures/CCOCommonStructures.h"
+#include "../structures/tree/SegmentAABBTree.h"
 #include "../structures/tree/SingleVesselCCOOTree.h"
 #include "../structures/vascularElements/AbstractVascularElement.h"
+#include "../structures/vascularElements/VesselPool.h"
 #include "../utils/MemoryMonitor.h"
 
 #include <omp.h>
@@ -49,6 +56,14 @@ StagedFRROTreeGenerator::StagedFRROTreeGenerator(
 
 	this->isGeneratingConfFile = 0;
 	this->confFilename = "";
+	this->speculativeDraws = 1;
+	this->batchSize = 1;
+	this->isCandidatePruning = 0;
+	this->candidates = 0;
+	this->prunedCandidates = 0;
+	this->savingQueueSize = 0;
+	this->savingQueue = NULL;
+	this->journalFilename = "";
 
 	this->dataMonitor = new GeneratorDataMonitor(domain);
 	this->monitor = new MemoryMonitor(MemoryMonitor::MEGABYTE);
@@ -80,6 +95,14 @@ StagedFRROTreeGenerator::StagedFRROTreeGenerator(
 
 	this->isGeneratingConfFile = 0;
 	this->confFilename = "";
+	this->speculativeDraws = 1;
+	this->batchSize = 1;
+	this->isCandidatePruning = 0;
+	this->candidates = 0;
+	this->prunedCandidates = 0;
+	this->savingQueueSize = 0;
+	this->savingQueue = NULL;
+	this->journalFilename = "";
 
 	this->dataMonitor = new GeneratorDataMonitor(domain);
 	this->monitor = new MemoryMonitor(MemoryMonitor::MEGABYTE);
@@ -90,6 +113,8 @@ StagedFRROTreeGenerator::StagedFRROTreeGenerator(
 StagedFRROTreeGenerator::~StagedFRROTreeGenerator() {
 	delete this->dataMonitor;
 	delete this->monitor;
+	//	Finishes the pending saves before the tree is deleted
+	delete this->savingQueue;
 	if (didAllocateTree) {
 		delete this->tree;
 	}
@@ -110,7 +135,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generate(long long int saveInter
 		xNew = domain->getRandomPoint();
 	} while (!isValidRootSegment(xNew, ++i));
 
-	tree->addVessel(xNew, xNew, NULL, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+	insertVessel(xNew, xNew, NULL);
 
 	for (long long i = 1; i < nTerminals; i = tree->getNTerms()) {
 
@@ -120,42 +145,28 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generate(long long int saveInter
 			saveStatus(i);
 		}
 
+		//	Batches end at the save points and at the stage changes
+		if (batchSize > 1) {
+			long long int nBatch = min((long long int) batchSize, nTerminals - i);
+			nBatch = min(nBatch, saveInterval - i % saveInterval);
+			nBatch = min(nBatch, domain->getStageRemainingTerminals());
+			addTerminalBatch(i, max(1LL, nBatch));
+			continue;
+		}
+
 		int invalidTerminal = true;
 		int iTry = 0;
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
-			}
-			//	end for trees
+			AbstractVascularElement *minParent;
+			drawTerminal(i, &iTry, INT_MAX, NULL, &xNew, &minCost, &minBif, &minParent);
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << endl;
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+				insertVessel(minBif, xNew, minParent);
 				invalidTerminal = false;
 			}
 		}
@@ -171,6 +182,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generate(long long int saveInter
 	this->dLimLast = this->dLim;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
 
@@ -192,7 +204,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generateExperimental(long long i
 		xNew = domain->getRandomPoint();
 	} while (!isValidRootSegment(xNew, ++i));
 
-	tree->addVessel(xNew, xNew, NULL, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+	insertVessel(xNew, xNew, NULL);
 
 	for (long long i = 1; i < nTerminals; i = tree->getNTerms()) {
 
@@ -207,40 +219,16 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generateExperimental(long long i
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-			if (iTry > maxNumOfTrials) {
-				return NULL;
-			}
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
+			AbstractVascularElement *minParent;
+			if (drawTerminal(i, &iTry, maxNumOfTrials, NULL, &xNew, &minCost, &minBif, &minParent)) {
+				return NULL;
 			}
-			//	end for trees
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << endl;
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+				insertVessel(minBif, xNew, minParent);
 				invalidTerminal = false;
 			}
 		}
@@ -256,6 +244,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::generateExperimental(long long i
 	this->dLimLast = this->dLim;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
 
@@ -291,6 +280,355 @@ int StagedFRROTreeGenerator::isValidSegment(point xNew, int iTry) {
 	return dist > dLim;
 }
 
+int StagedFRROTreeGenerator::drawTerminal(long long int i, int *iTry, int maxNumOfTrials, unordered_map<string, pair<SingleVessel *, bool>> *originals,
+		point *xNew, double *minCost, point *minBif, AbstractVascularElement **minParent) {
+
+	int nDraws = max(1, speculativeDraws);
+	vector<point> xNews;
+	vector<vector<AbstractVascularElement *>> parentVessels;
+	vector<vector<AbstractVascularElement *>> neighborVessels;
+	vector<double> dLims;
+	vector<int> iTries;
+	//	Every point taken from the domain and the amount taken up to each draw, to give back those after the added draw
+	vector<point> takenPoints;
+	vector<int> nTakenPoints;
+	int isExhausted = 0;
+	for (int k = 0; k < nDraws; ++k) {
+		point xDraw;
+		do {
+			xDraw = domain->getRandomPoint();
+			takenPoints.push_back(xDraw);
+		} while (!isValidSegment(xDraw, ++(*iTry)));
+		if (*iTry > maxNumOfTrials) {
+			isExhausted = 1;
+			break;
+		}
+
+		int nNeighbors;
+		neighborVessels.push_back(tree->getCloseSegments(xDraw, domain, &nNeighbors));
+		cout << "Trying segment #" << i << " at terminal point " << xDraw << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
+
+		vector<AbstractVascularElement *> &neighbors = neighborVessels.back();
+		parentVessels.push_back(vector<AbstractVascularElement *>());
+		for (unsigned j = 0; j < neighbors.size(); ++j) {
+			if (originals) {
+				auto ogIt = originals->find(static_cast<SingleVessel *>(neighbors[j])->coordToString());
+				if (ogIt != originals->end() && (*ogIt).second.second == false) {
+					continue;
+				}
+			}
+			parentVessels.back().push_back(neighbors[j]);
+		}
+
+		xNews.push_back(xDraw);
+		dLims.push_back(dLim);
+		iTries.push_back(*iTry);
+		nTakenPoints.push_back(takenPoints.size());
+	}
+
+	*minCost = INFINITY;
+	*minBif = {INFINITY, INFINITY, INFINITY};
+	*minParent = NULL;
+	if (xNews.empty()) {
+		return isExhausted;
+	}
+
+	vector<double> minCosts;
+	vector<point> minBifs;
+	vector<AbstractVascularElement *> minParents;
+	findBestBifurcation(xNews, parentVessels, neighborVessels, dLims, 1, &minCosts, &minBifs, &minParents);
+	int bestDraw = 0;
+	while (bestDraw < (int) xNews.size() - 1 && minCosts[bestDraw] == INFINITY) {
+		++bestDraw;
+	}
+	*xNew = xNews[bestDraw];
+	*minCost = minCosts[bestDraw];
+	*minBif = minBifs[bestDraw];
+	*minParent = minParents[bestDraw];
+	if (*minCost == INFINITY) {
+		return isExhausted;
+	}
+
+	//	Undo the draws after the added one, as if they were never performed
+	int nDiscarded = (int) xNews.size() - 1 - bestDraw;
+	if (nDiscarded > 0 || isExhausted) {
+		for (int j = (int) takenPoints.size() - 1; j >= nTakenPoints[bestDraw]; --j) {
+			domain->returnRandomPoint(takenPoints[j]);
+		}
+		*iTry = iTries[bestDraw];
+		dLim = dLims[bestDraw];
+		cout << "Discarded " << nDiscarded << " speculative draws." << endl;
+	}
+	return 0;
+}
+
+void StagedFRROTreeGenerator::addTerminalBatch(long long int i, long long int nBatch) {
+
+	vector<point> xNews;
+	vector<vector<AbstractVascularElement *>> neighborVessels;
+	vector<double> dLims;
+	vector<double *> boxes;
+	//	Every point taken from the domain and the amount taken before each draw, to give back those of discarded draws
+	vector<point> takenPoints;
+	vector<int> nTakenPoints;
+	vector<double> minCosts;
+	vector<point> minBifs;
+	vector<AbstractVascularElement *> minParents;
+	vector<int> accepted;
+	int iTry = 0;
+
+	dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
+	while (accepted.empty()) {
+
+		//	Draws whose neighborhoods do not overlap and do not share close segments
+		unordered_set<AbstractVascularElement *> batchNeighbors;
+		for (long long int k = 0; k < nBatch; ++k) {
+			int nTaken = takenPoints.size();
+			int drawTry = 0;
+			if (k == 0) {
+				drawTry = iTry;
+			} else {
+				//	The batch stops at the first draw that is not added, so draw k is added as the terminal getNTerms() + k
+				dLim = instanceData->dLimCorrectionFactor * domain->getDLim(tree->getNTerms() + k, instanceData->perfusionAreaFactor);
+			}
+			point xDraw;
+			do {
+				xDraw = domain->getRandomPoint();
+				takenPoints.push_back(xDraw);
+			} while (!isValidSegment(xDraw, ++drawTry));
+
+			int nNeighbors;
+			vector<AbstractVascularElement *> neighbors = tree->getCloseSegments(xDraw, domain, &nNeighbors);
+			double *box = tree->getCloseNeighborhood(xDraw, domain);
+			int isIndependent = 1;
+			for (unsigned j = 0; j < boxes.size() && isIndependent; ++j) {
+				isIndependent = !SegmentAABBTree::overlaps(box, boxes[j]);
+			}
+			for (unsigned j = 0; j < neighbors.size() && isIndependent; ++j) {
+				isIndependent = !batchNeighbors.count(neighbors[j]);
+			}
+			if (!isIndependent) {
+				for (int j = (int) takenPoints.size() - 1; j >= nTaken; --j) {
+					domain->returnRandomPoint(takenPoints[j]);
+				}
+				takenPoints.resize(nTaken);
+				dLim = dLims.back();
+				delete[] box;
+				break;
+			}
+
+			cout << "Trying segment #" << i + k << " at terminal point " << xDraw << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
+			if (k == 0) {
+				iTry = drawTry;
+			}
+			batchNeighbors.insert(neighbors.begin(), neighbors.end());
+			xNews.push_back(xDraw);
+			neighborVessels.push_back(neighbors);
+			dLims.push_back(dLim);
+			boxes.push_back(box);
+			nTakenPoints.push_back(nTaken);
+		}
+
+		findBestBifurcation(xNews, neighborVessels, neighborVessels, dLims, 0, &minCosts, &minBifs, &minParents);
+
+		//	Terminals are added in draw order while their new vessels are independent of the previous ones
+		unordered_set<AbstractVascularElement *> batchPaths;
+		int nDrawn = xNews.size();
+		int nKept = nDrawn;
+		for (int k = 0; k < nDrawn; ++k) {
+			//	Draws that can not be connected are consumed as in the sequential algorithm. The next ones are drawn
+			//	again, since their dLim was taken for one more terminal than the tree will have.
+			if (minCosts[k] == INFINITY) {
+				nKept = k + 1;
+				break;
+			}
+			//	The neighborhood is extended to enclose the new vessel
+			double *box = boxes[k];
+			for (int j = 0; j < 3; ++j) {
+				box[2 * j] = min(box[2 * j], minBifs[k].p[j]);
+				box[2 * j + 1] = max(box[2 * j + 1], minBifs[k].p[j]);
+			}
+			int isIndependent = !batchPaths.count(minParents[k]);
+			for (unsigned j = 0; j < accepted.size() && isIndependent; ++j) {
+				int other = accepted[j];
+				point closest;
+				isIndependent = !SegmentAABBTree::overlaps(box, boxes[other])
+						&& SegmentAABBTree::segmentDistance2(minBifs[other], xNews[other], xNews[k], &closest) > dLims[k] * dLims[k];
+			}
+			for (AbstractVascularElement *ancestor = minParents[k]; ancestor && isIndependent; ancestor = ancestor->parent) {
+				for (unsigned j = 0; j < accepted.size() && isIndependent; ++j) {
+					isIndependent = minParents[accepted[j]] != ancestor;
+				}
+			}
+			if (!isIndependent) {
+				nKept = k;
+				break;
+			}
+			for (AbstractVascularElement *ancestor = minParents[k]; ancestor; ancestor = ancestor->parent) {
+				batchPaths.insert(ancestor);
+			}
+			accepted.push_back(k);
+		}
+
+		//	Draws from the first dependent one on are given back, so they are drawn again against the updated tree
+		int nReturned = nKept < nDrawn ? nTakenPoints[nKept] : takenPoints.size();
+		for (int j = (int) takenPoints.size() - 1; j >= nReturned; --j) {
+			domain->returnRandomPoint(takenPoints[j]);
+		}
+		//	dLim continues from the last accepted draw, as the draws after it are performed again
+		dLim = accepted.empty() ? dLims[0] : dLims[accepted.back()];
+		if (accepted.empty()) {
+			for (unsigned k = 0; k < boxes.size(); ++k) {
+				delete[] boxes[k];
+			}
+			xNews.clear();
+			neighborVessels.clear();
+			dLims.clear();
+			boxes.clear();
+			takenPoints.clear();
+			nTakenPoints.clear();
+		}
+	}
+
+	vector<point> batchNews;
+	vector<point> batchBifs;
+	vector<AbstractVascularElement *> batchParents;
+	for (unsigned k = 0; k < accepted.size(); ++k) {
+		batchNews.push_back(xNews[accepted[k]]);
+		batchBifs.push_back(minBifs[accepted[k]]);
+		batchParents.push_back(minParents[accepted[k]]);
+	}
+	insertVessels(batchBifs, batchNews, batchParents);
+	cout << "Added a batch of " << accepted.size() << " terminals." << endl;
+	for (unsigned k = 0; k < accepted.size(); ++k) {
+		cout << "Added with a cost of " << minCosts[accepted[k]] << endl;
+		dataMonitor->addDLimValue(dLims[accepted[k]], i + k);
+		domain->update();
+	}
+	for (unsigned k = 0; k < boxes.size(); ++k) {
+		delete[] boxes[k];
+	}
+}
+
+void StagedFRROTreeGenerator::findBestBifurcation(vector<point> &xNews, vector<vector<AbstractVascularElement *>> &parentVessels,
+		vector<vector<AbstractVascularElement *>> &neighborVessels, vector<double> &dLims, int isFirstValidOnly,
+		vector<double> *minCosts, vector<point> *minBifs, vector<AbstractVascularElement *> *minParents) {
+
+	//	Flat list of candidates, one per (draw, parent, bifurcation point), with the cost lower bound of its parent
+	int nDraws = xNews.size();
+	vector<int> candidateDraws;
+	vector<AbstractVascularElement *> candidateParents;
+	vector<point> candidateBifs;
+	vector<double> lowerBounds;
+	vector<point> bifPoints;
+	for (int d = 0; d < nDraws; ++d) {
+		for (unsigned j = 0; j < parentVessels[d].size(); ++j) {
+			bifPoints.clear();
+			parentVessels[d][j]->getBranchingPoints(&bifPoints, xNews[d]);
+			double lowerBound = isCandidatePruning ? tree->getCostLowerBound(xNews[d], parentVessels[d][j]) : -INFINITY;
+			candidateDraws.insert(candidateDraws.end(), bifPoints.size(), d);
+			candidateParents.insert(candidateParents.end(), bifPoints.size(), parentVessels[d][j]);
+			candidateBifs.insert(candidateBifs.end(), bifPoints.begin(), bifPoints.end());
+			lowerBounds.insert(lowerBounds.end(), bifPoints.size(), lowerBound);
+		}
+	}
+
+	//	Candidates are visited by draw and increasing lower bound, so good incumbents are found early. Since the
+	//	candidates are appended by draw, sorting them by lower bound keeps the draw order.
+	int nCandidates = candidateBifs.size();
+	vector<int> order(nCandidates);
+	for (int j = 0; j < nCandidates; ++j) {
+		order[j] = j;
+	}
+	stable_sort(order.begin(), order.end(), [&candidateDraws, &lowerBounds](int a, int b) {
+		return candidateDraws[a] < candidateDraws[b] || (candidateDraws[a] == candidateDraws[b] && lowerBounds[a] < lowerBounds[b]);
+	});
+
+	//	Around 8 chunks per thread keep the threads busy with few candidates and bound the scheduling overhead with many
+	int nThreads = omp_get_max_threads();
+	int chunkSize = max(1, nCandidates / (8 * nThreads));
+
+	//	Best (cost, index) pair of each draw. Ties are solved by the lowest candidate index, so the result does not
+	//	depend on which thread evaluated each candidate.
+	vector<double> drawCosts(nDraws, INFINITY);
+	vector<int> drawIndices(nDraws, nCandidates);
+
+	//	Best cost found by any thread for each draw. Candidates whose lower bound exceeds it can not be the best one
+	//	and are skipped. If only the first valid draw is needed, once a draw has a valid candidate the candidates of
+	//	later draws are skipped too.
+	vector<atomic<double>> incumbentCosts(nDraws);
+	for (int d = 0; d < nDraws; ++d) {
+		incumbentCosts[d].store(INFINITY);
+	}
+	atomic<int> firstValidDraw(nDraws);
+	long long int pruned = 0;
+
+	//	Each thread keeps its best (cost, index) pair per draw and they are merged after the loop.
+	vector<double> threadCosts(nThreads * nDraws, INFINITY);
+	vector<int> threadIndices(nThreads * nDraws, nCandidates);
+#pragma omp parallel shared(threadCosts, threadIndices, incumbentCosts, firstValidDraw), reduction(+:pruned), num_threads(nThreads)
+	{
+		vector<double> localCosts(nDraws, INFINITY);
+		vector<int> localIndices(nDraws, nCandidates);
+#pragma omp for schedule(dynamic,chunkSize) nowait
+		for (int k = 0; k < nCandidates; ++k) {
+			int j = order[k];
+			int d = candidateDraws[j];
+			if (d > firstValidDraw.load(memory_order_relaxed)) {
+				continue;
+			}
+			if (lowerBounds[j] > incumbentCosts[d].load(memory_order_relaxed)) {
+				pruned++;
+				continue;
+			}
+			double cost = tree->testBifurcation(xNews[d], candidateParents[j], candidateBifs[j], domain,
+					neighborVessels[d], dLims[d]); //	Inf cost stands for invalid solution
+			if (cost < localCosts[d] || (cost == localCosts[d] && j < localIndices[d])) {
+				localCosts[d] = cost;
+				localIndices[d] = j;
+			}
+			double incumbent = incumbentCosts[d].load(memory_order_relaxed);
+			while (cost < incumbent && !incumbentCosts[d].compare_exchange_weak(incumbent, cost, memory_order_relaxed))
+				;
+			if (isFirstValidOnly && cost < INFINITY) {
+				int validDraw = firstValidDraw.load(memory_order_relaxed);
+				while (d < validDraw && !firstValidDraw.compare_exchange_weak(validDraw, d, memory_order_relaxed))
+					;
+			}
+		}
+		int thread = omp_get_thread_num();
+		for (int d = 0; d < nDraws; ++d) {
+			threadCosts[thread * nDraws + d] = localCosts[d];
+			threadIndices[thread * nDraws + d] = localIndices[d];
+		}
+	}
+
+	for (int d = 0; d < nDraws; ++d) {
+		for (int i = 0; i < nThreads; ++i) {
+			double cost = threadCosts[i * nDraws + d];
+			int index = threadIndices[i * nDraws + d];
+			if (cost < drawCosts[d] || (cost == drawCosts[d] && index < drawIndices[d])) {
+				drawCosts[d] = cost;
+				drawIndices[d] = index;
+			}
+		}
+	}
+
+	candidates += nCandidates;
+	prunedCandidates += pruned;
+
+	minCosts->assign(nDraws, INFINITY);
+	minBifs->assign(nDraws, {INFINITY, INFINITY, INFINITY});
+	minParents->assign(nDraws, NULL);
+	for (int d = 0; d < nDraws; ++d) {
+		if (drawCosts[d] < INFINITY) {
+			(*minCosts)[d] = drawCosts[d];
+			(*minBifs)[d] = candidateBifs[drawIndices[d]];
+			(*minParents)[d] = candidateParents[drawIndices[d]];
+		}
+	}
+}
+
 StagedDomain * StagedFRROTreeGenerator::getDomain() {
 	return domain;
 }
@@ -356,6 +694,7 @@ void StagedFRROTreeGenerator::closeConfigurationFile() {
 }
 
 AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterval, string tempDirectory) {
+	replayJournal();
 
 	this->beginTime = time(nullptr);
 	this->dLimInitial = this->dLim;
@@ -363,9 +702,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterva
 //	VTKObjectTreeSplinesNodalWriter *nodalWriter = new VTKObjectTreeSplinesNodalWriter();
 	generatesConfigurationFile(ios::out);
 
-	for (long long int j = 0; j < tree->getPointCounter(); ++j) {
-		domain->getRandomPoint();
-	}
+	restoreDomainPoints();
 
 	//	Compute current nTerm
 	long long currentTerminals = tree->getNTerms();
@@ -381,42 +718,28 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterva
 			saveStatus(i);
 		}
 
+		//	Batches end at the save points and at the stage changes
+		if (batchSize > 1) {
+			long long int nBatch = min((long long int) batchSize, nTerminals - i);
+			nBatch = min(nBatch, saveInterval - i % saveInterval);
+			nBatch = min(nBatch, domain->getStageRemainingTerminals());
+			addTerminalBatch(i, max(1LL, nBatch));
+			continue;
+		}
+
 		int invalidTerminal = true;
 		int iTry = 0;
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
-			}
-			//	end for trees
+			AbstractVascularElement *minParent;
+			drawTerminal(i, &iTry, INT_MAX, NULL, &xNew, &minCost, &minBif, &minParent);
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << " with a total cost of " << ((SingleVessel *) tree->getRoot())->treeVolume << endl;
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+				insertVessel(minBif, xNew, minParent);
 				invalidTerminal = false;
 			}
 		}
@@ -432,6 +755,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterva
 	this->dLimLast = this->dLim;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Final tree volume " + to_string(((SingleVessel *) tree->getRoot())->treeVolume));
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
@@ -440,7 +764,13 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterva
 
 }
 
+AbstractObjectCCOTree *StagedFRROTreeGenerator::resume(long long int saveInterval, string tempDirectory, string checkpointPrefix) {
+	loadDomainState(checkpointPrefix);
+	return resume(saveInterval, tempDirectory);
+}
+
 AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int saveInterval, string tempDirectory, int maxNumOfTrials) {
+	replayJournal();
 
 	this->beginTime = time(nullptr);
 	this->dLimInitial = this->dLim;
@@ -448,9 +778,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int
 //	VTKObjectTreeSplinesNodalWriter *nodalWriter = new VTKObjectTreeSplinesNodalWriter();
 	generatesConfigurationFile(ios::out);
 
-	for (long long int j = 0; j < tree->getPointCounter(); ++j) {
-		domain->getRandomPoint();
-	}
+	restoreDomainPoints();
 
 	//	Compute current nTerm
 	long long currentTerminals = tree->getNTerms();
@@ -471,40 +799,16 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-			if (iTry > maxNumOfTrials) {
-				return NULL;
-			}
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
+			AbstractVascularElement *minParent;
+			if (drawTerminal(i, &iTry, maxNumOfTrials, NULL, &xNew, &minCost, &minBif, &minParent)) {
+				return NULL;
 			}
-			//	end for trees
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << " with a total cost of " << ((SingleVessel *) tree->getRoot())->treeVolume << endl;
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+				insertVessel(minBif, xNew, minParent);
 				invalidTerminal = false;
 			}
 		}
@@ -520,6 +824,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int
 	this->dLimLast = this->dLim;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Final tree volume " + to_string(((SingleVessel *) tree->getRoot())->treeVolume));
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
@@ -528,16 +833,20 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int
 
 }
 
+AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeExperimental(long long int saveInterval, string tempDirectory, int maxNumOfTrials, string checkpointPrefix) {
+	loadDomainState(checkpointPrefix);
+	return resumeExperimental(saveInterval, tempDirectory, maxNumOfTrials);
+}
+
 AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePoints(long long int saveInterval, string tempDirectory, FILE *fp) {
+	replayJournal();
 	this->beginTime = time(nullptr);
 	this->dLimInitial = this->dLim;
 
 //	VTKObjectTreeSplinesNodalWriter *nodalWriter = new VTKObjectTreeSplinesNodalWriter();
 	generatesConfigurationFile(ios::out);
 
-	for (long long int j = 0; j < tree->getPointCounter(); ++j) {
-		domain->getRandomPoint();
-	}
+	restoreDomainPoints();
 
 	//	Compute current nTerm
 	long long currentTerminals = tree->getNTerms();
@@ -558,33 +867,10 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePoints(long long int s
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
-			}
-			//	end for trees
+			AbstractVascularElement *minParent;
+			drawTerminal(i, &iTry, INT_MAX, NULL, &xNew, &minCost, &minBif, &minParent);
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << " with a total cost of " << ((SingleVessel *) tree->getRoot())->treeVolume << endl;
@@ -602,7 +888,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePoints(long long int s
 				fwrite(&(minParentSV->xDist.p[1]), sizeof(double), 1, fp);
 				fwrite(&(minParentSV->xDist.p[2]), sizeof(double), 1, fp);
 				fwrite(&(instanceData->vesselFunction), sizeof(int), 1, fp);
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);				
+				insertVessel(minBif, xNew, minParent);				
 				invalidTerminal = false;
 			}
 		}
@@ -618,6 +904,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePoints(long long int s
 	this->dLimLast = this->dLim;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Final tree volume " + to_string(((SingleVessel *) tree->getRoot())->treeVolume));
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
@@ -645,7 +932,13 @@ unordered_map<string, pair<SingleVessel*, bool>>* originalVessels(SingleVesselCC
 	return originalSV;
 }
 
+AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePoints(long long int saveInterval, string tempDirectory, FILE *fp, string checkpointPrefix) {
+	loadDomainState(checkpointPrefix);
+	return resumeSavePoints(saveInterval, tempDirectory, fp);
+}
+
 AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long long int saveInterval, string tempDirectory, FILE *fp) {
+	replayJournal();
 	this->beginTime = time(nullptr);
 	this->dLimInitial = this->dLim;
 
@@ -655,9 +948,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long lo
 //	VTKObjectTreeSplinesNodalWriter *nodalWriter = new VTKObjectTreeSplinesNodalWriter();
 	generatesConfigurationFile(ios::out);
 
-	for (long long int j = 0; j < tree->getPointCounter(); ++j) {
-		domain->getRandomPoint();
-	}
+	restoreDomainPoints();
 
 	//	Compute current nTerm
 	long long currentTerminals = tree->getNTerms();
@@ -678,37 +969,10 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long lo
 		dLim = instanceData->dLimCorrectionFactor * domain->getDLim(i, instanceData->perfusionAreaFactor);
 		while (invalidTerminal) {
 
-			do {
-				xNew = domain->getRandomPoint();
-			} while (!isValidSegment(xNew, ++iTry));
-
-			int nNeighbors;
-			vector<AbstractVascularElement *> neighborVessels = tree->getCloseSegments(xNew, domain, &nNeighbors);
-			cout << "Trying segment #" << i << " at terminal point " << xNew << " with the " << nNeighbors << " closest neighbors (dLim = " << dLim << ")." << endl;
-
-			double minCost = INFINITY;
+			double minCost;
 			point minBif;
-			AbstractVascularElement *minParent = NULL;
-#pragma omp parallel for shared(minCost, minBif, minParent), schedule(dynamic,1), num_threads(omp_get_max_threads())
-			for (unsigned j = 0; j < neighborVessels.size(); ++j) {
-				point xBif;
-				double cost;
-				auto ogIt = ogVessels->find(static_cast<SingleVessel *>(neighborVessels[j])->coordToString());
-				if (ogIt != ogVessels->end() && (*ogIt).second.second == false) {
-					continue;
-				} 
-				tree->testVessel(xNew, neighborVessels[j], domain,
-						neighborVessels, dLim, &xBif, &cost); //	Inf cost stands for invalid solution
-#pragma omp critical
-				{
-					if (cost < minCost) {
-						minCost = cost;
-						minBif = xBif;
-						minParent = neighborVessels[j];
-					}
-				}
-			}
-			//	end for trees
+			AbstractVascularElement *minParent;
+			drawTerminal(i, &iTry, INT_MAX, ogVessels, &xNew, &minCost, &minBif, &minParent);
 
 			if (minCost < INFINITY) {
 				cout << "Added with a cost of " << minCost << " with a total cost of " << ((SingleVessel *) tree->getRoot())->treeVolume << endl;
@@ -726,7 +990,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long lo
 				fwrite(&(minParentSV->xDist.p[1]), sizeof(double), 1, fp);
 				fwrite(&(minParentSV->xDist.p[2]), sizeof(double), 1, fp);
 				fwrite(&(instanceData->vesselFunction), sizeof(int), 1, fp);
-				tree->addVessel(minBif, xNew, minParent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);				
+				insertVessel(minBif, xNew, minParent);				
 				invalidTerminal = false;
 			}
 		}
@@ -745,6 +1009,7 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long lo
 	delete ogVessels;
 
 	saveStatus(nTerminals-1);
+	waitSavingTasks();
 	markTimestampOnConfigurationFile("Final tree volume " + to_string(((SingleVessel *) tree->getRoot())->treeVolume));
 	markTimestampOnConfigurationFile("Tree successfully generated.");
 	closeConfigurationFile();
@@ -752,6 +1017,11 @@ AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long lo
 	return tree;
 }
 
+AbstractObjectCCOTree *StagedFRROTreeGenerator::resumeSavePointsMidPoint(long long int saveInterval, string tempDirectory, FILE *fp, string checkpointPrefix) {
+	loadDomainState(checkpointPrefix);
+	return resumeSavePointsMidPoint(saveInterval, tempDirectory, fp);
+}
+
 void StagedFRROTreeGenerator::observableModified(IDomainObservable* observableInstance) {
 	cout << "Changing instance parameters from " << endl << instanceData;
 	instanceData = ((AbstractDomain *) observableInstance)->getInstanceData();
@@ -777,14 +1047,86 @@ void StagedFRROTreeGenerator::setSavingTasks(const vector<AbstractSavingTask*>&
 	this->savingTasks = savingTasks;
 }
 
+void StagedFRROTreeGenerator::restoreDomainPoints(){
+	//	Domains restored from a checkpoint with loadState are already at the tree point counter
+	for (long long int j = domain->getPointCounter(); j < tree->getPointCounter(); ++j) {
+		domain->getRandomPoint();
+	}
+}
+
+int StagedFRROTreeGenerator::loadDomainState(string checkpointPrefix){
+	ifstream domainFile(checkpointPrefix + ".dom");
+	if (!domainFile) {
+		cout << "No domain state at " << checkpointPrefix << ".dom, the domain points are drawn again." << endl;
+		return 0;
+	}
+	domain->loadState(domainFile);
+	cout << "Domain state restored from " << checkpointPrefix << ".dom." << endl;
+	return 1;
+}
+
+void StagedFRROTreeGenerator::replayJournal(){
+	if (journalFilename.empty()) {
+		return;
+	}
+	long long int nAdded = JournalCheckpointSavingTask::replay(journalFilename, tree, gams, epsLims, nus);
+	if (nAdded >= 0) {
+		cout << "Replayed " << nAdded << " vessels from " << journalFilename << "." << endl;
+	}
+}
+
 void StagedFRROTreeGenerator::saveStatus(long long int terminals){
+	tree->updateDeferredValues();
 	tree->setPointCounter(domain->getPointCounter());
 	for (std::vector<AbstractSavingTask *>::iterator it = savingTasks.begin(); it != savingTasks.end(); ++it) {
-		(*it)->execute(terminals,tree);
+		(*it)->prepare(terminals,tree);
+	}
+	AbstractObjectCCOTree *snapshot = NULL;
+	if (savingQueueSize > 0 && !savingTasks.empty()) {
+		snapshot = tree->snapshot();
+	}
+	if (snapshot) {
+		if (!savingQueue) {
+			savingQueue = new SavingTaskQueue(savingQueueSize);
+		}
+		savingQueue->push(terminals, snapshot, savingTasks);
+	} else {
+		for (std::vector<AbstractSavingTask *>::iterator it = savingTasks.begin(); it != savingTasks.end(); ++it) {
+			(*it)->execute(terminals,tree);
+		}
 	}
 //			nodalWriter->write(tempDirectory+ "/step" + to_string(i) + "_view.vtp",tree);
 	markTimestampOnConfigurationFile("Generating vessel #" + to_string(terminals));
 	markTimestampOnConfigurationFile("Total RAM consumption: " + to_string(monitor->getProcessMemoryConsumption()) + " MB.");
+	stringstream poolStatistics;
+	poolStatistics << VesselPool::getStatistics();
+	markTimestampOnConfigurationFile(poolStatistics.str());
+	if (isCandidatePruning) {
+		markTimestampOnConfigurationFile("Pruned candidates: " + to_string(prunedCandidates) + " of " + to_string(candidates) + " ("
+				+ to_string(candidates > 0 ? 100.0 * prunedCandidates / candidates : 0.0) + "%).");
+	}
+}
+
+void StagedFRROTreeGenerator::insertVessel(point xProx, point xDist, AbstractVascularElement *parent){
+	vector<point> xProxs(1, xProx), xDists(1, xDist);
+	vector<AbstractVascularElement *> parents(1, parent);
+	for (std::vector<AbstractSavingTask *>::iterator it = savingTasks.begin(); it != savingTasks.end(); ++it) {
+		(*it)->vesselsAdded(xProxs, xDists, parents, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction, tree->getCurrentStage());
+	}
+	tree->addVessel(xProx, xDist, parent, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+}
+
+void StagedFRROTreeGenerator::insertVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents){
+	for (std::vector<AbstractSavingTask *>::iterator it = savingTasks.begin(); it != savingTasks.end(); ++it) {
+		(*it)->vesselsAdded(xProxs, xDists, parents, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction, tree->getCurrentStage());
+	}
+	tree->addVessels(xProxs, xDists, parents, (AbstractVascularElement::VESSEL_FUNCTION) instanceData->vesselFunction);
+}
+
+void StagedFRROTreeGenerator::waitSavingTasks(){
+	if (savingQueue) {
+		savingQueue->wait();
+	}
 }
 
 vector<AbstractConstraintFunction<double, int> *>* StagedFRROTreeGenerator::getGams()
@@ -817,6 +1159,67 @@ double StagedFRROTreeGenerator::getDLimLast() {
 	return this->dLimLast;
 }
 
+int StagedFRROTreeGenerator::getSpeculativeDraws() const
+{
+	return this->speculativeDraws;
+}
+
+void StagedFRROTreeGenerator::setSpeculativeDraws(int speculativeDraws)
+{
+	this->speculativeDraws = speculativeDraws;
+}
+
+int StagedFRROTreeGenerator::getBatchSize() const
+{
+	return this->batchSize;
+}
+
+void StagedFRROTreeGenerator::setBatchSize(int batchSize)
+{
+	this->batchSize = batchSize;
+}
+
+int StagedFRROTreeGenerator::getIsCandidatePruning() const
+{
+	return this->isCandidatePruning;
+}
+
+void StagedFRROTreeGenerator::setIsCandidatePruning(int isCandidatePruning)
+{
+	this->isCandidatePruning = isCandidatePruning;
+}
+
+long long int StagedFRROTreeGenerator::getCandidates() const
+{
+	return this->candidates;
+}
+
+long long int StagedFRROTreeGenerator::getPrunedCandidates() const
+{
+	return this->prunedCandidates;
+}
+
+
+int StagedFRROTreeGenerator::getSavingQueueSize() const
+{
+	return this->savingQueueSize;
+}
+
+void StagedFRROTreeGenerator::setSavingQueueSize(int savingQueueSize)
+{
+	this->savingQueueSize = savingQueueSize;
+}
+
+string StagedFRROTreeGenerator::getJournalFilename() const
+{
+	return this->journalFilename;
+}
+
+void StagedFRROTreeGenerator::setJournalFilename(string journalFilename)
+{
+	this->journalFilename = journalFilename;
+}
+
 time_t StagedFRROTreeGenerator::getBeginTime() {
 	return this->beginTime;
 }
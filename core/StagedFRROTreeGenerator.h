@@ -13,14 +13,17 @@
 #include <chrono>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include<ctime>
 
 #include "../constrains/AbstractConstraintFunction.h"
 #include "../io/task/AbstractSavingTask.h"
+#include "../io/task/SavingTaskQueue.h"
 #include "../structures/domain/IDomainObserver.h"
 #include "../structures/domain/StagedDomain.h"
 #include "../structures/tree/AbstractObjectCCOTree.h"
+#include "../structures/vascularElements/SingleVessel.h"
 #include "../utils/MemoryMonitor.h"
 
 #include "GeneratorDataMonitor.h"
@@ -43,6 +46,12 @@ class StagedFRROTreeGenerator : public IDomainObserver {
 	MemoryMonitor *monitor;
 	/**	Action executed at each save interval during generate and resume methods */
 	vector<AbstractSavingTask *> savingTasks;
+	/**	Maximum amount of saves pending in the background (0 saves in the generation thread). */
+	int savingQueueSize;
+	/**	Queue that executes the @p savingTasks in the background. */
+	SavingTaskQueue *savingQueue;
+	/**	Journal replayed by the resume methods (empty if none). */
+	string journalFilename;
 
 	/** Amount of terminals in the trees.*/
 	long long int nTerminals;
@@ -70,6 +79,16 @@ class StagedFRROTreeGenerator : public IDomainObserver {
 	string confFilename;
 
 	bool didAllocateTree;
+	/**	Amount of terminal points drawn and evaluated together at each trial. */
+	int speculativeDraws;
+	/**	Maximum amount of terminals added per iteration in the batched mode (1 disables it). */
+	int batchSize;
+	/**	If candidates whose cost lower bound exceeds the best cost found for their draw are skipped. */
+	int isCandidatePruning;
+	/**	Amount of candidates found by findBestBifurcation. */
+	long long int candidates;
+	/**	Amount of candidates skipped by their cost lower bound. */
+	long long int prunedCandidates;
 
 public:
 	/**
@@ -108,12 +127,23 @@ public:
 	 */
 	AbstractObjectCCOTree *generate(long long int saveInterval, string tempDirectory);
 	/**
-	 * Resumes the tree generation.
+	 * Resumes the tree generation. If the domain state saved with the checkpoint was restored with
+	 * StagedDomain::loadState, the domain continues from it; otherwise the domain points consumed by the tree are
+	 * drawn again.
 	 * @param saveInterval Number of iterations performed between saved steps.
 	 * @param tempDirectory Directory where intermediate solutions are saved.
 	 * @return	Perfusion tree.
 	 */
 	AbstractObjectCCOTree *resume(long long int saveInterval, string tempDirectory);
+	/**
+	 * Resumes the tree generation from the checkpoint @p checkpointPrefix written by a CheckpointSavingTask with
+	 * a domain. The sampler state of every stage is restored from @p checkpointPrefix.dom (see loadDomainState).
+	 * @param saveInterval Number of iterations performed between saved steps.
+	 * @param tempDirectory Directory where intermediate solutions are saved.
+	 * @param checkpointPrefix	Checkpoint file name without extension (e.g. path/prefix150).
+	 * @return	Perfusion tree.
+	 */
+	AbstractObjectCCOTree *resume(long long int saveInterval, string tempDirectory, string checkpointPrefix);
 	/**
 	 * Generates the specified tree with a failsafe for bad configuration.
 	 * @param saveInterval Number of iterations performed between saved steps.
@@ -130,6 +160,16 @@ public:
 	 * @return	Perfusion tree.
 	 */
 	AbstractObjectCCOTree *resumeExperimental(long long int saveInterval, string tempDirectory, int maxNumOfTrials);
+	/**
+	 * Resumes the tree generation from the checkpoint @p checkpointPrefix as resume and with the failsafe of
+	 * resumeExperimental.
+	 * @param saveInterval Number of iterations performed between saved steps.
+	 * @param tempDirectory Directory where intermediate solutions are saved.
+	 * @param maxNumOfTrials Maximum number of trials before generator fails and exits.
+	 * @param checkpointPrefix	Checkpoint file name without extension.
+	 * @return	Perfusion tree.
+	 */
+	AbstractObjectCCOTree *resumeExperimental(long long int saveInterval, string tempDirectory, int maxNumOfTrials, string checkpointPrefix);
 	/**
 	 * Returns the perfusion domain.
 	 * @return Perfusion domain.
@@ -139,8 +179,17 @@ public:
 	 * Resumes the tree generation process and saves the optimal xNew and xBif in @param fp.
 	 */
 	AbstractObjectCCOTree *resumeSavePoints(long long int saveInterval, string tempDirectory, FILE *fp);
+	/**
+	 * Resumes the tree generation process from the checkpoint @p checkpointPrefix (see resume) and saves the optimal
+	 * xNew and xBif in @p fp.
+	 */
+	AbstractObjectCCOTree *resumeSavePoints(long long int saveInterval, string tempDirectory, FILE *fp, string checkpointPrefix);
 
 	AbstractObjectCCOTree *resumeSavePointsMidPoint(long long int saveInterval, string tempDirectory, FILE *fp);
+	/**
+	 * Resumes resumeSavePointsMidPoint from the checkpoint @p checkpointPrefix (see resume).
+	 */
+	AbstractObjectCCOTree *resumeSavePointsMidPoint(long long int saveInterval, string tempDirectory, FILE *fp, string checkpointPrefix);
 	
 	StagedDomain* getDomain();
 	/**
@@ -163,11 +212,47 @@ public:
 	 * @return Generated tree.
 	 */
 	AbstractObjectCCOTree*& getTree();
+	/**
+	 * Brings the domain point counter to the one of the resumed tree by drawing the missing points. It does
+	 * nothing if the domain state was restored from the checkpoint.
+	 */
+	void restoreDomainPoints();
+	/**
+	 * Restores the sampler state of every stage of the domain from @p checkpointPrefix.dom, written by a
+	 * CheckpointSavingTask with a domain. Without that file, the resume methods replay the sampler instead.
+	 * @param checkpointPrefix	Checkpoint file name without extension.
+	 * @return	1 if the state was restored, 0 otherwise.
+	 */
+	int loadDomainState(string checkpointPrefix);
+	/**
+	 * Adds to the tree the insertions of the journal set with setJournalFilename, with the constraint functions
+	 * of their stages. It does nothing if no journal is set.
+	 */
+	void replayJournal();
 	/**
 	 * Saves the current generation status using the @p savingTasks and the memory monitor.
 	 * @param terminals	Current iteration number.
 	 */
 	void saveStatus(long long int terminals);
+	/**
+	 * Blocks until the saves pending in the background are finished.
+	 */
+	void waitSavingTasks();
+	/**
+	 * Adds a vessel to the tree with the vessel function of the current stage, after notifying the saving tasks.
+	 * @param xProx	Proximal point of the new vessel.
+	 * @param xDist	Distal point of the new vessel.
+	 * @param parent	Parent vessel (NULL for the root).
+	 */
+	void insertVessel(point xProx, point xDist, AbstractVascularElement *parent);
+	/**
+	 * Adds independent vessels to the tree at once with the vessel function of the current stage, after notifying
+	 * the saving tasks.
+	 * @param xProxs	Proximal points of the new vessels.
+	 * @param xDists	Distal points of the new vessels.
+	 * @param parents	Parent vessels.
+	 */
+	void insertVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents);
 	/**
 	 * Sets a set of saving tasks to be produced each time the generation process saves.
 	 * @param savingTasks	Set of tasks to be performed each time that the tree is saved.
@@ -201,6 +286,78 @@ public:
 	double getDLimInitial();
 
 	double getDLimLast();
+	/**
+	 * Returns the amount of terminal points drawn and evaluated together at each trial.
+	 * @return Amount of speculative draws.
+	 */
+	int getSpeculativeDraws() const;
+	/**
+	 * Sets the amount of terminal points drawn and evaluated together at each trial (1 by default). With more than
+	 * one draw, the candidates of all of them are evaluated concurrently and the first draw (in draw order) that can
+	 * be connected to the tree is added. The discarded draws are given back to the domain, so the generated tree is
+	 * the same as with a single draw. Useful in late stages, where most draws are rejected.
+	 * @param speculativeDraws	Amount of speculative draws.
+	 */
+	void setSpeculativeDraws(int speculativeDraws);
+	/**
+	 * Returns the maximum amount of terminals added per iteration.
+	 * @return Batch size.
+	 */
+	int getBatchSize() const;
+	/**
+	 * Sets the maximum amount of terminals added per iteration by generate and resume (1 by default). With more
+	 * than one, terminals are drawn and evaluated against the same tree while their neighborhoods are independent
+	 * and then added with a single hemodynamic update. Each terminal is optimized without the flow of the other
+	 * terminals of its batch, so the tree deviates slightly from the sequential CCO.
+	 * @param batchSize	Batch size.
+	 */
+	void setBatchSize(int batchSize);
+	/**
+	 * Returns if candidates are skipped by their cost lower bound.
+	 * @return If candidates are pruned.
+	 */
+	int getIsCandidatePruning() const;
+	/**
+	 * Sets if the candidates whose cost lower bound (AbstractObjectCCOTree::getCostLowerBound) exceeds the best cost
+	 * already found for their draw are skipped without being evaluated (disabled by default). The amount of pruned
+	 * candidates is written to the configuration file at each save point.
+	 * @param isCandidatePruning	If candidates are pruned.
+	 */
+	void setIsCandidatePruning(int isCandidatePruning);
+	/**
+	 * Returns the amount of candidates found since the generator was created.
+	 * @return Amount of candidates.
+	 */
+	long long int getCandidates() const;
+	/**
+	 * Returns the amount of candidates skipped by their cost lower bound since the generator was created.
+	 * @return Amount of pruned candidates.
+	 */
+	long long int getPrunedCandidates() const;
+	/**
+	 * Returns the maximum amount of saves pending in the background.
+	 * @return Maximum amount of pending saves.
+	 */
+	int getSavingQueueSize() const;
+	/**
+	 * Sets the maximum amount of saves pending in the background (0 by default). If positive, saveStatus copies the
+	 * tree and the saving tasks write the copy in a background thread while the generation continues. When
+	 * @p savingQueueSize saves are pending, the generation waits for the oldest one to finish.
+	 * @param savingQueueSize	Maximum amount of pending saves.
+	 */
+	void setSavingQueueSize(int savingQueueSize);
+	/**
+	 * Returns the journal replayed by the resume methods.
+	 * @return Journal file.
+	 */
+	string getJournalFilename() const;
+	/**
+	 * Sets the journal written by a JournalCheckpointSavingTask to be replayed by the resume methods before
+	 * generating (empty by default). The tree of the generator must be loaded from the base snapshot of the journal
+	 * (see JournalCheckpointSavingTask::getBaseFilename).
+	 * @param journalFilename	Journal file.
+	 */
+	void setJournalFilename(string journalFilename);
 	
 protected:
 	/**	Configuration file stream. */
@@ -221,6 +378,57 @@ protected:
 	 * @return If the segment is valid.
 	 */
 	int isValidSegment(point xNew, int iTry);
+	/**
+	 * Draws valid terminal points and finds the bifurcation with minimum cost to connect them. @p speculativeDraws
+	 * points are drawn and evaluated together; the first one that can be connected is returned and the points drawn
+	 * after it are given back to the domain, restoring @p dLim and @p iTry to their value after that draw.
+	 * @param i	Current amount of terminals.
+	 * @param iTry	Number of trial, updated with the trials performed.
+	 * @param maxNumOfTrials	Maximum number of trials (no draws are performed beyond it).
+	 * @param originals	Vessels of the original tree with a flag of whether they can be parents of new vessels. If
+	 * NULL, all close neighbors are tested as parents.
+	 * @param xNew	Drawn distal point.
+	 * @param minCost	Minimum cost (INFINITY if no draw can be connected).
+	 * @param minBif	Bifurcation point with minimum cost.
+	 * @param minParent	Parent vessel with minimum cost (NULL if no draw can be connected).
+	 * @return 1 if @p maxNumOfTrials was reached and no draw can be connected, otherwise 0.
+	 */
+	int drawTerminal(long long int i, int *iTry, int maxNumOfTrials, unordered_map<string, pair<SingleVessel *, bool>> *originals,
+			point *xNew, double *minCost, point *minBif, AbstractVascularElement **minParent);
+	/**
+	 * Adds up to @p nBatch terminals evaluated against the current tree. Points are drawn while their local
+	 * neighborhoods do not overlap and do not share close segments, and all of them are evaluated together. Then,
+	 * terminals are added in draw order while they can be connected, their neighborhood extended to enclose the new
+	 * vessel does not overlap those of the previous terminals, their parent is neither an ancestor nor a descendant
+	 * of the previous parents and their distal point is farther than @p dLim from the previous new vessels. The
+	 * remaining draws are given back to the domain, so they are drawn again against the updated tree. The batch is
+	 * added with a single hemodynamic update (AbstractObjectCCOTree::addVessels).
+	 * @param i	Current amount of terminals.
+	 * @param nBatch	Maximum amount of terminals to add.
+	 */
+	void addTerminalBatch(long long int i, long long int nBatch);
+	/**
+	 * Finds the bifurcation with minimum cost to connect each draw in @p xNews. Every branching point of every parent
+	 * vessel of every draw is a candidate and all candidates are evaluated as a single work list shared among the
+	 * OpenMP threads, so the load is balanced regardless of the amount of parent vessels. Candidates are visited by
+	 * draw and increasing cost lower bound (AbstractObjectCCOTree::getCostLowerBound); with @p isCandidatePruning,
+	 * those whose bound exceeds the best cost found so far for its draw are skipped without being evaluated. The
+	 * result does not depend on the
+	 * amount of threads nor on their scheduling: skipped candidates can not be the best one and, among candidates
+	 * with equal cost, the one with the lowest index (draw, parent and branching point order) wins.
+	 * @param xNews	Proposed distal points.
+	 * @param parentVessels	Vessels tested as parent of the new vessel for each draw.
+	 * @param neighborVessels	Close neighbors used for intersection test for each draw.
+	 * @param dLims	Value of @p dLim for each draw.
+	 * @param isFirstValidOnly	If only the first draw that can be connected is needed. The candidates of the draws
+	 * after a draw already known to be connectable are skipped and their cost is INFINITY.
+	 * @param minCosts	Minimum cost of each draw (INFINITY if no candidate is valid).
+	 * @param minBifs	Bifurcation point with minimum cost of each draw.
+	 * @param minParents	Parent vessel with minimum cost of each draw (NULL if no candidate is valid).
+	 */
+	void findBestBifurcation(vector<point> &xNews, vector<vector<AbstractVascularElement *>> &parentVessels,
+			vector<vector<AbstractVascularElement *>> &neighborVessels, vector<double> &dLims, int isFirstValidOnly,
+			vector<double> *minCosts, vector<point> *minBifs, vector<AbstractVascularElement *> *minParents);
 	/**
 	 * Generates the configuration file for the current tree generation.
 	 * @param mode Is the openmode used for the generated file (ios::out for generation, ios::app for resume).
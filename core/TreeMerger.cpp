@@ -137,10 +137,7 @@ SingleVesselCCOOTree* TreeMerger::mergeFast() {
     // Update tree
     this->tree->updateTree(((SingleVessel *) this->tree->getRoot()), this->tree);
 	
-	double maxVariation = INFINITY;
-	while (maxVariation > this->tree->variationTolerance) {
-			this->tree->updateTreeViscositiesBeta(((SingleVessel *) this->tree->getRoot()), &maxVariation);
-	}
+	this->tree->solveViscositiesBeta((SingleVessel *) this->tree->getRoot());
 
     return this->tree;
 }
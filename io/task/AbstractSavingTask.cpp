@@ -9,6 +9,25 @@
 
 #include "AbstractSavingTask.h"
 
+#include <cstdio>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+	/**	Flushes the file or directory @p filename to the disk. */
+	int syncFile(string filename, int flags) {
+		int fd = open(filename.c_str(), flags);
+		if (fd < 0) {
+			return 0;
+		}
+		int isSynced = fsync(fd) == 0;
+		close(fd);
+		return isSynced;
+	}
+}
+
 AbstractSavingTask::AbstractSavingTask()
 {
 	// TODO Auto-generated constructor stub
@@ -20,3 +39,34 @@ AbstractSavingTask::~AbstractSavingTask()
 	// TODO Auto-generated destructor stub
 }
 
+void AbstractSavingTask::vesselsAdded(vector<point> &/*xProxs*/, vector<point> &/*xDists*/, vector<AbstractVascularElement *> &/*parents*/,
+		AbstractVascularElement::VESSEL_FUNCTION /*vesselFunction*/, int /*stage*/)
+{
+}
+
+void AbstractSavingTask::prepare(long long int /*terminals*/, AbstractObjectCCOTree */*tree*/)
+{
+}
+
+int AbstractSavingTask::commitFile(string tempFilename, string filename)
+{
+	//	The data must be on the disk before the rename makes it visible
+	if (!syncFile(tempFilename, O_RDONLY)) {
+		cerr << "Could not write " << tempFilename << endl;
+		remove(tempFilename.c_str());
+		return 0;
+	}
+	//	rename is atomic within the same file system
+	if (rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		cerr << "Could not rename " << tempFilename << " to " << filename << endl;
+		remove(tempFilename.c_str());
+		return 0;
+	}
+	//	Persists the rename; @p filename is already replaced even if it fails
+	size_t separator = filename.find_last_of('/');
+	string directory = separator == string::npos ? "." : (separator == 0 ? "/" : filename.substr(0, separator));
+	if (!syncFile(directory, O_RDONLY | O_DIRECTORY)) {
+		cerr << "Could not flush " << directory << endl;
+	}
+	return 1;
+}
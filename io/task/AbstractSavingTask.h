@@ -21,7 +21,41 @@ public:
 	AbstractSavingTask();
 	virtual ~AbstractSavingTask();
 
+	/**
+	 * Called in the generation thread right before the vessels are added to the tree with
+	 * AbstractObjectCCOTree::addVessel (one vessel) or AbstractObjectCCOTree::addVessels (several vessels).
+	 * @param xProxs	Proximal points of the new vessels.
+	 * @param xDists	Distal points of the new vessels.
+	 * @param parents	Parents of the new vessels.
+	 * @param vesselFunction	Function of the new vessels.
+	 * @param stage	Generation stage.
+	 */
+	virtual void vesselsAdded(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents,
+			AbstractVascularElement::VESSEL_FUNCTION vesselFunction, int stage);
+	/**
+	 * Called in the generation thread right before the tree is saved, while the generation state matches @p tree.
+	 * Tasks that save data besides the tree must copy it here, since execute may run later in another thread.
+	 * @param terminals	Current iteration number.
+	 * @param tree	Tree to be saved.
+	 */
+	virtual void prepare(long long int terminals, AbstractObjectCCOTree *tree);
+	/**
+	 * Saves @p tree. It may run in a background thread over a snapshot of the generated tree.
+	 * @param terminals	Iteration number of the snapshot.
+	 * @param tree	Tree to save.
+	 */
 	virtual void execute(long long int terminals, AbstractObjectCCOTree *tree) = 0;
+
+protected:
+	/**
+	 * Replaces @p filename by the completely written file @p tempFilename, so a crash while saving never leaves a
+	 * truncated @p filename. @p tempFilename is flushed to the disk before the rename and the directory after it.
+	 * If it can not be flushed or renamed, @p tempFilename is removed and @p filename is kept.
+	 * @param tempFilename	Written file.
+	 * @param filename	Final file name.
+	 * @return	1 if @p filename was replaced.
+	 */
+	static int commitFile(string tempFilename, string filename);
 };
 
 #endif /* ABSTRACTSAVINGTASK_H_ */
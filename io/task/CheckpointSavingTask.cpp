@@ -9,14 +9,63 @@
 
 #include "CheckpointSavingTask.h"
 
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
 CheckpointSavingTask::CheckpointSavingTask(string path, string prefix){
 	this->path = path;
 	this->prefix = prefix;
+	this->domain = NULL;
+}
+
+CheckpointSavingTask::CheckpointSavingTask(string path, string prefix, AbstractDomain *domain){
+	this->path = path;
+	this->prefix = prefix;
+	this->domain = domain;
 }
 
 CheckpointSavingTask::~CheckpointSavingTask(){
 }
 
+void CheckpointSavingTask::prepare(long long int terminals, AbstractObjectCCOTree */*tree*/){
+	if (domain) {
+		stringstream state;
+		domain->saveState(state);
+		lock_guard<mutex> lock(statesLock);
+		domainStates[terminals] = state.str();
+	}
+}
+
 void CheckpointSavingTask::execute(long long int terminals, AbstractObjectCCOTree *tree){
-	tree->save(path + "/" + prefix + to_string(terminals) + ".cco");
+	string filename = path + "/" + prefix + to_string(terminals);
+	int isTreeSaved = 0;
+	if (tree->save(filename + ".cco.tmp")) {
+		isTreeSaved = commitFile(filename + ".cco.tmp", filename + ".cco");
+	} else {
+		cerr << "Could not write " << filename << ".cco.tmp, the checkpoint is skipped." << endl;
+		remove((filename + ".cco.tmp").c_str());
+	}
+	if (domain) {
+		string state;
+		{
+			lock_guard<mutex> lock(statesLock);
+			state = domainStates[terminals];
+			domainStates.erase(terminals);
+		}
+		//	A domain state without its tree can not be resumed
+		if (!isTreeSaved) {
+			return;
+		}
+		ofstream domainFile(filename + ".dom.tmp");
+		domainFile << state;
+		domainFile.close();
+		if (domainFile.fail()) {
+			cerr << "Could not write " << filename << ".dom.tmp, the domain state is skipped." << endl;
+			remove((filename + ".dom.tmp").c_str());
+			return;
+		}
+		commitFile(filename + ".dom.tmp", filename + ".dom");
+	}
 }
@@ -10,14 +10,25 @@
 #ifndef CHECKPOINTSAVINGTASK_H_
 #define CHECKPOINTSAVINGTASK_H_
 
+#include <map>
+#include <mutex>
+
 #include "AbstractSavingTask.h"
+#include "../../structures/domain/AbstractDomain.h"
 
 /**
  * Saves a SingleVesselCCOOTree structure in .cco format. Does not save dLim value, thus resume a generation process may differ from the original execution.
+ * If a domain is given, the state of its point sampler is saved next to each checkpoint in a .dom file, so the
+ * generation can be resumed with AbstractDomain::loadState instead of drawing again all consumed points.
  */
 class CheckpointSavingTask: public AbstractSavingTask {
 	string path;
 	string prefix;
+	AbstractDomain *domain;
+	/**	Domain states captured by prepare and not saved yet, by iteration number. */
+	map<long long int, string> domainStates;
+	/**	Lock of @p domainStates. */
+	mutex statesLock;
 public:
 	/**
 	 * Saves the @p tree in the given path.
@@ -25,10 +36,22 @@ public:
 	 * @param prefix	Prefix for the generated files.
 	 */
 	CheckpointSavingTask(string path, string prefix);
+	/**
+	 * Saves the @p tree and the point sampler state of @p domain in the given path.
+	 * @param path	Output directory.
+	 * @param prefix	Prefix for the generated files.
+	 * @param domain	Domain of the generation process.
+	 */
+	CheckpointSavingTask(string path, string prefix, AbstractDomain *domain);
 	virtual ~CheckpointSavingTask();
 
 	/**
-	 * Saves the tree in its current state in a .cco format.
+	 * Captures the domain state.
+	 */
+	void prepare(long long int terminals, AbstractObjectCCOTree *tree);
+	/**
+	 * Saves the tree in its current state in a .cco format and the domain state in a .dom file. Both files are
+	 * written with a temporary name and then renamed.
 	 */
 	void execute(long long int terminals, AbstractObjectCCOTree *tree);
 };
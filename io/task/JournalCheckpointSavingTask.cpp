@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * JournalCheckpointSavingTask.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "JournalCheckpointSavingTask.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+#include "../../structures/vascularElements/SingleVessel.h"
+
+namespace {
+	/**	Key of a vessel given by its distal point. */
+	typedef tuple<double, double, double> DistalKey;
+
+	DistalKey distalKey(point p) {
+		return make_tuple(p.p[0], p.p[1], p.p[2]);
+	}
+
+	/**	Registers @p vessel and its children by their distal points. */
+	void registerVessels(AbstractVascularElement *vessel, map<DistalKey, AbstractVascularElement *> &vessels) {
+		vessels[distalKey(((SingleVessel *) vessel)->xDist)] = vessel;
+		vector<AbstractVascularElement *> &children = vessel->getChildren();
+		for (vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
+			vessels[distalKey(((SingleVessel *) (*it))->xDist)] = *it;
+		}
+	}
+
+	/**	Insertion read from a "V" line. */
+	struct VesselRecord {
+		int hasParent;
+		point xParent;
+		point xProx;
+		point xDist;
+		int vesselFunction;
+		int stage;
+	};
+
+	/**	Reads a complete "C <terminals> <point counter>" line. */
+	bool readCheckpoint(const string &line, long long int &terminals, long long int &pointCounter) {
+		stringstream record(line);
+		string type, extra;
+		return (record >> type) && type.compare("C") == 0 && (record >> terminals >> pointCounter) && !(record >> extra);
+	}
+}
+
+JournalCheckpointSavingTask::JournalCheckpointSavingTask(string path, string prefix, int compactionInterval){
+	this->path = path;
+	this->prefix = prefix;
+	this->compactionInterval = compactionInterval;
+	this->appendsSinceBase = 0;
+	this->baseFilename = "";
+}
+
+JournalCheckpointSavingTask::~JournalCheckpointSavingTask(){
+}
+
+void JournalCheckpointSavingTask::vesselsAdded(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents,
+		AbstractVascularElement::VESSEL_FUNCTION vesselFunction, int stage){
+	lock_guard<mutex> lock(recordsLock);
+	//	17 significant digits are enough to read back the same doubles
+	records.precision(17);
+	if (xDists.size() > 1) {
+		records << "B " << xDists.size() << endl;
+	}
+	for (unsigned int i = 0; i < xDists.size(); ++i) {
+		point xParent = {0.0, 0.0, 0.0};
+		if (parents[i]) {
+			xParent = ((SingleVessel *) parents[i])->xDist;
+		}
+		records << "V " << (parents[i] ? 1 : 0) << " " << xParent.p[0] << " " << xParent.p[1] << " " << xParent.p[2] << " "
+				<< xProxs[i].p[0] << " " << xProxs[i].p[1] << " " << xProxs[i].p[2] << " "
+				<< xDists[i].p[0] << " " << xDists[i].p[1] << " " << xDists[i].p[2] << " "
+				<< vesselFunction << " " << stage << endl;
+	}
+}
+
+void JournalCheckpointSavingTask::prepare(long long int terminals, AbstractObjectCCOTree */*tree*/){
+	lock_guard<mutex> lock(recordsLock);
+	pendingRecords[terminals] = records.str();
+	records.str("");
+}
+
+void JournalCheckpointSavingTask::execute(long long int terminals, AbstractObjectCCOTree *tree){
+	string checkpointRecords;
+	{
+		lock_guard<mutex> lock(recordsLock);
+		checkpointRecords = pendingRecords[terminals];
+		pendingRecords.erase(terminals);
+	}
+
+	if (baseFilename.empty() || appendsSinceBase >= compactionInterval) {
+		//	The base snapshot already contains the insertions of this checkpoint
+		if (compact(terminals, tree)) {
+			return;
+		}
+		//	Without a new base, the insertions go to the journal of the previous one
+		if (baseFilename.empty()) {
+			return;
+		}
+	}
+
+	ofstream journal(path + "/" + prefix + ".jnl", ios::out | ios::app);
+	journal << checkpointRecords << "C " << terminals << " " << tree->getPointCounter() << endl;
+	journal.close();
+	++appendsSinceBase;
+}
+
+int JournalCheckpointSavingTask::compact(long long int terminals, AbstractObjectCCOTree *tree){
+	string previousBase = baseFilename;
+	string journalFilename = path + "/" + prefix + ".jnl";
+	string newBase = path + "/" + prefix + to_string(terminals) + ".cco";
+
+	if (!tree->save(newBase + ".tmp")) {
+		cerr << "Could not write " << newBase << ".tmp, the journal is not compacted." << endl;
+		remove((newBase + ".tmp").c_str());
+		return 0;
+	}
+	if (!commitFile(newBase + ".tmp", newBase)) {
+		return 0;
+	}
+
+	ofstream journal(journalFilename + ".tmp");
+	journal << "BASE " << newBase << endl;
+	journal << "C " << terminals << " " << tree->getPointCounter() << endl;
+	journal.close();
+	int isJournalCommitted = 0;
+	if (journal.fail()) {
+		remove((journalFilename + ".tmp").c_str());
+	} else {
+		isJournalCommitted = commitFile(journalFilename + ".tmp", journalFilename);
+	}
+	if (!isJournalCommitted) {
+		//	The journal still refers to the previous base
+		if (newBase != previousBase) {
+			remove(newBase.c_str());
+		}
+		return 0;
+	}
+	baseFilename = newBase;
+
+	//	The journal no longer refers to the previous base
+	if (!previousBase.empty() && previousBase != baseFilename) {
+		remove(previousBase.c_str());
+	}
+	appendsSinceBase = 0;
+	return 1;
+}
+
+string JournalCheckpointSavingTask::getBaseFilename(string journalFilename){
+	ifstream journal(journalFilename);
+	string token, filename = "";
+	journal >> token;
+	if (token.compare("BASE") != 0) {
+		return "";
+	}
+	journal >> filename;
+	return filename;
+}
+
+long long int JournalCheckpointSavingTask::replay(string journalFilename, AbstractObjectCCOTree *tree,
+		vector<AbstractConstraintFunction<double,int> *> &gams, vector<AbstractConstraintFunction<double,int> *> &epsLims,
+		vector<AbstractConstraintFunction<double,int> *> &nus){
+	ifstream journal(journalFilename);
+	vector<string> lines;
+	string line;
+	getline(journal, line);	//	BASE
+	//	A last line without end of line was not completely written
+	while (getline(journal, line) && !journal.eof()) {
+		lines.push_back(line);
+	}
+
+	//	Insertions after the last complete checkpoint line were not completely written
+	long long int lastCheckpoint = (long long int) lines.size() - 1;
+	long long int terminals, pointCounter;
+	while (lastCheckpoint >= 0 && !readCheckpoint(lines[lastCheckpoint], terminals, pointCounter)) {
+		--lastCheckpoint;
+	}
+
+	//	Records are validated before modifying the tree
+	vector<VesselRecord> vesselRecords(lastCheckpoint + 1);
+	for (long long int i = 0; i < lastCheckpoint; ++i) {
+		stringstream record(lines[i]);
+		string type;
+		record >> type;
+		bool isValid;
+		if (type.compare("C") == 0) {
+			isValid = readCheckpoint(lines[i], terminals, pointCounter);
+		} else if (type.compare("B") == 0) {
+			long long int groupSize;
+			isValid = (bool) (record >> groupSize) && groupSize > 0;
+		} else if (type.compare("V") == 0) {
+			VesselRecord &vessel = vesselRecords[i];
+			isValid = (bool) (record >> vessel.hasParent >> vessel.xParent.p[0] >> vessel.xParent.p[1] >> vessel.xParent.p[2]
+					>> vessel.xProx.p[0] >> vessel.xProx.p[1] >> vessel.xProx.p[2]
+					>> vessel.xDist.p[0] >> vessel.xDist.p[1] >> vessel.xDist.p[2] >> vessel.vesselFunction >> vessel.stage)
+					&& vessel.stage >= 0 && (unsigned int) vessel.stage < gams.size()
+					&& (unsigned int) vessel.stage < epsLims.size() && (unsigned int) vessel.stage < nus.size();
+		} else {
+			isValid = false;
+		}
+		if (!isValid) {
+			cout << "Journal " << journalFilename << " has an invalid record at line " << i + 2 << ", it is not replayed." << endl;
+			return -1;
+		}
+	}
+
+	map<DistalKey, AbstractVascularElement *> vessels;
+	unordered_map<long long, AbstractVascularElement *> &segments = tree->getSegments();
+	for (unordered_map<long long, AbstractVascularElement *>::iterator it = segments.begin(); it != segments.end(); ++it) {
+		vessels[distalKey(((SingleVessel *) it->second)->xDist)] = it->second;
+	}
+
+	//	Each insertion is performed with the constraints of its stage, as in the generation
+	int previousStage = tree->getCurrentStage();
+	AbstractConstraintFunction<double,int> *previousGam = tree->getGam();
+	AbstractConstraintFunction<double,int> *previousEpsLim = tree->getEpsLim();
+	AbstractConstraintFunction<double,int> *previousNu = tree->getNu();
+	int currentStage = -1;
+
+	long long int nAdded = 0;
+	long long int groupSize = 1;
+	vector<point> xProxs, xDists;
+	vector<AbstractVascularElement *> parents;
+	for (long long int i = 0; i <= lastCheckpoint; ++i) {
+		stringstream record(lines[i]);
+		string type;
+		record >> type;
+		if (type.compare("C") == 0) {
+			readCheckpoint(lines[i], terminals, pointCounter);
+			tree->setPointCounter(pointCounter);
+		} else if (type.compare("B") == 0) {
+			record >> groupSize;
+		} else if (type.compare("V") == 0) {
+			VesselRecord &vessel = vesselRecords[i];
+			xProxs.push_back(vessel.xProx);
+			xDists.push_back(vessel.xDist);
+			parents.push_back(vessel.hasParent ? vessels[distalKey(vessel.xParent)] : NULL);
+			if ((long long int) xDists.size() < groupSize) {
+				continue;
+			}
+
+			if (vessel.stage != currentStage) {
+				currentStage = vessel.stage;
+				tree->setCurrentStage(currentStage);
+				tree->setGam(gams[currentStage]);
+				tree->setEpsLim(epsLims[currentStage]);
+				tree->setNu(nus[currentStage]);
+			}
+			if (xDists.size() > 1) {
+				tree->addVessels(xProxs, xDists, parents, (AbstractVascularElement::VESSEL_FUNCTION) vessel.vesselFunction);
+			} else {
+				tree->addVessel(xProxs[0], xDists[0], parents[0], (AbstractVascularElement::VESSEL_FUNCTION) vessel.vesselFunction);
+			}
+			for (unsigned int j = 0; j < parents.size(); ++j) {
+				registerVessels(parents[j] ? parents[j] : tree->getRoot(), vessels);
+			}
+			nAdded += xDists.size();
+			xProxs.clear();
+			xDists.clear();
+			parents.clear();
+			groupSize = 1;
+		}
+	}
+
+	if (currentStage != -1) {
+		tree->setCurrentStage(previousStage);
+		tree->setGam(previousGam);
+		tree->setEpsLim(previousEpsLim);
+		tree->setNu(previousNu);
+	}
+
+	return nAdded;
+}
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * JournalCheckpointSavingTask.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef JOURNALCHECKPOINTSAVINGTASK_H_
+#define JOURNALCHECKPOINTSAVINGTASK_H_
+
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include "AbstractSavingTask.h"
+
+/**
+ * Saves the generation as a base .cco snapshot plus an append-only journal with the vessels added since the
+ * snapshot. Each checkpoint appends the insertions performed since the previous one, so its cost does not depend on
+ * the tree size. Every @p compactionInterval checkpoints the journal is folded into a new base snapshot.
+ *
+ * The journal is the text file prefix.jnl. Its first line is "BASE <.cco file>". Each insertion is a line
+ * "V <has parent> <parent distal point> <proximal point> <distal point> <vessel function> <stage>" where the parent
+ * is identified by its distal point at the time of the insertion, since vessel ids are not kept when a .cco file
+ * is loaded. Insertions added together by AbstractObjectCCOTree::addVessels are preceded by "B <amount>". Each
+ * checkpoint ends with "C <terminals> <point counter>"; insertions after the last complete checkpoint line are
+ * ignored, so an interrupted append does not corrupt the journal.
+ */
+class JournalCheckpointSavingTask: public AbstractSavingTask {
+	string path;
+	string prefix;
+	/**	Checkpoints between base snapshots. */
+	int compactionInterval;
+	/**	Checkpoints appended to the journal since the last base snapshot. */
+	int appendsSinceBase;
+	/**	Current base snapshot. */
+	string baseFilename;
+	/**	Insertions not assigned to a checkpoint yet. */
+	stringstream records;
+	/**	Insertions of each checkpoint captured by prepare and not saved yet. */
+	map<long long int, string> pendingRecords;
+	/**	Lock of @p records and @p pendingRecords. */
+	mutex recordsLock;
+
+	/**
+	 * Writes a new base snapshot and starts an empty journal. If any of them can not be committed, the previous
+	 * base and journal are kept.
+	 * @param terminals	Iteration number.
+	 * @param tree	Tree to save.
+	 * @return	1 if the new base and journal were committed.
+	 */
+	int compact(long long int terminals, AbstractObjectCCOTree *tree);
+public:
+	/**
+	 * Saves the journal of the generation in the given path.
+	 * @param path	Output directory.
+	 * @param prefix	Prefix for the generated files.
+	 * @param compactionInterval	Checkpoints between base snapshots.
+	 */
+	JournalCheckpointSavingTask(string path, string prefix, int compactionInterval);
+	virtual ~JournalCheckpointSavingTask();
+
+	/**
+	 * Records the vessels that are about to be added to the tree.
+	 */
+	void vesselsAdded(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents,
+			AbstractVascularElement::VESSEL_FUNCTION vesselFunction, int stage);
+	/**
+	 * Assigns the recorded insertions to the checkpoint @p terminals.
+	 */
+	void prepare(long long int terminals, AbstractObjectCCOTree *tree);
+	/**
+	 * Appends the insertions of the checkpoint to the journal, or writes a new base snapshot every
+	 * @p compactionInterval checkpoints.
+	 */
+	void execute(long long int terminals, AbstractObjectCCOTree *tree);
+
+	/**
+	 * Returns the base snapshot of the journal @p journalFilename.
+	 * @param journalFilename	Journal file.
+	 * @return	Base .cco file, empty if the journal can not be read.
+	 */
+	static string getBaseFilename(string journalFilename);
+	/**
+	 * Adds to @p tree, loaded from the base snapshot, the insertions of the journal up to its last complete
+	 * checkpoint and sets the tree point counter. Each insertion is performed with the stage and the constraint
+	 * functions of its stage; the stage and functions of @p tree are restored afterwards. Nothing is added if a
+	 * record before the last checkpoint can not be read.
+	 * @param journalFilename	Journal file.
+	 * @param tree	Tree loaded from the base snapshot.
+	 * @param gams	Murray's power law function of each stage.
+	 * @param epsLims	Symmetry constraint function of each stage.
+	 * @param nus	Viscosity function of each stage.
+	 * @return	Amount of vessels added, -1 if the journal is corrupted.
+	 */
+	static long long int replay(string journalFilename, AbstractObjectCCOTree *tree,
+			vector<AbstractConstraintFunction<double,int> *> &gams, vector<AbstractConstraintFunction<double,int> *> &epsLims,
+			vector<AbstractConstraintFunction<double,int> *> &nus);
+};
+
+#endif /* JOURNALCHECKPOINTSAVINGTASK_H_ */
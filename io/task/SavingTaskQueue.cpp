@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * SavingTaskQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "SavingTaskQueue.h"
+
+SavingTaskQueue::SavingTaskQueue(int capacity){
+	this->capacity = capacity > 0 ? capacity : 1;
+	this->isRunning = 0;
+	this->isClosing = 0;
+	this->worker = thread(&SavingTaskQueue::run, this);
+}
+
+SavingTaskQueue::~SavingTaskQueue(){
+	{
+		lock_guard<mutex> lock(queueLock);
+		isClosing = 1;
+	}
+	jobPushed.notify_all();
+	worker.join();
+}
+
+void SavingTaskQueue::push(long long int terminals, AbstractObjectCCOTree *tree, vector<AbstractSavingTask *> &tasks){
+	unique_lock<mutex> lock(queueLock);
+	while (jobs.size() >= capacity) {
+		jobFinished.wait(lock);
+	}
+	Job job;
+	job.terminals = terminals;
+	job.tree = tree;
+	job.tasks = tasks;
+	jobs.push_back(job);
+	lock.unlock();
+	jobPushed.notify_one();
+}
+
+void SavingTaskQueue::wait(){
+	unique_lock<mutex> lock(queueLock);
+	while (!jobs.empty() || isRunning) {
+		jobFinished.wait(lock);
+	}
+}
+
+void SavingTaskQueue::run(){
+	unique_lock<mutex> lock(queueLock);
+	while (true) {
+		while (jobs.empty() && !isClosing) {
+			jobPushed.wait(lock);
+		}
+		if (jobs.empty()) {
+			return;
+		}
+		Job job = jobs.front();
+		jobs.pop_front();
+		isRunning = 1;
+		lock.unlock();
+
+		for (vector<AbstractSavingTask *>::iterator it = job.tasks.begin(); it != job.tasks.end(); ++it) {
+			(*it)->execute(job.terminals, job.tree);
+		}
+		delete job.tree;
+
+		lock.lock();
+		isRunning = 0;
+		jobFinished.notify_all();
+	}
+}
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * SavingTaskQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef SAVINGTASKQUEUE_H_
+#define SAVINGTASKQUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AbstractSavingTask.h"
+
+using namespace std;
+
+/**
+ * Runs saving tasks in a background thread. Each job holds a snapshot of the tree that is owned by the queue and
+ * deleted once all its tasks are executed, so the generation can keep modifying the original tree. At most
+ * @p capacity jobs wait in the queue; pushing a job to a full queue blocks until the oldest job finishes.
+ */
+class SavingTaskQueue {
+	/**	Pending saving job. */
+	struct Job {
+		/**	Amount of terminals of the snapshot. */
+		long long int terminals;
+		/**	Snapshot of the tree. */
+		AbstractObjectCCOTree *tree;
+		/**	Tasks to execute. */
+		vector<AbstractSavingTask *> tasks;
+	};
+
+	/**	Maximum amount of pending jobs. */
+	unsigned int capacity;
+	/**	Pending jobs. */
+	deque<Job> jobs;
+	/**	If a job is being executed. */
+	int isRunning;
+	/**	If the queue is being destroyed. */
+	int isClosing;
+	/**	Lock of the queue state. */
+	mutex queueLock;
+	/**	Signaled when a job is pushed or the queue is closed. */
+	condition_variable jobPushed;
+	/**	Signaled when a job is finished. */
+	condition_variable jobFinished;
+	/**	Background thread. */
+	thread worker;
+
+	/**
+	 * Executes the jobs until the queue is closed and empty.
+	 */
+	void run();
+public:
+	/**
+	 * Constructor.
+	 * @param capacity	Maximum amount of pending jobs.
+	 */
+	SavingTaskQueue(int capacity);
+	/**
+	 * Executes the pending jobs and stops the background thread.
+	 */
+	~SavingTaskQueue();
+	/**
+	 * Queues the execution of @p tasks over @p tree. Blocks while the queue is full.
+	 * @param terminals	Amount of terminals of the snapshot.
+	 * @param tree	Snapshot of the tree. It is deleted by the queue.
+	 * @param tasks	Tasks to execute.
+	 */
+	void push(long long int terminals, AbstractObjectCCOTree *tree, vector<AbstractSavingTask *> &tasks);
+	/**
+	 * Blocks until all queued jobs are finished.
+	 */
+	void wait();
+};
+
+#endif /* SAVINGTASKQUEUE_H_ */
@@ -21,5 +21,7 @@ VisualizationSavingTask::~VisualizationSavingTask()
 }
 
 void VisualizationSavingTask::execute(long long int terminals, AbstractObjectCCOTree *tree){
-	nodalWriter->write(path+ "/" + prefix + to_string(terminals) + "_view.vtp",tree);
+	string filename = path+ "/" + prefix + to_string(terminals) + "_view.vtp";
+	nodalWriter->write(filename + ".tmp",tree);
+	commitFile(filename + ".tmp", filename);
 }
@@ -30,7 +30,8 @@ public:
 	virtual ~VisualizationSavingTask();
 
 	/**
-	 * Saves the tree in a visualization file using .vtk format.
+	 * Saves the tree in a visualization file using .vtk format. The file is written with a temporary name and then
+	 * renamed.
 	 */
 	void execute(long long int terminals, AbstractObjectCCOTree *tree);
 
@@ -39,6 +39,34 @@ long long int AbstractDomain::getPointCounter() const {
 	return pointCounter;
 }
 
+void AbstractDomain::returnRandomPoint(point p) {
+	getRandomInnerPoints().push_front(p);
+	--pointCounter;
+}
+
+void AbstractDomain::saveState(ostream &os) {
+	deque<point> &points = getRandomInnerPoints();
+	//	17 significant digits are enough to read back the same doubles
+	streamsize precision = os.precision(17);
+	os << pointCounter << " " << points.size() << endl;
+	for (deque<point>::iterator it = points.begin(); it != points.end(); ++it) {
+		os << it->p[0] << " " << it->p[1] << " " << it->p[2] << endl;
+	}
+	os.precision(precision);
+}
+
+void AbstractDomain::loadState(istream &is) {
+	deque<point> &points = getRandomInnerPoints();
+	size_t nPoints;
+	is >> pointCounter >> nPoints;
+	points.clear();
+	for (size_t i = 0; i < nPoints; ++i) {
+		point p;
+		is >> p.p[0] >> p.p[1] >> p.p[2];
+		points.push_back(p);
+	}
+}
+
 bool AbstractDomain::isIsConvexDomain() const {
 	return isConvexDomain;
 }
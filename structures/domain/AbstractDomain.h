@@ -11,6 +11,7 @@
 #define DOMAIN_ABSTRACTDOMAIN_H_
 
 #include <deque>
+#include <iostream>
 #include <random>
 
 #include <vtkSmartPointer.h>
@@ -125,6 +126,25 @@ public:
 	 * @return Set of inner domain points.
 	 */
 	virtual deque<point>& getRandomInnerPoints() = 0;
+	/**
+	 * Gives back the point @p p to the domain, so it is returned again by the next call to getRandomPoint. Points
+	 * must be given back in the reverse order in which they were obtained.
+	 * @param p	Point obtained from getRandomPoint.
+	 */
+	virtual void returnRandomPoint(point p);
+	/**
+	 * Writes the state of the point sampler, i.e. the amount of consumed points and the points drawn but not
+	 * consumed yet. Domains with their own random generator also write its state, so a domain restored with
+	 * loadState returns the same sequence of points than this one.
+	 * @param os	Output stream.
+	 */
+	virtual void saveState(ostream &os);
+	/**
+	 * Restores the state of the point sampler written by saveState. It replaces replaying the sampler when a
+	 * generation process is resumed.
+	 * @param is	Input stream.
+	 */
+	virtual void loadState(istream &is);
 	/**
 	 * Returns the vtkPolydata with the domain representation.
 	 * @return vtkPolydata with the domain representation.
@@ -39,3 +39,17 @@ vector<point> CompositeDistributionGenerator::getNPoints(int n){
 
 	return randomInnerPoints;
 }
+
+void CompositeDistributionGenerator::saveState(ostream &os){
+	DistributionGenerator::saveState(os);
+	for (std::vector<DistributionGenerator *>::iterator it = distributions.begin(); it != distributions.end(); ++it) {
+		(*it)->saveState(os);
+	}
+}
+
+void CompositeDistributionGenerator::loadState(istream &is){
+	DistributionGenerator::loadState(is);
+	for (std::vector<DistributionGenerator *>::iterator it = distributions.begin(); it != distributions.end(); ++it) {
+		(*it)->loadState(is);
+	}
+}
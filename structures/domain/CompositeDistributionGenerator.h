@@ -38,6 +38,16 @@ public:
 	 * @return Vector of distribution points.
 	 */
 	vector<point> getNPoints(int n);
+	/**
+	 * Writes the state of the random generator and of each composed generator.
+	 * @param os	Output stream.
+	 */
+	void saveState(ostream &os);
+	/**
+	 * Restores the state written by saveState.
+	 * @param is	Input stream.
+	 */
+	void loadState(istream &is);
 };
 
 #endif /* DOMAIN_COMPOSITEDISTRIBUTIONGENERATOR_H_ */
@@ -19,3 +19,11 @@ void DistributionGenerator::initialize(int seed, double* boundingBox){
 	this->boundingBox = boundingBox;
 	this->generator = mt19937(seed);
 }
+
+void DistributionGenerator::saveState(ostream &os){
+	os << generator << endl;
+}
+
+void DistributionGenerator::loadState(istream &is){
+	is >> generator;
+}
@@ -10,6 +10,7 @@
 #ifndef DOMAIN_DISTRIBUTIONGENERATOR_H_
 #define DOMAIN_DISTRIBUTIONGENERATOR_H_
 
+#include <iostream>
 #include <vector>
 #include <random>
 #include "../CCOCommonStructures.h"
@@ -42,6 +43,16 @@ public:
 	 * @return Vector of distribution points.
 	 */
 	virtual vector<point> getNPoints(int n) = 0;
+	/**
+	 * Writes the state of the random generator.
+	 * @param os	Output stream.
+	 */
+	virtual void saveState(ostream &os);
+	/**
+	 * Restores the state of the random generator written by saveState.
+	 * @param is	Input stream.
+	 */
+	virtual void loadState(istream &is);
 };
 
 #endif /* DOMAIN_DISTRIBUTIONGENERATOR_H_ */
@@ -343,6 +343,18 @@ int DomainNVR::getDraw()
 	return nDraw;
 }
 
+void DomainNVR::saveState(ostream &os)
+{
+	AbstractDomain::saveState(os);
+	os << generator << endl;
+}
+
+void DomainNVR::loadState(istream &is)
+{
+	AbstractDomain::loadState(is);
+	is >> generator;
+}
+
 deque<point>& DomainNVR::getRandomInnerPoints()
 {
 	return randomInnerPoints;
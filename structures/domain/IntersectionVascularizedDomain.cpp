@@ -279,6 +279,18 @@ int IntersectionVascularizedDomain::getDraw()
 	return nDraw;
 }
 
+void IntersectionVascularizedDomain::saveState(ostream &os)
+{
+	AbstractDomain::saveState(os);
+	os << generator << endl;
+}
+
+void IntersectionVascularizedDomain::loadState(istream &is)
+{
+	AbstractDomain::loadState(is);
+	is >> generator;
+}
+
 deque<point>& IntersectionVascularizedDomain::getRandomInnerPoints()
 {
 	return randomInnerPoints;
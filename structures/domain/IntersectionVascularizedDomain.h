@@ -112,6 +112,16 @@ public:
 	 * @return Point inside the domain.
 	 */
 	virtual point getRandomPoint();
+	/**
+	 * Writes the state of the point sampler, including the random generator state.
+	 * @param os	Output stream.
+	 */
+	void saveState(ostream &os);
+	/**
+	 * Restores the state of the point sampler written by saveState.
+	 * @param is	Input stream.
+	 */
+	void loadState(istream &is);
 	/**
 	 * Returns the locator used to test inside segments.
 	 * @return Locator used to test inside segments.
@@ -35,3 +35,13 @@ vector<point> NormalDistributionGenerator::getNPoints(int n){
 
 	return randomInnerPoints;
 }
+
+void NormalDistributionGenerator::saveState(ostream &os){
+	DistributionGenerator::saveState(os);
+	os << distX << endl << distY << endl << distZ << endl;
+}
+
+void NormalDistributionGenerator::loadState(istream &is){
+	DistributionGenerator::loadState(is);
+	is >> distX >> distY >> distZ;
+}
@@ -46,6 +46,16 @@ public:
 	 * @return Vector of distribution points.
 	 */
 	vector<point> getNPoints(int n);
+	/**
+	 * Writes the state of the random generator and of the distributions, which may keep a cached value.
+	 * @param os	Output stream.
+	 */
+	void saveState(ostream &os);
+	/**
+	 * Restores the state written by saveState.
+	 * @param is	Input stream.
+	 */
+	void loadState(istream &is);
 };
 
 #endif /* DOMAIN_NORMALDISTRIBUTIONGENERATOR_H_ */
@@ -326,6 +326,18 @@ int PartiallyVascularizedDomain::getDraw()
 	return nDraw;
 }
 
+void PartiallyVascularizedDomain::saveState(ostream &os)
+{
+	AbstractDomain::saveState(os);
+	os << generator << endl;
+}
+
+void PartiallyVascularizedDomain::loadState(istream &is)
+{
+	AbstractDomain::loadState(is);
+	is >> generator;
+}
+
 deque<point>& PartiallyVascularizedDomain::getRandomInnerPoints()
 {
 	return randomInnerPoints;
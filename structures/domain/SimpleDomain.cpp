@@ -239,6 +239,16 @@ int SimpleDomain::getDraw() {
 	return nDraw;
 }
 
+void SimpleDomain::saveState(ostream &os) {
+	AbstractDomain::saveState(os);
+	distribution->saveState(os);
+}
+
+void SimpleDomain::loadState(istream &is) {
+	AbstractDomain::loadState(is);
+	distribution->loadState(is);
+}
+
 deque<point>& SimpleDomain::getRandomInnerPoints() {
 	return randomInnerPoints;
 }
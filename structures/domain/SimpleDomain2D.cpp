@@ -246,6 +246,16 @@ int SimpleDomain2D::getDraw() {
 	return nDraw;
 }
 
+void SimpleDomain2D::saveState(ostream &os) {
+	AbstractDomain::saveState(os);
+	os << generator << endl;
+}
+
+void SimpleDomain2D::loadState(istream &is) {
+	AbstractDomain::loadState(is);
+	is >> generator;
+}
+
 deque<point>& SimpleDomain2D::getRandomInnerPoints() {
 	return randomInnerPoints;
 }
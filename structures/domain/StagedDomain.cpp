@@ -9,6 +9,8 @@
 
 #include "StagedDomain.h"
 
+#include <sstream>
+
 StagedDomain::StagedDomain() : AbstractDomain(NULL){
 	currentTerminals = 0;
 	terminalAtPrevStage = 0;
@@ -43,6 +45,10 @@ void StagedDomain::update(){
 	}
 }
 
+long long int StagedDomain::getStageRemainingTerminals(){
+	return terminalsPerStage[currentStage-initialStage] - currentTerminals + 1;
+}
+
 long long int StagedDomain::getTerminalsAfterGeneration(){
 	return terminalsPerStage.back();
 }
@@ -78,6 +84,67 @@ deque<point>& StagedDomain::getRandomInnerPoints(){
 	return domainStage[currentStage-initialStage]->getRandomInnerPoints();
 }
 
+void StagedDomain::returnRandomPoint(point p){
+	domainStage[currentStage-initialStage]->returnRandomPoint(p);
+}
+
+void StagedDomain::saveState(ostream &os){
+	//	Each stage is written with its absolute index, so a domain resumed from a later initial stage finds its own
+	os << "StagedDomain " << domainStage.size() << " " << initialStage << " " << currentStage << " " << currentTerminals << " "
+			<< terminalAtPrevStage << endl;
+	for (unsigned int i = 0; i < domainStage.size(); ++i) {
+		stringstream state;
+		domainStage[i]->saveState(state);
+		string stateData = state.str();
+		os << initialStage + i << " " << stateData.size() << endl;
+		os.write(stateData.data(), stateData.size());
+	}
+}
+
+void StagedDomain::loadState(istream &is){
+	string token;
+	unsigned int nStages = 0;
+	int savedInitialStage, savedStage;
+	long long int savedTerminals, savedTerminalAtPrevStage;
+	is >> token >> nStages >> savedInitialStage >> savedStage >> savedTerminals >> savedTerminalAtPrevStage;
+	if (token != "StagedDomain") {
+		cerr << "Invalid staged domain state." << endl;
+		return;
+	}
+	for (unsigned int i = 0; i < nStages; ++i) {
+		int stage;
+		size_t size;
+		is >> stage >> size;
+		is.get();
+		string stateData(size, '\0');
+		is.read(&stateData[0], size);
+		if (!is) {
+			cerr << "Truncated staged domain state." << endl;
+			return;
+		}
+		//	Stages before the initial one are not part of this domain
+		int index = stage - initialStage;
+		if (index >= 0 && index < (int) domainStage.size()) {
+			stringstream state(stateData);
+			domainStage[index]->loadState(state);
+		}
+	}
+
+	//	The terminal counters are only meaningful for a domain with the same stages
+	if (savedInitialStage != initialStage || nStages != domainStage.size()) {
+		return;
+	}
+	currentTerminals = savedTerminals;
+	terminalAtPrevStage = savedTerminalAtPrevStage;
+	if (savedStage != currentStage) {
+		currentStage = savedStage;
+		if(!domainStage[currentStage-initialStage]->getInstanceData()->resetsDLim)
+			domainStage[currentStage-initialStage]->getInstanceData()->dLimCorrectionFactor = instanceData->dLimCorrectionFactor;
+		instanceData = domainStage[currentStage-initialStage]->getInstanceData();
+		notifyObservers();
+	}
+}
+
 vtkSmartPointer<vtkPolyData>& StagedDomain::getVtkGeometry(){
 	return domainStage[currentStage-initialStage]->getVtkGeometry();
 }
@@ -49,6 +49,12 @@ public:
 	 * of a new terminal to the tree.
 	 */
 	void update();
+	/**
+	 * Returns the amount of terminals that can be added before the stage changes, including the terminal whose
+	 * update changes the stage.
+	 * @return Amount of terminals left in the current stage.
+	 */
+	long long int getStageRemainingTerminals();
 	/**
 	 * Returns the total amount of terminals that will be generated along all stages.
 	 * @return Total amount of terminals generated along all stages.
@@ -112,6 +118,25 @@ public:
 	 * @return Set of inner domain points.
 	 */
 	deque<point>& getRandomInnerPoints();
+	/**
+	 * Gives back the point @p p to the domain of the current stage.
+	 * @param p	Point obtained from getRandomPoint.
+	 */
+	void returnRandomPoint(point p);
+	/**
+	 * Writes the current stage, the terminal counters and the state of the point sampler of the domain of every
+	 * stage, each one with its stage index.
+	 * @param os	Output stream.
+	 */
+	void saveState(ostream &os);
+	/**
+	 * Restores the state of the point sampler of the domain of every stage written by saveState. States of stages
+	 * before the initial stage of this domain (see setInitialStage) are skipped. If this domain has the same stages
+	 * as the saved one, the current stage and the terminal counters are also restored and the observers are
+	 * notified of a stage change.
+	 * @param is	Input stream.
+	 */
+	void loadState(istream &is);
 	/**
 	 * Returns the quantity of points that have been consumed.
 	 * @return Quantity of points consumed.
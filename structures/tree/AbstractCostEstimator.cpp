@@ -9,8 +9,21 @@
 
 #include "AbstractCostEstimator.h"
 
+#include <cmath>
+
 AbstractCostEstimator::AbstractCostEstimator(){
 }
 
 AbstractCostEstimator::~AbstractCostEstimator(){
 }
+
+void AbstractCostEstimator::updateParentRadius(double /*parentRadius*/){
+}
+
+double AbstractCostEstimator::computeVariationCost(double /*volumeVariation*/){
+	return NAN;
+}
+
+double AbstractCostEstimator::computeLowerBound(AbstractVascularElement */*parent*/, double /*parentRadius*/, point /*iNew*/, double /*volumeVariationBound*/){
+	return -INFINITY;
+}
@@ -41,6 +41,12 @@ public:
 	 * @param dLim	Minimum radius distance from the new vessel to the tree.
 	 */
 	virtual void previousState(AbstractObjectCCOTree *tree, AbstractVascularElement *parent, point iNew, point iTest, double dLim) = 0;
+	/**
+	 * Replaces the radius of the parent taken by previousState when the radius stored at the parent may be outdated
+	 * (e.g. with the incremental update of SingleVesselCCOOTree). Estimators that do not use it ignore it.
+	 * @param parentRadius	Current radius of the parent.
+	 */
+	virtual void updateParentRadius(double parentRadius);
 
 	/**
 	 * Computes the functional cost of the given tree.
@@ -48,6 +54,24 @@ public:
 	 * @return Cost of the given tree.
 	 */
 	virtual double computeCost(AbstractObjectCCOTree *tree) = 0;
+	/**
+	 * Computes the functional cost of a tree whose volume changed by @p volumeVariation since previousState. It is
+	 * used by the evaluations that do not build the tree at the current step. The default implementation returns NAN,
+	 * so these evaluations fall back to the cost of the copied tree.
+	 * @param volumeVariation	Volume variation of the tree at the current step.
+	 * @return Cost of the tree.
+	 */
+	virtual double computeVariationCost(double volumeVariation);
+	/**
+	 * Returns a lower bound of the cost of connecting @p iNew to @p parent that is computed before evaluating the
+	 * candidate. It must not modify the estimator, which is shared among threads.
+	 * @param parent	Vascular element where the new vessel will be connected.
+	 * @param parentRadius	Current radius of @p parent.
+	 * @param iNew	Distal position of the new vessel.
+	 * @param volumeVariationBound	Lower bound of the tree volume variation due to the new vessel.
+	 * @return Lower bound of the cost (-INFINITY if the estimator has no bound).
+	 */
+	virtual double computeLowerBound(AbstractVascularElement *parent, double parentRadius, point iNew, double volumeVariationBound);
 	/**
 	 * Virtual method to be used by StagedFRROTreeGeneratorLogger
 	 */	 
@@ -8,6 +8,7 @@
  */
 
 #include "AbstractObjectCCOTree.h"
+#include "TreeTraversal.h"
 
 #include <vtkCellData.h>
 #include <vtkPointData.h>
@@ -18,6 +19,8 @@
 #include <vtkSmartPointer.h>
 #include <vtkDoubleArray.h>
 
+#include <algorithm>
+
 AbstractObjectCCOTree::AbstractObjectCCOTree(GeneratorData *instanceData) {
 
 	this->instanceData = instanceData;
@@ -40,10 +43,13 @@ AbstractObjectCCOTree::AbstractObjectCCOTree(GeneratorData *instanceData) {
 	this->nTerms = 0;
 
 	this->vtkTree = vtkSmartPointer<vtkPolyData>::New();
-	this->vtkTreeLocator = vtkSmartPointer<vtkCellLocator>::New();
 
 	this->currentStage = 0;
 	this->isInCm = 0;
+	this->isLazyVtk = 0;
+	this->isVtkTreeOutdated = 0;
+	this->isSegmentIndexOutdated = 0;
+	this->nextSegmentId = 0;
 
 }
 
@@ -62,6 +68,9 @@ AbstractObjectCCOTree::AbstractObjectCCOTree(point xi, double qi, AbstractConstr
 	this->gam = gam;
 	this->epsLim = epsLim;
 	this->nu = nu;
+	this->gamTable.compile(gam);
+	this->epsLimTable.compile(epsLim);
+	this->nuTable.compile(nu);
 	this->refPressure = refPressure;
 
 	this->psiFactor = 0.0;
@@ -71,10 +80,13 @@ AbstractObjectCCOTree::AbstractObjectCCOTree(point xi, double qi, AbstractConstr
 	this->root = NULL;
 
 	this->vtkTree = vtkSmartPointer<vtkPolyData>::New();
-	this->vtkTreeLocator = vtkSmartPointer<vtkCellLocator>::New();
 
 	this->currentStage = 0;
 	this->isInCm = 0;
+	this->isLazyVtk = 0;
+	this->isVtkTreeOutdated = 0;
+	this->isSegmentIndexOutdated = 0;
+	this->nextSegmentId = 0;
 }
 
 AbstractObjectCCOTree::~AbstractObjectCCOTree() {
@@ -109,6 +121,9 @@ unordered_map<long long, AbstractVascularElement*>& AbstractObjectCCOTree::getSe
 }
 
 vtkSmartPointer<vtkPolyData> AbstractObjectCCOTree::getVtkTree() {
+	if (isVtkTreeOutdated) {
+		buildVtkTree();
+	}
 	return vtkTree;
 }
 
@@ -116,7 +131,7 @@ point AbstractObjectCCOTree::getXProx() {
 	return xPerf;
 }
 
-void AbstractObjectCCOTree::save(string filename) {
+int AbstractObjectCCOTree::save(string filename) {
 	ofstream treeFile;
 
 	treeFile.open(filename.c_str(), ios::out);
@@ -137,6 +152,18 @@ void AbstractObjectCCOTree::save(string filename) {
 
 	treeFile.flush();
 	treeFile.close();
+	return !treeFile.fail();
+}
+
+AbstractObjectCCOTree *AbstractObjectCCOTree::snapshot() {
+	return NULL;
+}
+
+void AbstractObjectCCOTree::updateDeferredValues() {
+}
+
+double *AbstractObjectCCOTree::getCloseNeighborhood(point xNew, AbstractDomain *domain) {
+	return domain->getLocalNeighborhood(xNew, nTerms);
 }
 
 void AbstractObjectCCOTree::saveVessels(AbstractVascularElement * root, ofstream *treeFile){
@@ -175,14 +202,17 @@ double AbstractObjectCCOTree::getDp() const {
 
 void AbstractObjectCCOTree::setEpsLim(AbstractConstraintFunction<double, int> *epsLim) {
 	this->epsLim = epsLim;
+	this->epsLimTable.compile(epsLim);
 }
 
 void AbstractObjectCCOTree::setGam(AbstractConstraintFunction<double, int> *gam) {
 	this->gam = gam;
+	this->gamTable.compile(gam);
 }
 
 void AbstractObjectCCOTree::setNu(AbstractConstraintFunction<double, int> *nu) {
 	this->nu = nu;
+	this->nuTable.compile(nu);
 }
 
 long long int AbstractObjectCCOTree::getPointCounter() const {
@@ -202,38 +232,33 @@ long long int AbstractObjectCCOTree::getNTerminals() {
 }
 
 long long int AbstractObjectCCOTree::countTerminals(AbstractVascularElement* root) {
-	long long int childrenTerminals = 0l;
-	for (std::vector<AbstractVascularElement *>::iterator it = root->getChildren().begin(); it != root->getChildren().end(); ++it) {
-		childrenTerminals += countTerminals(*it);
-	}
-	return root->getTerminals() + childrenTerminals;
+	return TreeTraversal::sum<long long int>(root, [](AbstractVascularElement *element) {
+		return element->getTerminals();
+	});
 }
 
 long long int AbstractObjectCCOTree::countTerminals(AbstractVascularElement* root, AbstractVascularElement::TERMINAL_TYPE type) {
-	long long int childrenTerminals = 0l;
-	for (std::vector<AbstractVascularElement *>::iterator it = root->getChildren().begin(); it != root->getChildren().end(); ++it) {
-		childrenTerminals += countTerminals(*it, type);
+	return TreeTraversal::sum<long long int>(root, [type](AbstractVascularElement *element) {
+		return element->getTerminals(type);
+	});
+}
+
+void AbstractObjectCCOTree::addVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents, AbstractVascularElement::VESSEL_FUNCTION vesselFunction) {
+	for (unsigned i = 0; i < parents.size(); ++i) {
+		addVessel(xProxs[i], xDists[i], parents[i], vesselFunction);
 	}
-	return root->getTerminals(type) + childrenTerminals;
 }
 
 double AbstractObjectCCOTree::computeTreeCost(AbstractVascularElement* root) {
-
-	double currentCost = ((SingleVessel *) root)->getVolume();
-	vector<AbstractVascularElement *> children = root->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
-		currentCost += computeTreeCost(*it);
-	}
-	return currentCost;
+	return TreeTraversal::sum<double>(root, [](AbstractVascularElement *element) {
+		return ((SingleVessel *) element)->getVolume();
+	});
 }
 
 void AbstractObjectCCOTree::computePressure(AbstractVascularElement* root) {
-
-	vector<AbstractVascularElement *> children = root->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = root->getChildren().begin(); it != root->getChildren().end(); ++it) {
-		computePressure(*it);
-	}
-	root->updatePressure();
+	TreeTraversal::postOrder(root, [](AbstractVascularElement *element) {
+		element->updatePressure();
+	});
 //
 //	if (root->anastomose.size() > 1) {
 //		computePressure(root->anastomose[1]);
@@ -247,6 +272,10 @@ void AbstractObjectCCOTree::computePressure(AbstractVascularElement* root) {
 }
 
 void AbstractObjectCCOTree::updateSegmentVtkLines() {
+	if (isVtkTreeOutdated) {
+		buildVtkTree();
+		return;
+	}
 	vtkTree->GetLines()->InitTraversal();
 	for (auto it = elements.begin(); it != elements.end(); ++it) {
 		for (auto it2 = (it->second)->getVessels().begin(); it2 != (it->second)->getVessels().end(); ++it2) {
@@ -261,6 +290,10 @@ void AbstractObjectCCOTree::updateSegmentVtkLines() {
 
 void AbstractObjectCCOTree::printVtkTree() {
 
+	if (isVtkTreeOutdated) {
+		buildVtkTree();
+	}
+
 	vtkTree->BuildCells();
 	int numLines = vtkTree->GetNumberOfLines();
 	int numPoints = vtkTree->GetNumberOfPoints();
@@ -319,6 +352,9 @@ long long int AbstractObjectCCOTree::getNTerminals(AbstractVascularElement::TERM
 
 vector<vector<double> > AbstractObjectCCOTree::getVertices() {
 	vector<vector<double> > points;
+	if (isVtkTreeOutdated) {
+		buildVtkTree();
+	}
 	vtkSmartPointer<vtkPoints> vtkPointsData = vtkTree->GetPoints(); // Points
 	for (unsigned int i = 0; i < vtkPointsData->GetNumberOfPoints(); ++i) {
 		vector<double> point;
@@ -335,6 +371,9 @@ vector<vector<double> > AbstractObjectCCOTree::getVertices() {
 
 vector<vector<int> > AbstractObjectCCOTree::getConnectivity() {
 	vector<vector<int> > lines;
+	if (isVtkTreeOutdated) {
+		buildVtkTree();
+	}
 	for (auto it = elements.begin(); it != elements.end(); ++it) {
 		for (vector<SingleVessel *>::iterator it2 = (it->second)->getVessels().begin(); it2 != (it->second)->getVessels().end(); ++it2) {
 			SingleVessel *currentSegment = *it2;
@@ -369,3 +408,81 @@ void AbstractObjectCCOTree::setIsInCm(int isInCm)
 		{
 	this->isInCm = isInCm;
 }
+
+int AbstractObjectCCOTree::getIsLazyVtk() const
+{
+	return isLazyVtk;
+}
+
+void AbstractObjectCCOTree::setIsLazyVtk(int isLazyVtk)
+{
+	if (isLazyVtk && !this->isLazyVtk) {
+		//	Continue numbering after the vessels already in the tree
+		nextSegmentId = 0;
+		for (auto it = elements.begin(); it != elements.end(); ++it) {
+			if (it->first >= nextSegmentId) {
+				nextSegmentId = it->first + 1;
+			}
+		}
+	} else if (!isLazyVtk && isVtkTreeOutdated) {
+		//	Eager insertions append cells to the current vtkTree
+		buildVtkTree();
+	}
+	this->isLazyVtk = isLazyVtk;
+}
+
+vtkIdType AbstractObjectCCOTree::reserveSegmentId() {
+	isVtkTreeOutdated = 1;
+	return nextSegmentId++;
+}
+
+void AbstractObjectCCOTree::buildVtkTree() {
+	vector<SingleVessel *> vessels = getVessels();
+	sort(vessels.begin(), vessels.end(), [](SingleVessel *a, SingleVessel *b) {
+		return a->vtkSegmentId < b->vtkSegmentId;
+	});
+	long long int nVessels = (long long int) vessels.size();
+
+	//	Cell ids must match vtkSegmentId, so IDs released by removed vessels are compacted
+	if (nVessels > 0 && vessels[nVessels - 1]->vtkSegmentId != nVessels - 1) {
+		elements.clear();
+		segmentIndex.clear();
+		for (long long int i = 0; i < nVessels; ++i) {
+			vessels[i]->vtkSegmentId = i;
+			elements[i] = vessels[i];
+			segmentIndex.insert(i, vessels[i]->xProx, vessels[i]->xDist);
+		}
+		isSegmentIndexOutdated = 0;
+	}
+
+	vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+	vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+
+	//	Distal points first, so proximal points can be shared with the parent distal point
+	vector<vtkIdType> idDist(nVessels);
+	for (long long int i = 0; i < nVessels; ++i) {
+		idDist[i] = pts->InsertNextPoint(vessels[i]->xDist.p);
+	}
+	for (long long int i = 0; i < nVessels; ++i) {
+		SingleVessel *currentVessel = vessels[i];
+		vtkIdType idProx;
+		if (currentVessel->parent) {
+			idProx = idDist[((SingleVessel *) currentVessel->parent)->vtkSegmentId];
+		} else {
+			idProx = pts->InsertNextPoint(currentVessel->xProx.p);
+		}
+		currentVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
+		currentVessel->vtkSegment->GetPointIds()->SetId(0, idProx);
+		currentVessel->vtkSegment->GetPointIds()->SetId(1, idDist[i]);
+		lines->InsertNextCell(currentVessel->vtkSegment);
+	}
+
+	vtkTree = vtkSmartPointer<vtkPolyData>::New();
+	vtkTree->SetPoints(pts);
+	vtkTree->SetLines(lines);
+	vtkTree->BuildCells();
+	vtkTree->Modified();
+
+	nextSegmentId = nVessels;
+	isVtkTreeOutdated = 0;
+}
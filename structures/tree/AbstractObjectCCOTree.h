@@ -15,10 +15,11 @@
 #include "../vascularElements/SingleVessel.h"
 #include "../domain/AbstractDomain.h"
 #include "../../constrains/AbstractConstraintFunction.h"
+#include "../../constrains/ConstraintTable.h"
 #include "../../core/GeneratorData.h"
+#include "SegmentAABBTree.h"
 
 #include <vtkPolyData.h>
-#include <vtkCellLocator.h>
 #include <vtkLine.h>
 #include <vtkSmartPointer.h>
 
@@ -51,6 +52,12 @@ protected:
 	AbstractConstraintFunction<double, int> *epsLim;
 	/** Constraint for the vessel viscosity. */
 	AbstractConstraintFunction<double, int> *nu;
+	/** Values of @p gam for each level, compiled when @p gam is set. */
+	ConstraintTable<double> gamTable;
+	/** Values of @p epsLim for each level, compiled when @p epsLim is set. */
+	ConstraintTable<double> epsLimTable;
+	/** Values of @p nu for each level, compiled when @p nu is set. */
+	ConstraintTable<double> nuTable;
 	/** Distal reference pressure of the tree. */
 	double refPressure;
 	/**	Tree root. */
@@ -64,8 +71,8 @@ protected:
 
 	/**	VTK representation of the tree. */
 	vtkSmartPointer<vtkPolyData> vtkTree;
-	/**	VTK locator for the tree. */
-	vtkSmartPointer<vtkCellLocator> vtkTreeLocator;
+	/**	Spatial index of the tree segments keyed by their @p vtkSegmentId. */
+	SegmentAABBTree segmentIndex;
 	/**	Vascular elements (vessels or set of vessels) of the tree. */
 	unordered_map<long long, AbstractVascularElement *> elements;
 
@@ -75,6 +82,14 @@ protected:
 	int currentStage;
 	/**	If the tree is in cm, otherwise is assumed that is in mm (default) */
 	int isInCm;
+	/**	If @p vtkTree is built on demand instead of being updated at each insertion. */
+	int isLazyVtk;
+	/**	If @p vtkTree does not reflect the current vessels and must be rebuilt before use. */
+	int isVtkTreeOutdated;
+	/**	If @p segmentIndex does not hold the current vessels and must be rebuilt before use (e.g. after loading). */
+	int isSegmentIndexOutdated;
+	/**	Next @p vtkSegmentId assigned to a vessel while @p isLazyVtk is set. */
+	vtkIdType nextSegmentId;
 
 	friend class PruningCCOOTree;
 
@@ -116,6 +131,13 @@ public:
 	 * @return	Array of segments in the neighborhood of @p xNew.
 	 */
 	virtual vector<AbstractVascularElement *> getCloseSegments(point xNew, AbstractDomain *domain, int *nFound) = 0;
+	/**
+	 * Returns the box searched by getCloseSegments around @p xNew.
+	 * @param xNew	Center point of the neighborhood of interest.
+	 * @param domain	Domain of the segments.
+	 * @return	Box as {xMin, xMax, yMin, yMax, zMin, zMax}, to be deleted by the caller.
+	 */
+	virtual double *getCloseNeighborhood(point xNew, AbstractDomain *domain);
 	/**
 	 * Adds a new vessel to the CCO tree. @param xProx and @param xDist are the proximal and distal nodes of the new
 	 * vessel and @param parent is the attachment parent vessel.
@@ -124,6 +146,16 @@ public:
 	 * @param parent	Parent to the new vessel.
 	 */
 	virtual void addVessel(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction) = 0;
+	/**
+	 * Adds the vessels @p xProxs[i] - @p xDists[i] attached to @p parents[i] in order. Parents must be different
+	 * vessels and none of them can be split by the addition of a previous vessel of the list. Implementations may
+	 * update the tree hemodynamics once for the whole list.
+	 * @param xProxs	Proximal points of the new vessels.
+	 * @param xDists	Distal points of the new vessels.
+	 * @param parents	Parents of the new vessels.
+	 * @param vesselFunction	Function of the new vessels.
+	 */
+	virtual void addVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents, AbstractVascularElement::VESSEL_FUNCTION vesselFunction);
 	/**
 	 * For a given spatial point @p xNew test its connection with @p parent vessel. It must evaluate if the restrictions
 	 * of geometry and symmetry are satisfied and also if it do not intersects with other vessel of this tree. It returns
@@ -138,6 +170,26 @@ public:
 	 * @return	If the connection of the tree with xNew is possible. If not @p cost is INFINITY.
 	 */
 	virtual int testVessel(point xNew, AbstractVascularElement *parent, AbstractDomain *domain, vector<AbstractVascularElement *> neighbors, double dlim, point *xBif, double *cost) = 0;
+	/**
+	 * Tests the connection of @p xNew with @p parent at the bifurcation point @p xBif, one of the branching points of
+	 * @p parent. It checks the same restrictions as testVessel for a single bifurcation point.
+	 * @param xNew	Distal point for the new vessel to test.
+	 * @param parent	Parent vessel to test the @p xNew point connection.
+	 * @param xBif	Proximal point for the new vessel.
+	 * @param domain	Tree domain.
+	 * @param neighbors	Close neighbors used for intersection test.
+	 * @param dlim	Not used in the current implementation.
+	 * @return	Functional cost variation, INFINITY if the connection is not possible.
+	 */
+	virtual double testBifurcation(point xNew, AbstractVascularElement *parent, point xBif, AbstractDomain *domain, vector<AbstractVascularElement *> &neighbors, double dlim) = 0;
+	/**
+	 * Returns a lower bound of the cost returned by testBifurcation for @p xNew and @p parent at any of its
+	 * bifurcation points. It is computed without evaluating the candidate.
+	 * @param xNew	Distal point for the new vessel to test.
+	 * @param parent	Parent vessel to test the @p xNew point connection.
+	 * @return	Lower bound of the cost (-INFINITY if no bound is known).
+	 */
+	virtual double getCostLowerBound(point xNew, AbstractVascularElement *parent) = 0;
 	/**
 	 * Computes the pressure for the whole tree for a given reference pressure P_r (default P_r=0 Pa).
 	 * @param root	Tree root.
@@ -156,8 +208,21 @@ public:
 	/**
 	 * Saves the tree data with exception of the vtk objects.
 	 * @param filename	File to save the tree data.
+	 * @return	1 if the file was completely written, 0 otherwise.
+	 */
+	virtual int save(string filename);
+	/**
+	 * Returns a copy of the tree with all the data written by save, so it can be saved while this tree keeps
+	 * changing. Trees that can not be copied return NULL.
+	 * @return	Copy of the tree or NULL.
 	 */
-	virtual void save(string filename);
+	virtual AbstractObjectCCOTree *snapshot();
+	/**
+	 * Brings the values of every vessel up to date in trees that defer part of their updates (e.g. the incremental
+	 * update of SingleVesselCCOOTree). Since it modifies the tree, neither save nor the writers call it: callers that
+	 * need up to date values call it before writing (StagedFRROTreeGenerator does it at each save point).
+	 */
+	virtual void updateDeferredValues();
 	/**
 	 * Returns the name of the tree class that implements the AbstractCCOTree.
 	 * @return Tree class name.
@@ -272,6 +337,11 @@ public:
 	 * @return @p isInCm
 	 */
 	int getIsInCm() const;
+	/**
+	 * Getter of @p isLazyVtk.
+	 * @return @p isLazyVtk
+	 */
+	int getIsLazyVtk() const;
 
 	/**
 	 * Setter of @p epsLim.
@@ -313,6 +383,13 @@ public:
 	 * @param isInCm.
 	 */
 	void setIsInCm(int isInCm);
+	/**
+	 * Setter of @p isLazyVtk. When set, insertions only assign a @p vtkSegmentId to the new vessels and
+	 * @p vtkTree together with the @p vtkSegment of each vessel are rebuilt in a single pass the next time
+	 * they are requested (e.g. by a writer through getVtkTree()).
+	 * @param isLazyVtk.
+	 */
+	void setIsLazyVtk(int isLazyVtk);
 
 protected:
 	/**
@@ -331,6 +408,16 @@ protected:
 	 * the current @p vtkTree.
 	 */
 	void updateSegmentVtkLines();
+	/**
+	 * Rebuilds @p vtkTree and the @p vtkSegment of each vessel from the current vessels. Cells are
+	 * created in @p vtkSegmentId order, compacting the IDs left by removed vessels if any.
+	 */
+	void buildVtkTree();
+	/**
+	 * Returns the @p vtkSegmentId for a new vessel when @p isLazyVtk is set and flags @p vtkTree as outdated.
+	 * @return	Segment ID for the new vessel.
+	 */
+	vtkIdType reserveSegmentId();
 	/**
 	 * Counts recursively all terminals of the subtree with @p root as root.
 	 * @param root Root of the subtree.
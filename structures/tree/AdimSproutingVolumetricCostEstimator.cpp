@@ -8,6 +8,7 @@
  */
 
 #include "AdimSproutingVolumetricCostEstimator.h"
+#include "TreeTraversal.h"
 #include "../vascularElements/SingleVessel.h"
 #include <math.h>
 
@@ -29,6 +30,45 @@ AdimSproutingVolumetricCostEstimator::~AdimSproutingVolumetricCostEstimator(){
 void AdimSproutingVolumetricCostEstimator::previousState(AbstractObjectCCOTree* tree, AbstractVascularElement* parent, point iNew, point iTest, double dLim){
 	previousVolume = ((SingleVessel *) tree->getRoot())->treeVolume;
 
+	distToParent = computeDistToParent(parent, iNew);
+
+	parentRadius = ((SingleVessel *)parent)->radius;
+
+	this->dLim = dLim;
+	this->bifLevel = ((SingleVessel *)parent)->nLevel;
+}
+
+void AdimSproutingVolumetricCostEstimator::updateParentRadius(double parentRadius){
+	this->parentRadius = parentRadius;
+}
+
+double AdimSproutingVolumetricCostEstimator::computeCost(AbstractObjectCCOTree* tree){
+	double volCost = volumeFactor * (computeTreeCost(tree->getRoot()) - previousVolume) / volumeRef;
+	double proteolysisCost = proteolyticFactor * parentRadius / radiusRef; // 500.0
+	double parentLengthRatio = distToParent / lengthRef;
+	double stimulusCost = diffusionFactor * parentLengthRatio * parentLengthRatio;
+//	cout << "Volume ref = " << volumeRef << " - Radius ref = " << radiusRef << " - Length ref = " << lengthRef << endl;
+//	cout << "Volumetric cost = " << volCost << ", Protease degradation cost = " << proteolysisCost << ", VEGF/FGF difussion cost = " << stimulusCost << endl;
+	return volCost + proteolysisCost + stimulusCost ;
+}
+
+double AdimSproutingVolumetricCostEstimator::computeVariationCost(double volumeVariation){
+	double volCost = volumeFactor * volumeVariation / volumeRef;
+	double proteolysisCost = proteolyticFactor * parentRadius / radiusRef;
+	double parentLengthRatio = distToParent / lengthRef;
+	double stimulusCost = diffusionFactor * parentLengthRatio * parentLengthRatio;
+	return volCost + proteolysisCost + stimulusCost ;
+}
+
+double AdimSproutingVolumetricCostEstimator::computeLowerBound(AbstractVascularElement *parent, double parentRadius, point iNew, double volumeVariationBound){
+	double volCost = volumeFactor * volumeVariationBound / volumeRef;
+	double proteolysisCost = proteolyticFactor * parentRadius / radiusRef;
+	double parentLengthRatio = computeDistToParent(parent, iNew) / lengthRef;
+	double stimulusCost = diffusionFactor * parentLengthRatio * parentLengthRatio;
+	return volCost + proteolysisCost + stimulusCost;
+}
+
+double AdimSproutingVolumetricCostEstimator::computeDistToParent(AbstractVascularElement *parent, point iNew){
 	point a = ((SingleVessel *)parent)->xProx;
 	point b = ((SingleVessel *)parent)->xDist;
 	//	Parent-to-iNew distance
@@ -45,31 +85,13 @@ void AdimSproutingVolumetricCostEstimator::previousState(AbstractObjectCCOTree*
 	}
 	//	Closest segment between iNew and parent vessel
 	point proj = (iNew - a) - m * t;
-	distToParent = sqrt(proj ^ proj);
-
-	parentRadius = ((SingleVessel *)parent)->radius;
-
-	this->dLim = dLim;
-	this->bifLevel = ((SingleVessel *)parent)->nLevel;
-}
-
-double AdimSproutingVolumetricCostEstimator::computeCost(AbstractObjectCCOTree* tree){
-	double volCost = volumeFactor * (computeTreeCost(tree->getRoot()) - previousVolume) / volumeRef;
-	double proteolysisCost = proteolyticFactor * parentRadius / radiusRef; // 500.0
-	double parentLengthRatio = distToParent / lengthRef;
-	double stimulusCost = diffusionFactor * parentLengthRatio * parentLengthRatio;
-//	cout << "Volume ref = " << volumeRef << " - Radius ref = " << radiusRef << " - Length ref = " << lengthRef << endl;
-//	cout << "Volumetric cost = " << volCost << ", Protease degradation cost = " << proteolysisCost << ", VEGF/FGF difussion cost = " << stimulusCost << endl;
-	return volCost + proteolysisCost + stimulusCost ;
+	return sqrt(proj ^ proj);
 }
 
 double AdimSproutingVolumetricCostEstimator::computeTreeCost(AbstractVascularElement* root) {
-	double currentCost = ((SingleVessel *)root)->getVolume();
-	vector<AbstractVascularElement *> children = root->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
-		currentCost += computeTreeCost(*it);
-	}
-	return currentCost;
+	return TreeTraversal::sum<double>(root, [](AbstractVascularElement *element) {
+		return ((SingleVessel *) element)->getVolume();
+	});
 }
 
 AbstractCostEstimator* AdimSproutingVolumetricCostEstimator::clone(){
@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * BinaryTreeFormat.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "BinaryTreeFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkZLibDataCompressor.h>
+
+const uint32_t BinaryTreeFormat::VERSION;
+const uint32_t BinaryTreeFormat::COMPRESSED;
+const size_t BinaryTreeFormat::BLOCK_SIZE;
+
+namespace {
+	const char MAGIC[8] = "VItACCB";
+
+	int hasExtension(string filename, string extension) {
+		return filename.size() >= extension.size()
+				&& filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+	}
+}
+
+int BinaryTreeFormat::isBinaryFilename(string filename) {
+	return hasExtension(filename, ".ccb") || hasExtension(filename, ".ccbz");
+}
+
+int BinaryTreeFormat::isCompressedFilename(string filename) {
+	return hasExtension(filename, ".ccbz");
+}
+
+size_t BinaryTreeFormat::getPayloadSize(int64_t nVessels, int64_t nChildren) {
+	return nVessels * sizeof(VesselRecord) + (2 * nVessels + 1 + nChildren) * sizeof(int64_t);
+}
+
+int BinaryTreeFormat::write(string filename, Header &header, vector<char> &payload) {
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.payloadSize = payload.size();
+	header.nBlocks = 0;
+
+	ofstream file(filename.c_str(), ios::out | ios::binary);
+	if (!file) {
+		cerr << "Could not open " << filename << endl;
+		return 0;
+	}
+
+	if (!(header.flags & COMPRESSED)) {
+		file.write((char *) &header, sizeof(Header));
+		file.write(payload.data(), payload.size());
+		file.close();
+		return !file.fail();
+	}
+
+	vtkSmartPointer<vtkZLibDataCompressor> compressor = vtkSmartPointer<vtkZLibDataCompressor>::New();
+	header.nBlocks = (payload.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	vector<int64_t> blockSizes(2 * header.nBlocks);
+	vector<vtkUnsignedCharArray *> blocks(header.nBlocks);
+	for (int64_t i = 0; i < header.nBlocks; ++i) {
+		size_t begin = i * BLOCK_SIZE;
+		size_t size = min(BLOCK_SIZE, payload.size() - begin);
+		blocks[i] = compressor->Compress((unsigned char *) payload.data() + begin, size);
+		blockSizes[2 * i] = blocks[i]->GetNumberOfTuples();
+		blockSizes[2 * i + 1] = size;
+	}
+
+	file.write((char *) &header, sizeof(Header));
+	file.write((char *) blockSizes.data(), blockSizes.size() * sizeof(int64_t));
+	for (int64_t i = 0; i < header.nBlocks; ++i) {
+		file.write((char *) blocks[i]->GetPointer(0), blockSizes[2 * i]);
+		blocks[i]->Delete();
+	}
+	file.close();
+	return !file.fail();
+}
+
+BinaryTreeFormat::BinaryTreeFormat(string filename) {
+	this->mapping = NULL;
+	this->mappingSize = 0;
+	this->payload = NULL;
+	memset(&header, 0, sizeof(Header));
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		cerr << "Could not open " << filename << endl;
+		return;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(Header)) {
+		cerr << filename << " is not a binary tree file" << endl;
+		close(fd);
+		return;
+	}
+	mappingSize = fileStat.st_size;
+	mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		cerr << "Could not map " << filename << endl;
+		mapping = NULL;
+		return;
+	}
+
+	const char *data = (const char *) mapping;
+	memcpy(&header, data, sizeof(Header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version > VERSION || header.nVessels < 0
+			|| header.nChildren < 0 || header.payloadSize < 0 || header.nBlocks < 0
+			|| header.nVessels > header.payloadSize / (int64_t) sizeof(VesselRecord)
+			|| header.nChildren > header.payloadSize / (int64_t) sizeof(int64_t)
+			|| (size_t) header.payloadSize != getPayloadSize(header.nVessels, header.nChildren)) {
+		cerr << filename << " is not a supported binary tree file" << endl;
+		return;
+	}
+
+	if (!(header.flags & COMPRESSED)) {
+		if (mappingSize < sizeof(Header) + header.payloadSize) {
+			cerr << filename << " is truncated" << endl;
+			return;
+		}
+		if (!hasValidIndexes(data + sizeof(Header))) {
+			cerr << filename << " is corrupted" << endl;
+			return;
+		}
+		payload = data + sizeof(Header);
+		return;
+	}
+
+	//	The block table and the blocks must be in the file and add up to the payload
+	if ((size_t) header.nBlocks != (header.payloadSize + BLOCK_SIZE - 1) / BLOCK_SIZE
+			|| (mappingSize - sizeof(Header)) / (2 * sizeof(int64_t)) < (size_t) header.nBlocks) {
+		cerr << filename << " is truncated" << endl;
+		return;
+	}
+	const int64_t *blockSizes = (const int64_t *) (data + sizeof(Header));
+	size_t offset = sizeof(Header) + 2 * header.nBlocks * sizeof(int64_t);
+	size_t uncompressedSize = 0;
+	for (int64_t i = 0; i < header.nBlocks; ++i) {
+		if (blockSizes[2 * i] < 0 || blockSizes[2 * i + 1] < 0 || (size_t) blockSizes[2 * i + 1] > BLOCK_SIZE
+				|| (size_t) blockSizes[2 * i] > mappingSize - offset) {
+			cerr << filename << " is corrupted" << endl;
+			return;
+		}
+		offset += blockSizes[2 * i];
+		uncompressedSize += blockSizes[2 * i + 1];
+	}
+	if (uncompressedSize != (size_t) header.payloadSize) {
+		cerr << filename << " is corrupted" << endl;
+		return;
+	}
+
+	offset = sizeof(Header) + 2 * header.nBlocks * sizeof(int64_t);
+	vtkSmartPointer<vtkZLibDataCompressor> compressor = vtkSmartPointer<vtkZLibDataCompressor>::New();
+	buffer.resize(header.payloadSize);
+	size_t uncompressed = 0;
+	for (int64_t i = 0; i < header.nBlocks; ++i) {
+		if (compressor->Uncompress((const unsigned char *) data + offset, blockSizes[2 * i],
+				(unsigned char *) buffer.data() + uncompressed, blockSizes[2 * i + 1]) != (size_t) blockSizes[2 * i + 1]) {
+			cerr << filename << " is corrupted" << endl;
+			return;
+		}
+		offset += blockSizes[2 * i];
+		uncompressed += blockSizes[2 * i + 1];
+	}
+	if (!hasValidIndexes(buffer.data())) {
+		cerr << filename << " is corrupted" << endl;
+		return;
+	}
+	payload = buffer.data();
+}
+
+int BinaryTreeFormat::hasValidIndexes(const char *payload) {
+	int64_t nVessels = header.nVessels;
+	const int64_t *parents = (const int64_t *) (payload + nVessels * sizeof(VesselRecord));
+	const int64_t *childOffsets = parents + nVessels;
+	const int64_t *children = childOffsets + nVessels + 1;
+	if (header.nChildren != (nVessels > 0 ? nVessels - 1 : 0) || childOffsets[0] != 0
+			|| childOffsets[nVessels] != header.nChildren) {
+		return 0;
+	}
+	for (int64_t i = 0; i < nVessels; ++i) {
+		//	Pre-order: the root is the first vessel and parents precede their children
+		if ((i == 0 && parents[i] != -1) || (i > 0 && (parents[i] < 0 || parents[i] >= i))) {
+			return 0;
+		}
+		if (childOffsets[i + 1] < childOffsets[i] || childOffsets[i + 1] > header.nChildren) {
+			return 0;
+		}
+		for (int64_t j = childOffsets[i]; j < childOffsets[i + 1]; ++j) {
+			if (children[j] <= 0 || children[j] >= nVessels || parents[children[j]] != i) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+BinaryTreeFormat::~BinaryTreeFormat() {
+	if (mapping) {
+		munmap(mapping, mappingSize);
+	}
+}
+
+int BinaryTreeFormat::isValid() {
+	return payload != NULL;
+}
+
+BinaryTreeFormat::Header &BinaryTreeFormat::getHeader() {
+	return header;
+}
+
+const BinaryTreeFormat::VesselRecord *BinaryTreeFormat::getVessels() {
+	return (const VesselRecord *) payload;
+}
+
+const int64_t *BinaryTreeFormat::getParents() {
+	return (const int64_t *) (payload + header.nVessels * sizeof(VesselRecord));
+}
+
+const int64_t *BinaryTreeFormat::getChildOffsets() {
+	return getParents() + header.nVessels;
+}
+
+const int64_t *BinaryTreeFormat::getChildren() {
+	return getChildOffsets() + header.nVessels + 1;
+}
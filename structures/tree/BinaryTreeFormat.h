@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * BinaryTreeFormat.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef TREE_BINARYTREEFORMAT_H_
+#define TREE_BINARYTREEFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Binary tree file (.ccb, or .ccbz with block compression). The file is a fixed-size header with the tree
+ * parameters followed by a payload with, in this order, one fixed-width VesselRecord per vessel in pre-order
+ * (the root is 0), the parent index of each vessel (-1 for the root), the CSR offsets of the children of each
+ * vessel (amount of vessels + 1 values) and the children indexes. Uncompressed payloads are read in place from a
+ * memory mapping of the file. Compressed payloads are split in blocks of BLOCK_SIZE bytes compressed with zlib; the
+ * header is followed by the compressed and uncompressed size of each block and then by the blocks.
+ */
+class BinaryTreeFormat {
+public:
+	/**	Version written in new files. Files with a newer version are rejected. */
+	static const uint32_t VERSION = 1;
+	/**	Header flag of block compressed payloads. */
+	static const uint32_t COMPRESSED = 1;
+	/**	Uncompressed size of each compressed block. */
+	static const size_t BLOCK_SIZE = 1 << 22;
+
+	/**	File header. All fields are 8-byte aligned so the payload can be read in place. */
+	struct Header {
+		/**	"VItACCB" followed by a null character. */
+		char magic[8];
+		uint32_t version;
+		uint32_t flags;
+		double xPerf[3];
+		double qProx;
+		double psiFactor;
+		double dp;
+		double refPressure;
+		double rootRadius;
+		double variationTolerance;
+		int64_t nTerms;
+		int64_t pointCounter;
+		int64_t nVessels;
+		/**	Length of the children array. */
+		int64_t nChildren;
+		/**	Size of the uncompressed payload. */
+		int64_t payloadSize;
+		/**	Amount of compressed blocks (0 if not compressed). */
+		int64_t nBlocks;
+	};
+
+	/**	Vessel data saved in the file. */
+	struct VesselRecord {
+		int64_t id;
+		double xProx[3];
+		double xDist[3];
+		double qReservedFraction;
+		double radius;
+		int32_t branchingMode;
+		int32_t vesselFunction;
+		int32_t stage;
+		int32_t terminalType;
+	};
+
+	/**
+	 * Returns if @p filename has the extension of a binary tree file (.ccb or .ccbz).
+	 * @param filename	File name.
+	 * @return	1 if it is a binary tree file.
+	 */
+	static int isBinaryFilename(string filename);
+	/**
+	 * Returns if @p filename has the extension of a compressed binary tree file (.ccbz).
+	 * @param filename	File name.
+	 * @return	1 if it is a compressed binary tree file.
+	 */
+	static int isCompressedFilename(string filename);
+	/**
+	 * Returns the size of the payload of a tree.
+	 * @param nVessels	Amount of vessels.
+	 * @param nChildren	Length of the children array.
+	 * @return	Size of the payload in bytes.
+	 */
+	static size_t getPayloadSize(int64_t nVessels, int64_t nChildren);
+	/**
+	 * Writes a binary tree file. The payload is compressed if @p header has the COMPRESSED flag. The magic,
+	 * version, payload size and amount of blocks of @p header are set by this method.
+	 * @param filename	Output file.
+	 * @param header	File header.
+	 * @param payload	Uncompressed payload.
+	 * @return	1 if the file was written.
+	 */
+	static int write(string filename, Header &header, vector<char> &payload);
+
+	/**
+	 * Opens the binary tree file @p filename.
+	 * @param filename	Input file.
+	 */
+	BinaryTreeFormat(string filename);
+	/**
+	 * Releases the memory mapping of the file.
+	 */
+	~BinaryTreeFormat();
+	/**
+	 * Returns if the file was opened and its header is valid.
+	 * @return	1 if the file can be read.
+	 */
+	int isValid();
+	/**
+	 * Returns the file header.
+	 * @return	Header.
+	 */
+	Header &getHeader();
+	/**
+	 * Returns the vessel records.
+	 * @return	Vessel records in pre-order.
+	 */
+	const VesselRecord *getVessels();
+	/**
+	 * Returns the parent index of each vessel.
+	 * @return	Parent indexes.
+	 */
+	const int64_t *getParents();
+	/**
+	 * Returns the CSR offsets of the children of each vessel.
+	 * @return	Children offsets.
+	 */
+	const int64_t *getChildOffsets();
+	/**
+	 * Returns the children indexes.
+	 * @return	Children indexes.
+	 */
+	const int64_t *getChildren();
+
+private:
+	/**
+	 * Returns if the parent, children offsets and children indexes of @p payload describe a tree in pre-order
+	 * with all indexes in range.
+	 * @param payload	Uncompressed payload.
+	 * @return	1 if the indexes are valid.
+	 */
+	int hasValidIndexes(const char *payload);
+
+	/**	File header. */
+	Header header;
+	/**	Memory mapping of the file. */
+	void *mapping;
+	/**	Size of @p mapping. */
+	size_t mappingSize;
+	/**	Uncompressed payload of compressed files. */
+	vector<char> buffer;
+	/**	Uncompressed payload. */
+	const char *payload;
+};
+
+#endif /* TREE_BINARYTREEFORMAT_H_ */
@@ -0,0 +1,408 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * SegmentAABBTree.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "SegmentAABBTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+SegmentAABBTree::SegmentAABBTree() {
+	this->rootNode = NULL_NODE;
+	this->freeNode = NULL_NODE;
+}
+
+void SegmentAABBTree::insert(long long id, point a, point b) {
+	if (leaves.find(id) != leaves.end()) {
+		update(id, a, b);
+		return;
+	}
+	int leaf = allocateNode();
+	nodes[leaf].id = id;
+	nodes[leaf].a = a;
+	nodes[leaf].b = b;
+	setSegmentBox(&nodes[leaf]);
+	leaves[id] = leaf;
+	insertLeaf(leaf);
+}
+
+void SegmentAABBTree::update(long long id, point a, point b) {
+	unordered_map<long long, int>::iterator it = leaves.find(id);
+	if (it == leaves.end()) {
+		insert(id, a, b);
+		return;
+	}
+	int leaf = it->second;
+	removeLeaf(leaf);
+	nodes[leaf].a = a;
+	nodes[leaf].b = b;
+	setSegmentBox(&nodes[leaf]);
+	insertLeaf(leaf);
+}
+
+void SegmentAABBTree::remove(long long id) {
+	unordered_map<long long, int>::iterator it = leaves.find(id);
+	if (it == leaves.end()) {
+		return;
+	}
+	int leaf = it->second;
+	leaves.erase(it);
+	removeLeaf(leaf);
+	releaseNode(leaf);
+}
+
+void SegmentAABBTree::clear() {
+	nodes.clear();
+	leaves.clear();
+	rootNode = NULL_NODE;
+	freeNode = NULL_NODE;
+}
+
+long long SegmentAABBTree::size() const {
+	return (long long) leaves.size();
+}
+
+void SegmentAABBTree::findWithinBounds(double *bounds, vector<long long> *ids) {
+	if (rootNode == NULL_NODE) {
+		return;
+	}
+	size_t firstFound = ids->size();
+	vector<int> stack;
+	stack.push_back(rootNode);
+	while (!stack.empty()) {
+		int current = stack.back();
+		stack.pop_back();
+		Node &node = nodes[current];
+		if (!overlaps(node.box, bounds)) {
+			continue;
+		}
+		if (node.child1 == NULL_NODE) {
+			ids->push_back(node.id);
+		} else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+	sort(ids->begin() + firstFound, ids->end());
+}
+
+void SegmentAABBTree::findClosest(point p, point *closest, long long *id, double *dist2) {
+	*id = -1;
+	*dist2 = INFINITY;
+	if (rootNode == NULL_NODE) {
+		return;
+	}
+	vector<int> stack;
+	stack.push_back(rootNode);
+	while (!stack.empty()) {
+		int current = stack.back();
+		stack.pop_back();
+		Node &node = nodes[current];
+		if (boxDistance2(node.box, p) > *dist2) {
+			continue;
+		}
+		if (node.child1 == NULL_NODE) {
+			point candidate;
+			double candidateDist2 = segmentDistance2(node.a, node.b, p, &candidate);
+			if (candidateDist2 < *dist2 || (candidateDist2 == *dist2 && node.id < *id)) {
+				*dist2 = candidateDist2;
+				*closest = candidate;
+				*id = node.id;
+			}
+		} else {
+			//	Visit the closest child first to tighten the pruning distance early
+			double d1 = boxDistance2(nodes[node.child1].box, p);
+			double d2 = boxDistance2(nodes[node.child2].box, p);
+			if (d1 < d2) {
+				stack.push_back(node.child2);
+				stack.push_back(node.child1);
+			} else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+}
+
+int SegmentAABBTree::allocateNode() {
+	int node;
+	if (freeNode == NULL_NODE) {
+		nodes.push_back(Node());
+		node = (int) nodes.size() - 1;
+	} else {
+		node = freeNode;
+		freeNode = nodes[node].parent;
+	}
+	nodes[node].id = -1;
+	nodes[node].parent = NULL_NODE;
+	nodes[node].child1 = NULL_NODE;
+	nodes[node].child2 = NULL_NODE;
+	nodes[node].height = 0;
+	return node;
+}
+
+void SegmentAABBTree::releaseNode(int node) {
+	nodes[node].parent = freeNode;
+	nodes[node].height = -1;
+	freeNode = node;
+}
+
+void SegmentAABBTree::insertLeaf(int leaf) {
+	if (rootNode == NULL_NODE) {
+		rootNode = leaf;
+		nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	//	Descend choosing the sibling with the minimum surface area heuristic cost
+	double *leafBox = nodes[leaf].box;
+	int index = rootNode;
+	while (nodes[index].child1 != NULL_NODE) {
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+
+		double combined[6];
+		mergeBoxes(nodes[index].box, leafBox, combined);
+		double area = surfaceArea(nodes[index].box);
+		double combinedArea = surfaceArea(combined);
+
+		double cost = 2.0 * combinedArea;
+		double inheritanceCost = 2.0 * (combinedArea - area);
+
+		double merged[6];
+		mergeBoxes(nodes[child1].box, leafBox, merged);
+		double cost1 = surfaceArea(merged) + inheritanceCost;
+		if (nodes[child1].child1 != NULL_NODE) {
+			cost1 -= surfaceArea(nodes[child1].box);
+		}
+		mergeBoxes(nodes[child2].box, leafBox, merged);
+		double cost2 = surfaceArea(merged) + inheritanceCost;
+		if (nodes[child2].child1 != NULL_NODE) {
+			cost2 -= surfaceArea(nodes[child2].box);
+		}
+
+		if (cost < cost1 && cost < cost2) {
+			break;
+		}
+		index = cost1 < cost2 ? child1 : child2;
+	}
+
+	//	Create a new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].height = nodes[sibling].height + 1;
+	mergeBoxes(nodes[sibling].box, nodes[leaf].box, nodes[newParent].box);
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	if (oldParent != NULL_NODE) {
+		if (nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		} else {
+			nodes[oldParent].child2 = newParent;
+		}
+	} else {
+		rootNode = newParent;
+	}
+
+	refit(nodes[leaf].parent);
+}
+
+void SegmentAABBTree::removeLeaf(int leaf) {
+	if (leaf == rootNode) {
+		rootNode = NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent != NULL_NODE) {
+		if (nodes[grandParent].child1 == parent) {
+			nodes[grandParent].child1 = sibling;
+		} else {
+			nodes[grandParent].child2 = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		releaseNode(parent);
+		refit(grandParent);
+	} else {
+		rootNode = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		releaseNode(parent);
+	}
+	nodes[leaf].parent = NULL_NODE;
+}
+
+void SegmentAABBTree::refit(int node) {
+	while (node != NULL_NODE) {
+		node = balance(node);
+		int child1 = nodes[node].child1;
+		int child2 = nodes[node].child2;
+		nodes[node].height = 1 + max(nodes[child1].height, nodes[child2].height);
+		mergeBoxes(nodes[child1].box, nodes[child2].box, nodes[node].box);
+		node = nodes[node].parent;
+	}
+}
+
+int SegmentAABBTree::balance(int iA) {
+	Node *A = &nodes[iA];
+	if (A->child1 == NULL_NODE || A->height < 2) {
+		return iA;
+	}
+
+	int iB = A->child1;
+	int iC = A->child2;
+	Node *B = &nodes[iB];
+	Node *C = &nodes[iC];
+
+	int heightBalance = C->height - B->height;
+
+	//	Rotate C up
+	if (heightBalance > 1) {
+		int iF = C->child1;
+		int iG = C->child2;
+		Node *F = &nodes[iF];
+		Node *G = &nodes[iG];
+
+		C->child1 = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+		if (C->parent != NULL_NODE) {
+			if (nodes[C->parent].child1 == iA) {
+				nodes[C->parent].child1 = iC;
+			} else {
+				nodes[C->parent].child2 = iC;
+			}
+		} else {
+			rootNode = iC;
+		}
+
+		if (F->height > G->height) {
+			C->child2 = iF;
+			A->child2 = iG;
+			G->parent = iA;
+			mergeBoxes(B->box, G->box, A->box);
+			mergeBoxes(A->box, F->box, C->box);
+			A->height = 1 + max(B->height, G->height);
+			C->height = 1 + max(A->height, F->height);
+		} else {
+			C->child2 = iG;
+			A->child2 = iF;
+			F->parent = iA;
+			mergeBoxes(B->box, F->box, A->box);
+			mergeBoxes(A->box, G->box, C->box);
+			A->height = 1 + max(B->height, F->height);
+			C->height = 1 + max(A->height, G->height);
+		}
+		return iC;
+	}
+
+	//	Rotate B up
+	if (heightBalance < -1) {
+		int iD = B->child1;
+		int iE = B->child2;
+		Node *D = &nodes[iD];
+		Node *E = &nodes[iE];
+
+		B->child1 = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+		if (B->parent != NULL_NODE) {
+			if (nodes[B->parent].child1 == iA) {
+				nodes[B->parent].child1 = iB;
+			} else {
+				nodes[B->parent].child2 = iB;
+			}
+		} else {
+			rootNode = iB;
+		}
+
+		if (D->height > E->height) {
+			B->child2 = iD;
+			A->child1 = iE;
+			E->parent = iA;
+			mergeBoxes(C->box, E->box, A->box);
+			mergeBoxes(A->box, D->box, B->box);
+			A->height = 1 + max(C->height, E->height);
+			B->height = 1 + max(A->height, D->height);
+		} else {
+			B->child2 = iE;
+			A->child1 = iD;
+			D->parent = iA;
+			mergeBoxes(C->box, D->box, A->box);
+			mergeBoxes(A->box, E->box, B->box);
+			A->height = 1 + max(C->height, D->height);
+			B->height = 1 + max(A->height, E->height);
+		}
+		return iB;
+	}
+
+	return iA;
+}
+
+void SegmentAABBTree::setSegmentBox(Node *node) {
+	for (int i = 0; i < 3; ++i) {
+		node->box[2 * i] = min(node->a.p[i], node->b.p[i]);
+		node->box[2 * i + 1] = max(node->a.p[i], node->b.p[i]);
+	}
+}
+
+void SegmentAABBTree::mergeBoxes(double *box1, double *box2, double *merged) {
+	for (int i = 0; i < 3; ++i) {
+		merged[2 * i] = min(box1[2 * i], box2[2 * i]);
+		merged[2 * i + 1] = max(box1[2 * i + 1], box2[2 * i + 1]);
+	}
+}
+
+double SegmentAABBTree::surfaceArea(double *box) {
+	double dx = box[1] - box[0];
+	double dy = box[3] - box[2];
+	double dz = box[5] - box[4];
+	return 2.0 * (dx * dy + dy * dz + dz * dx);
+}
+
+int SegmentAABBTree::overlaps(double *box1, double *box2) {
+	for (int i = 0; i < 3; ++i) {
+		if (box1[2 * i] > box2[2 * i + 1] || box2[2 * i] > box1[2 * i + 1]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+double SegmentAABBTree::boxDistance2(double *box, point p) {
+	double dist2 = 0.0;
+	for (int i = 0; i < 3; ++i) {
+		double d = 0.0;
+		if (p.p[i] < box[2 * i]) {
+			d = box[2 * i] - p.p[i];
+		} else if (p.p[i] > box[2 * i + 1]) {
+			d = p.p[i] - box[2 * i + 1];
+		}
+		dist2 += d * d;
+	}
+	return dist2;
+}
+
+double SegmentAABBTree::segmentDistance2(point a, point b, point p, point *closest) {
+	point ab = b - a;
+	double length2 = ab ^ ab;
+	double t = 0.0;
+	if (length2 > 0.0) {
+		t = ((p - a) ^ ab) / length2;
+		t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+	}
+	*closest = a + ab * t;
+	point d = p - *closest;
+	return d ^ d;
+}
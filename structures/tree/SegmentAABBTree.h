@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * SegmentAABBTree.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef TREE_SEGMENTAABBTREE_H_
+#define TREE_SEGMENTAABBTREE_H_
+
+#include "../CCOCommonStructures.h"
+
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * Dynamic bounding volume hierarchy of line segments keyed by the vessel ID. Leaves hold the
+ * segment end-points and internal nodes the axis aligned box enclosing their children. The
+ * hierarchy is kept height balanced by AVL rotations, hence insertion, update and removal of
+ * a single segment are O(log N) and do not require any rebuild of the structure.
+ */
+class SegmentAABBTree {
+	/**	Null node index. */
+	static const int NULL_NODE = -1;
+	/**
+	 * Node of the hierarchy. Leaves have @p child1 equal to @p NULL_NODE.
+	 */
+	struct Node {
+		/**	Bounding box as (xmin, xmax, ymin, ymax, zmin, zmax). */
+		double box[6];
+		/**	Proximal point of the segment (leaves only). */
+		point a;
+		/**	Distal point of the segment (leaves only). */
+		point b;
+		/**	Vessel ID of the segment (leaves only). */
+		long long id;
+		/**	Parent node index, or next free node when the node is in the free list. */
+		int parent;
+		/**	First child node index. */
+		int child1;
+		/**	Second child node index. */
+		int child2;
+		/**	Height of the subtree (0 for leaves, -1 for free nodes). */
+		int height;
+	};
+
+	/**	Node pool. */
+	vector<Node> nodes;
+	/**	Root node index. */
+	int rootNode;
+	/**	Head of the free node list. */
+	int freeNode;
+	/**	Leaf node index of each vessel ID. */
+	unordered_map<long long, int> leaves;
+
+public:
+	/**
+	 * Constructor of an empty index.
+	 */
+	SegmentAABBTree();
+	/**
+	 * Inserts the segment @p a - @p b with the vessel ID @p id. If @p id is already present its
+	 * segment is updated.
+	 * @param id	Vessel ID.
+	 * @param a	Proximal point.
+	 * @param b	Distal point.
+	 */
+	void insert(long long id, point a, point b);
+	/**
+	 * Updates the end-points of the segment with ID @p id (e.g. after its distal point moved).
+	 * @param id	Vessel ID.
+	 * @param a	New proximal point.
+	 * @param b	New distal point.
+	 */
+	void update(long long id, point a, point b);
+	/**
+	 * Removes the segment with ID @p id. Non-existent IDs are ignored.
+	 * @param id	Vessel ID.
+	 */
+	void remove(long long id);
+	/**
+	 * Removes all segments.
+	 */
+	void clear();
+	/**
+	 * Returns the amount of segments in the index.
+	 * @return Amount of segments.
+	 */
+	long long size() const;
+	/**
+	 * Collects the IDs of all segments whose bounding box intersects @p bounds. The IDs are
+	 * returned in ascending order so the result does not depend on the hierarchy layout.
+	 * @param bounds	Box as (xmin, xmax, ymin, ymax, zmin, zmax).
+	 * @param ids	Vector where the IDs are appended.
+	 */
+	void findWithinBounds(double *bounds, vector<long long> *ids);
+	/**
+	 * Finds the closest segment point to @p p. Ties are resolved in favour of the lowest ID.
+	 * @param p	Query point.
+	 * @param closest	Closest point on the closest segment.
+	 * @param id	ID of the closest segment (-1 if the index is empty).
+	 * @param dist2	Squared distance between @p p and @p closest.
+	 */
+	void findClosest(point p, point *closest, long long *id, double *dist2);
+	/**
+	 * Returns if the boxes @p box1 and @p box2 intersect.
+	 * @param box1	Box as (xmin, xmax, ymin, ymax, zmin, zmax).
+	 * @param box2	Box as (xmin, xmax, ymin, ymax, zmin, zmax).
+	 * @return	1 if the boxes intersect, otherwise 0.
+	 */
+	static int overlaps(double *box1, double *box2);
+	/**
+	 * Returns the squared distance between @p p and the segment @p a - @p b.
+	 * @param a	Proximal point of the segment.
+	 * @param b	Distal point of the segment.
+	 * @param p	Query point.
+	 * @param closest	Closest point of the segment to @p p.
+	 * @return	Squared distance.
+	 */
+	static double segmentDistance2(point a, point b, point p, point *closest);
+
+private:
+	int allocateNode();
+	void releaseNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int iA);
+	void refit(int node);
+	static void setSegmentBox(Node *node);
+	static void mergeBoxes(double *box1, double *box2, double *merged);
+	static double surfaceArea(double *box);
+	static double boxDistance2(double *box, point p);
+};
+
+#endif /* TREE_SEGMENTAABBTREE_H_ */
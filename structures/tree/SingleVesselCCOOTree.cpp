@@ -23,21 +23,117 @@
 #include <vtkXMLReader.h>
 
 #include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <iterator>
 #include <string>
 #include <vector>
+#include <omp.h>
 
 #include "AbstractCostEstimator.h"
+#include "BinaryTreeFormat.h"
+#include "acceleration/FixedPointIteration.h"
+#include "TreeTraversal.h"
 #include "../CCOCommonStructures.h"
 #include "../domain/AbstractDomain.h"
 #include "../vascularElements/SingleVessel.h"
 #include "../../constrains/AbstractConstraintFunction.h"
 #include "../../core/GeneratorData.h"
 
+loadingProgressFunc SingleVesselCCOOTree::loadingProgress = NULL;
+
+namespace {
+	/**	Vessels read between calls to SingleVesselCCOOTree::loadingProgress. */
+	const long long int PROGRESS_INTERVAL = 1 << 16;
+
+	/**
+	 * Tokenizer over the whole content of a .cco text file. Numbers are parsed in place with strtod and strtoll.
+	 */
+	class CCOTextReader {
+		const char *position;
+		const char *end;
+	public:
+		CCOTextReader(const string &content) {
+			this->position = content.c_str();
+			this->end = position + content.size();
+		}
+
+		/**	Advances past the next occurrence of @p token. Returns 0 if it is not found. */
+		int skipTo(const char *token) {
+			size_t length = strlen(token);
+			while (true) {
+				skipSpaces();
+				if (position >= end) {
+					return 0;
+				}
+				const char *begin = position;
+				skipToken();
+				if ((size_t) (position - begin) == length && strncmp(begin, token, length) == 0) {
+					return 1;
+				}
+			}
+		}
+
+		void skipSpaces() {
+			while (position < end && isspace((unsigned char) *position)) {
+				++position;
+			}
+		}
+
+		void skipToken() {
+			skipSpaces();
+			while (position < end && !isspace((unsigned char) *position)) {
+				++position;
+			}
+		}
+
+		void skipLine() {
+			while (position < end && *position != '\n') {
+				++position;
+			}
+			if (position < end) {
+				++position;
+			}
+		}
+
+		double readDouble() {
+			char *next;
+			double value = strtod(position, &next);
+			position = next;
+			return value;
+		}
+
+		long long int readLong() {
+			char *next;
+			long long int value = strtoll(position, &next, 10);
+			position = next;
+			return value;
+		}
+
+		/**	Reads the next integer of the current line. Returns 0 at the end of the line. */
+		int readLongInLine(long long int *value) {
+			while (position < end && *position != '\n' && isspace((unsigned char) *position)) {
+				++position;
+			}
+			if (position >= end || *position == '\n') {
+				return 0;
+			}
+			char *next;
+			*value = strtoll(position, &next, 10);
+			if (next == position) {
+				return 0;
+			}
+			position = next;
+			return 1;
+		}
+	};
+}
+
 SingleVesselCCOOTree::SingleVesselCCOOTree(point xi, double rootRadius, double qi, AbstractConstraintFunction<double, int> *gam, AbstractConstraintFunction<double, int> *epsLim,
 		AbstractConstraintFunction<double, int> *nu, double refPressure, double resistanceVariationTolerance, GeneratorData *instanceData) :
 		AbstractObjectCCOTree(xi, qi, gam, epsLim, nu, refPressure, instanceData) {
@@ -45,154 +141,51 @@ SingleVesselCCOOTree::SingleVesselCCOOTree(point xi, double rootRadius, double q
 	this->rootRadius = rootRadius;
 	this->variationTolerance = resistanceVariationTolerance;
 	this->nCommonTerminals = 0;
+	this->isIncrementalUpdate = 0;
+	this->isCopyFreeEvaluation = 0;
+	this->isScratchEvaluation = 0;
+	this->isUpdateDeferred = 0;
+	this->viscosityAccelerator = NULL;
+	this->maxViscosityIterations = 0;
+	this->parallelSweepCutoff = 50000;
+	this->reconciliationInterval = 0;
+	this->reconciliationTolerance = 0.0;
+	this->isDriftLogged = 0;
+	this->insertionsSinceReconciliation = 0;
+	this->reconciliationError = 0.0;
+	this->accumulatedDrift = 0.0;
+	this->viscositySolves = 0;
+	this->viscosityIterations = 0;
 }
 
 SingleVesselCCOOTree::SingleVesselCCOOTree(string filenameCCO, GeneratorData *instanceData, AbstractConstraintFunction<double, int> *gam, AbstractConstraintFunction<double, int> *epsLim,
 		AbstractConstraintFunction<double, int> *nu) :
 		AbstractObjectCCOTree(instanceData) {
 	this->filenameCCO = filenameCCO;
-	ifstream treeFile;
-
-	treeFile.open(filenameCCO.c_str(), ios::in);
-	string token;
-	treeFile >> token;
-	while (token.compare("*Tree") != 0 && !treeFile.eof()) {
-		treeFile >> token;
-	}
-
-	cout << "Reading tree data..." << endl;
-	//	Read tree
-	treeFile >> xPerf.p[0];
-	treeFile >> xPerf.p[1];
-	treeFile >> xPerf.p[2];
-	treeFile >> qProx;
-	treeFile >> psiFactor;
-	treeFile >> dp;
-	treeFile >> nTerms;
-	treeFile >> refPressure;
-	treeFile >> pointCounter;
-	treeFile >> rootRadius;
-	treeFile >> variationTolerance;
-
-	treeFile >> token;
-	while (token.compare("*Vessels") != 0 && !treeFile.eof()) {
-		treeFile >> token;
-	}
-
-	cout << "Reading vessel data..." << endl;
-	//	Read each vessel
-	int numVessels;
-	treeFile >> numVessels;
-	//	Patch ------------------
-	this->qReservedFactor = 0.0;
-	//	------------------------
-	double accReservedFlowFraction = 0.0;
-	double currentReservedFlow = 0.0;
-	for (int i = 0; i < numVessels; ++i) {
-		int branchingMode = 0;
-		int vesselType = 0;
-		SingleVessel *v = new SingleVessel();
-		v->qReservedFraction = 0.0;
-		treeFile >> v->vtkSegmentId;
-		cout << v->vtkSegmentId << endl;
-		treeFile >> v->xProx.p[0];
-		treeFile >> v->xProx.p[1];
-		treeFile >> v->xProx.p[2];
-		treeFile >> v->xDist.p[0];
-		treeFile >> v->xDist.p[1];
-		treeFile >> v->xDist.p[2];
-		treeFile >> token; 						//	Tappering
-		treeFile >> token;						//	Proximal_Distal_Radius_switched
-		treeFile >> token;						//	Regions
-		treeFile >> currentReservedFlow;		//	Reserved fraction -> Ask Paulo if it is alright
-		if(currentReservedFlow > 0.0){
-			v->terminalType = AbstractVascularElement::TERMINAL_TYPE::RESERVED;
-			v->qReservedFraction = currentReservedFlow;
-			accReservedFlowFraction += currentReservedFlow;
-		}
-		treeFile >> branchingMode; 				//	Branching - 0:NO_BRANCHING, 1:RIGID_PARENT, 2:DEFORMABLE_PARENT, 3:DISTAL_BRANCHING, 4:ONLY_AT_PARENT_HOTSPOTS
-		v->branchingMode = static_cast<AbstractVascularElement::BRANCHING_MODE>(branchingMode);
-		treeFile >> v->radius;
-		treeFile >> token;						//	Resistance 1
-		treeFile >> token;						//	Resistance 2
-		treeFile >> token;						//	Capacitance
-		treeFile >> token;						//	Pressure
-		treeFile >> vesselType;					//	Perforators - 0:DISTRIBUTION, 1:PERFORATOR, 2:TRANSPORT
-		v->vesselFunction = static_cast<AbstractVascularElement::VESSEL_FUNCTION>(vesselType);
-		treeFile >> token;						//	Heart
-		treeFile >> token;						//	Valves_SResistors_codes
-		treeFile >> v->stage;					//	Stage
-		this->elements[v->vtkSegmentId] = v;
-	}
-
-	this->qReservedFactor = accReservedFlowFraction;
-
-	//	Load connectivity among segments
-	treeFile >> token;
-	cout << token << endl;
-	while (token.compare("*Connectivity") != 0 && !treeFile.eof()) {
-		treeFile >> token;
-	}
-	getline(treeFile, token);
-
-	cout << "Reading connectivity data..." << endl;
-	int rootIndex = 0;
-	for (long long i = 0; i < numVessels; ++i) {
-		getline(treeFile, token);
-		stringstream ss;
-		ss << token;
-		int vtkId, parentId, childId;
-
-		ss >> vtkId;
-		cout << "Vessel ID = " << vtkId;
-
-		//	Parent parsing
-		ss >> parentId;
-		cout << " - P = " << parentId;
-		if (parentId == -1) {
-			elements[vtkId]->parent = NULL;
-			rootIndex = vtkId;
-		} else {
-			elements[vtkId]->parent = elements[parentId];
-		}
-
-		//	Children parsing
-		cout << " - Children : ";
-		while (ss >> childId) {			
-			cout << childId << " " ;
-			elements[vtkId]->addChild(elements[childId]);
-		}
-		cout << endl;
+	this->isIncrementalUpdate = 0;
+	this->isCopyFreeEvaluation = 0;
+	this->isScratchEvaluation = 0;
+	this->isUpdateDeferred = 0;
+	this->viscosityAccelerator = NULL;
+	this->maxViscosityIterations = 0;
+	this->parallelSweepCutoff = 50000;
+	this->reconciliationInterval = 0;
+	this->reconciliationTolerance = 0.0;
+	this->isDriftLogged = 0;
+	this->insertionsSinceReconciliation = 0;
+	this->reconciliationError = 0.0;
+	this->accumulatedDrift = 0.0;
+	this->viscositySolves = 0;
+	this->viscosityIterations = 0;
+
+	int isLoaded = BinaryTreeFormat::isBinaryFilename(filenameCCO) ? loadBinary(filenameCCO) : loadText(filenameCCO, 0);
+	if (isLoaded) {
+		setNu(nu);
+		setGam(gam);
+		setEpsLim(epsLim);
+
+		initializeLoadedVessels();
 	}
-
-	cout << "Assembling tree..." << endl;
-	//	Tree values
-	this->root = elements[rootIndex];
-	this->nTerms = this->getNTerminals();
-	this->nCommonTerminals = getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON);
-	cout << "Terminals " << nTerms << " - Common terminals " << getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON) << " - Reserved terminals " << getNTerminals(AbstractVascularElement::TERMINAL_TYPE::RESERVED) << endl;
-	cout << "qReserved fraction " << qReservedFactor << endl;
-
-	this->nu = nu;
-	this->gam = gam;
-	this->epsLim = epsLim;
-
-	cout << "Tree successfully loaded" << endl;
-	cout << "Creating VTK structure..." << endl;
-
-	createSegmentVtkLines(root);
-
-	vtkTree->BuildCells();
-	vtkTree->Modified();
-
-	cout << "Points = " << vtkTree->GetNumberOfPoints() << endl;
-	cout << "Vessels = " << vtkTree->GetNumberOfLines() << endl;
-
-	vtkTreeLocator->SetDataSet(vtkTree);
-	vtkTreeLocator->BuildLocator();
-	vtkTreeLocator->Update();
-
-	treeFile.close();
 }
 
 SingleVesselCCOOTree::SingleVesselCCOOTree(string filenameCCO, GeneratorData* instanceData, double qi, AbstractConstraintFunction<double, int> *gam, AbstractConstraintFunction<double, int> *epsLim,
@@ -200,138 +193,33 @@ SingleVesselCCOOTree::SingleVesselCCOOTree(string filenameCCO, GeneratorData* in
 		AbstractObjectCCOTree(instanceData) {
 
 	this->filenameCCO = filenameCCO;
-
-	ifstream treeFile;
-
-	treeFile.open(filenameCCO.c_str(), ios::in);
-
-	string token;
-	treeFile >> token;
-	while (token.compare("*Vessels") != 0 && !treeFile.eof()) {
-		treeFile >> token;
-	}
-
-	//	Read each vessel
-	int numVessels;
-	treeFile >> numVessels;
-	//	Patch ------------------
-	this->qReservedFactor = 0.0;
-	//	------------------------
-	double accReservedFlowFraction = 0.0;
-	double currentReservedFlow = 0.0;
-	for (int i = 0; i < numVessels; ++i) {
-		int branchingMode = 0;
-		int vesselType = 0;
-		SingleVessel *v = new SingleVessel();
-		v->qReservedFraction = 0.0;
-		treeFile >> v->vtkSegmentId;
-		cout << v->vtkSegmentId << endl;
-		treeFile >> v->xProx.p[0];
-		treeFile >> v->xProx.p[1];
-		treeFile >> v->xProx.p[2];
-		treeFile >> v->xDist.p[0];
-		treeFile >> v->xDist.p[1];
-		treeFile >> v->xDist.p[2];
-		treeFile >> token; 						//	Tappering
-		treeFile >> token;						//	Proximal_Distal_Radius_switched
-		treeFile >> token;						//	Regions
-		treeFile >> currentReservedFlow;		//	Reserved fraction -> Ask Paulo if it is alright
-		if(currentReservedFlow > 0.0){
-			v->terminalType = AbstractVascularElement::TERMINAL_TYPE::RESERVED;
-			v->qReservedFraction = currentReservedFlow;
-			accReservedFlowFraction += currentReservedFlow;
-		}
-		treeFile >> branchingMode; 				//	Branching - 0:NO_BRANCHING, 1:RIGID_PARENT, 2:DEFORMABLE_PARENT, 3:DISTAL_BRANCHING, 4:ONLY_AT_PARENT_HOTSPOTS
-		v->branchingMode = static_cast<AbstractVascularElement::BRANCHING_MODE>(branchingMode);
-		treeFile >> v->radius;
-		treeFile >> token;						//	Resistance 1
-		treeFile >> token;						//	Resistance 2
-		treeFile >> token;						//	Capacitance
-		treeFile >> token;						//	Pressure
-		treeFile >> vesselType;					//	Perforators - 0:DISTRIBUTION, 1:PERFORATOR, 2:TRANSPORT
-		v->vesselFunction = static_cast<AbstractVascularElement::VESSEL_FUNCTION>(vesselType);
-		treeFile >> token;						//	Heart
-		treeFile >> token;						//	Valves_SResistors_codes
-
-		v->stage = -1;
-		this->elements[v->vtkSegmentId] = v;
-	}
-
-	this->qReservedFactor = accReservedFlowFraction;
-
-	//	Load connectivity among segments
-	treeFile >> token;
-	cout << token << endl;
-	while (token.compare("*Connectivity") != 0 && !treeFile.eof()) {
-		treeFile >> token;
-	}
-	getline(treeFile, token);
-
-	long long rootId = 0;
-	for (long long i = 0; i < numVessels; ++i) {
-		getline(treeFile, token);
-		stringstream ss;
-		ss << token;
-		int vtkId, parentId, childId;
-
-		ss >> vtkId;
-		cout << "Vessel ID = " << vtkId;
-
-		//	Parent parsing
-		ss >> parentId;
-		cout << " - P = " << parentId;
-		if (parentId == -1) {
-			elements[vtkId]->parent = NULL;
-			rootId = vtkId;
-		} else {
-			elements[vtkId]->parent = elements[parentId];	//	BUG! vtkId is not the indexation of the vector
-		}
-
-		//	Children parsing
-		cout << " - Children : ";
-		while (ss >> childId) {			
-			cout << childId << " " ;
-			elements[vtkId]->addChild(elements[childId]);
-//			ss >> childId;
-		}
-		cout << endl;
+	this->isIncrementalUpdate = 0;
+	this->isCopyFreeEvaluation = 0;
+	this->isScratchEvaluation = 0;
+	this->isUpdateDeferred = 0;
+	this->viscosityAccelerator = NULL;
+	this->maxViscosityIterations = 0;
+	this->parallelSweepCutoff = 50000;
+	this->reconciliationInterval = 0;
+	this->reconciliationTolerance = 0.0;
+	this->isDriftLogged = 0;
+	this->insertionsSinceReconciliation = 0;
+	this->reconciliationError = 0.0;
+	this->accumulatedDrift = 0.0;
+	this->viscositySolves = 0;
+	this->viscosityIterations = 0;
+
+	int isLoaded = BinaryTreeFormat::isBinaryFilename(filenameCCO) ? loadBinary(filenameCCO) : loadText(filenameCCO, 1);
+	if (isLoaded) {
+		this->qProx = qi;
+		this->refPressure = refPressure;
+		this->variationTolerance = viscosityTolerance;
+		setNu(nu);
+		setGam(gam);
+		setEpsLim(epsLim);
+
+		initializeLoadedVessels();
 	}
-
-	//	Tree values
-	this->root = elements[rootId];
-	this->xPerf = ((SingleVessel *) root)->xProx;
-	this->rootRadius = ((SingleVessel *) root)->radius;
-	this->qProx = qi;
-	this->psiFactor = 0;
-	this->dp = 0.0;
-	this->nTerms = this->getNTerminals();
-	this->nCommonTerminals = getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON);
-	cout << "Terminals " << nTerms << " - Common terminals " << getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON) << " - Reserved terminals " << getNTerminals(AbstractVascularElement::TERMINAL_TYPE::RESERVED) << endl;
-	cout << "qReserved fraction " << qReservedFactor << endl;
-	this->refPressure = refPressure;
-	this->pointCounter = 0l;
-	this->variationTolerance = viscosityTolerance;
-
-	this->nu = nu;
-	this->gam = gam;
-	this->epsLim = epsLim;
-
-	cout << "Tree successfully loaded" << endl;
-	cout << "Creating VTK structure..." << endl;
-
-	createSegmentVtkLines(root);
-
-	vtkTree->BuildCells();
-	vtkTree->Modified();
-
-	cout << "Points = " << vtkTree->GetNumberOfPoints() << endl;
-	cout << "Vessels = " << vtkTree->GetNumberOfLines() << endl;
-
-	vtkTreeLocator->SetDataSet(vtkTree);
-	vtkTreeLocator->BuildLocator();
-	vtkTreeLocator->Update();
-
-	treeFile.close();
 }
 
 SingleVesselCCOOTree::SingleVesselCCOOTree(SingleVesselCCOOTree *baseTree) : 
@@ -343,15 +231,36 @@ SingleVesselCCOOTree::SingleVesselCCOOTree(SingleVesselCCOOTree *baseTree) :
 	this->gam = baseTree->gam;
 	this->epsLim = baseTree->epsLim;
 	this->nu = baseTree->nu;
+	this->gamTable = baseTree->gamTable;
+	this->epsLimTable = baseTree->epsLimTable;
+	this->nuTable = baseTree->nuTable;
 	this->refPressure = baseTree->refPressure;
 
 	// SingleVesselCCOOTree attributes
 	this->filenameCCO = this->filenameCCO;
 	this->rootRadius = baseTree->rootRadius;
 	this->variationTolerance = baseTree->variationTolerance;
+	this->isIncrementalUpdate = baseTree->isIncrementalUpdate;
+	this->isCopyFreeEvaluation = baseTree->isCopyFreeEvaluation;
+	this->isLazyVtk = baseTree->isLazyVtk;
+	this->isScratchEvaluation = 0;
+	this->isUpdateDeferred = 0;
+	this->viscosityAccelerator = baseTree->viscosityAccelerator;
+	this->maxViscosityIterations = baseTree->maxViscosityIterations;
+	this->parallelSweepCutoff = baseTree->parallelSweepCutoff;
+	this->reconciliationInterval = baseTree->reconciliationInterval;
+	this->reconciliationTolerance = baseTree->reconciliationTolerance;
+	this->isDriftLogged = baseTree->isDriftLogged;
+	this->insertionsSinceReconciliation = 0;
+	this->reconciliationError = 0.0;
+	this->accumulatedDrift = 0.0;
+	this->viscositySolves = 0;
+	this->viscosityIterations = 0;
+	setIsScratchEvaluation(baseTree->isScratchEvaluation);
 }
 
 SingleVesselCCOOTree::~SingleVesselCCOOTree() {
+	releaseEvaluationScratch();
 }
 
 double SingleVesselCCOOTree::getRootRadius() {
@@ -360,15 +269,21 @@ double SingleVesselCCOOTree::getRootRadius() {
 
 void SingleVesselCCOOTree::getClosestTreePoint(point xNew, point *xBif, double *dist) {
 
-	vtkIdType closeCellId;
-	int subId;
-	vtkTreeLocator->FindClosestPoint(xNew.p, xBif->p, closeCellId, subId, *dist);
+	long long closeSegmentId;
+	if (isSegmentIndexOutdated) {
+		buildSegmentIndex();
+	}
+	segmentIndex.findClosest(xNew, xBif, &closeSegmentId, dist);
 
 	*dist = sqrt(*dist);
 }
 
 void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction) {
 
+	buildDeferredStructures();
+	//	The incremental update relies on the terminal counts cached by a previous full update
+	int isIncremental = isIncrementalUpdate && root && ((SingleVessel *) root)->commonTerminals == nCommonTerminals;
+
 	nTerms++;
 	nCommonTerminals++;
 
@@ -385,7 +300,7 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		newRoot->beta = rootRadius;
 		newRoot->radius = rootRadius;
 		newRoot->length = sqrt(dist ^ dist);
-		newRoot->viscosity = nu->getValue(newRoot->nLevel);
+		newRoot->viscosity = nuTable.getValue(newRoot->nLevel);
 		newRoot->resistance = (8 * newRoot->viscosity / M_PI) * newRoot->length;
 		newRoot->flow = qProx;
 		newRoot->treeVolume = M_PI * newRoot->length * rootRadius * rootRadius;
@@ -400,24 +315,29 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		dp = newRoot->resistance / psiFactor;
 
 		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
-		vtkTree->SetPoints(pts);
-
-		newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
-		vtkTree->SetLines(lines);
+		if (isLazyVtk) {
+			nextSegmentId = 0;
+			newRoot->vtkSegmentId = reserveSegmentId();
+		} else {
+			vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+			vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
+			vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
+			vtkTree->SetPoints(pts);
+
+			newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
+			vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+			newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
+			vtkTree->SetLines(lines);
+		}
 		elements[newRoot->vtkSegmentId] = newRoot;
 
 		root = newRoot;
 
 		//	Update tree locator
-		vtkTreeLocator->SetDataSet(vtkTree);
-		vtkTreeLocator->BuildLocator();
+		segmentIndex.clear();
+		segmentIndex.insert(newRoot->vtkSegmentId, newRoot->xProx, newRoot->xDist);
 	}
 	//	Non-root case & distal branching
 	else if(parent->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING){
@@ -435,8 +355,8 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		iNew->xDist = xDist;
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -444,30 +364,40 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 
 		parent->addChild(iNew);
 
-		//	Update post-order nLevel, flux, pressure and determine initial resistance and beta values.
-		updateTree(((SingleVessel *) root), this);
+		if (isUpdateDeferred) {
+			//	The caller updates the whole tree after adding all its vessels
+		} else if (isIncremental) {
+			//	Update only the path between the parent and the root.
+			double error = updateTreeIncremental((SingleVessel *) parent);
+			reconcileIfNeeded(1, error);
+		} else {
+			//	Update post-order nLevel, flux, pressure and determine initial resistance and beta values.
+			updateTree(((SingleVessel *) root), this);
 
-		//	Update resistance, pressure and betas
-		double maxVariation = INFINITY;
-		while (maxVariation > variationTolerance) {
-			updateTreeViscositiesBeta(((SingleVessel *) root), &maxVariation);
+			//	Update resistance, pressure and betas
+			solveViscositiesBeta((SingleVessel *) root);
 		}
 
 		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+		} else {
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		elements[iNew->vtkSegmentId] = iNew;
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			elements[iNew->vtkSegmentId] = iNew;
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
 
 	}
 	//	Non-root case & not distal branching
@@ -483,8 +413,8 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		iNew->xDist = xDist;
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -495,7 +425,7 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		iCon->xDist = ((SingleVessel *) parent)->xDist;
 		iCon->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iCon->length = sqrt(dCon ^ dCon);
-		iCon->viscosity = nu->getValue(iCon->nLevel);
+		iCon->viscosity = nuTable.getValue(iCon->nLevel);
 		iCon->parent = parent;
 		iCon->ID = ((SingleVessel *) parent)->ID;
 		iCon->branchingMode = parent->branchingMode;
@@ -518,53 +448,102 @@ void SingleVesselCCOOTree::addVessel(point xProx, point xDist, AbstractVascularE
 		((SingleVessel *) parent)->xDist = xProx;
 		((SingleVessel *) parent)->length = sqrt(dBif ^ dBif);
 
-		//	Update post-order nLevel and flow, and determine initial resistance and beta values.
-		updateTree(((SingleVessel *) root), this);
+		if (isUpdateDeferred) {
+			//	The caller updates the whole tree after adding all its vessels
+		} else if (isIncremental) {
+			//	Update only the path between the new bifurcation and the root.
+			double error = updateTreeIncremental((SingleVessel *) parent);
+			reconcileIfNeeded(1, error);
+		} else {
+			//	Update post-order nLevel and flow, and determine initial resistance and beta values.
+			updateTree(((SingleVessel *) root), this);
 
-		//	Update resistance, pressure and betas
-		double maxVariation = INFINITY;
-		while (maxVariation > variationTolerance) {
-			updateTreeViscositiesBeta(((SingleVessel *) root), &maxVariation);
+			//	Update resistance, pressure and betas
+			solveViscositiesBeta((SingleVessel *) root);
 		}
 
 		//	Update tree geometry
-		vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			iCon->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
+		} else {
+			vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
+			iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
 
-		elements[iNew->vtkSegmentId] = iNew;
-		elements[iCon->vtkSegmentId] = iCon;
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
 
 //		cout << "Parent VTK Cell ids : " << vtkTree->GetCell(parent->vtkSegmentId)->GetPointIds()->GetNumberOfIds() << endl;
 //		cout << "Intented modified id " << parent->vtkSegment->GetPointId(1) << endl;
-		vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
-		((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
+			vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
+			((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 //		cout << "Points = " << vtkTree->GetNumberOfPoints() << endl;
 //		cout << "Vessels = " << vtkTree->GetNumberOfLines() << endl;
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.update(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->xProx, ((SingleVessel *) parent)->xDist);
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
+		segmentIndex.insert(iCon->vtkSegmentId, iCon->xProx, iCon->xDist);
+	}
+
+}
+
+void SingleVesselCCOOTree::addVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents, AbstractVascularElement::VESSEL_FUNCTION vesselFunction) {
+
+	buildDeferredStructures();
+	if (parents.size() < 2 || !root) {
+		AbstractObjectCCOTree::addVessels(xProxs, xDists, parents, vesselFunction);
+		return;
+	}
+
+	//	The incremental update relies on the terminal counts cached by a previous full update
+	int isIncremental = isIncrementalUpdate && ((SingleVessel *) root)->commonTerminals == nCommonTerminals;
+
+	isUpdateDeferred = 1;
+	for (unsigned i = 0; i < parents.size(); ++i) {
+		addVessel(xProxs[i], xDists[i], parents[i], vesselFunction);
 	}
+	isUpdateDeferred = 0;
+
+	if (isIncremental) {
+		//	Update the path of each new bifurcation. Vessels shared with the path of a later bifurcation are updated
+		//	again with it, so they end up with the values of all the new vessels.
+		double error = 0.0;
+		for (unsigned i = 0; i < parents.size(); ++i) {
+			error += updateTreeIncremental((SingleVessel *) parents[i]);
+		}
+		reconcileIfNeeded(parents.size(), error);
+	} else {
+		//	Update post-order nLevel and flow, and determine initial resistance and beta values.
+		updateTree(((SingleVessel *) root), this);
 
+		//	Update resistance, pressure and betas
+		solveViscositiesBeta((SingleVessel *) root);
+	}
 }
 
 void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction,
 	unordered_map<string, SingleVessel *>* stringToPointer) {
 	printf("SingleVesselCCOOTree::addVesselMergeFast\n");
+	buildDeferredStructures();
 	nTerms++;
 	nCommonTerminals++;
 
@@ -586,7 +565,7 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		newRoot->beta = rootRadius;
 		newRoot->radius = rootRadius;
 		newRoot->length = sqrt(dist ^ dist);
-		newRoot->viscosity = nu->getValue(newRoot->nLevel);
+		newRoot->viscosity = nuTable.getValue(newRoot->nLevel);
 		newRoot->resistance = (8 * newRoot->viscosity / M_PI) * newRoot->length;
 		newRoot->flow = qProx;
 		newRoot->treeVolume = M_PI * newRoot->length * rootRadius * rootRadius;
@@ -601,24 +580,29 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		dp = newRoot->resistance / psiFactor;
 
 		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
-		vtkTree->SetPoints(pts);
-
-		newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
-		vtkTree->SetLines(lines);
+		if (isLazyVtk) {
+			nextSegmentId = 0;
+			newRoot->vtkSegmentId = reserveSegmentId();
+		} else {
+			vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+			vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
+			vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
+			vtkTree->SetPoints(pts);
+
+			newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
+			vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+			newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
+			vtkTree->SetLines(lines);
+		}
 		elements[newRoot->vtkSegmentId] = newRoot;
 
 		root = newRoot;
 
 		//	Update tree locator
-		vtkTreeLocator->SetDataSet(vtkTree);
-		vtkTreeLocator->BuildLocator();
+		segmentIndex.clear();
+		segmentIndex.insert(newRoot->vtkSegmentId, newRoot->xProx, newRoot->xDist);
 	}
 	//	Non-root case & distal branching
 	else if(parent->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING){
@@ -641,8 +625,8 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		}
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -651,20 +635,25 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		parent->addChild(iNew);
 
 		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+		} else {
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		elements[iNew->vtkSegmentId] = iNew;
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			elements[iNew->vtkSegmentId] = iNew;
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
 
 	}
 	//	Non-root case & not distal branching
@@ -691,8 +680,8 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		}
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -713,7 +702,7 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		}
 		iCon->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iCon->length = sqrt(dCon ^ dCon);
-		iCon->viscosity = nu->getValue(iCon->nLevel);
+		iCon->viscosity = nuTable.getValue(iCon->nLevel);
 		iCon->parent = parent;
 		iCon->ID = ((SingleVessel *) parent)->ID;
 		iCon->branchingMode = parent->branchingMode;
@@ -762,36 +751,45 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 		((SingleVessel *) parent)->length = sqrt(dBif ^ dBif);
 
 		//	Update tree geometry
-		vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			iCon->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
+		} else {
+			vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
+			iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
 
-		elements[iNew->vtkSegmentId] = iNew;
-		elements[iCon->vtkSegmentId] = iCon;
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
 
 //		cout << "Parent VTK Cell ids : " << vtkTree->GetCell(parent->vtkSegmentId)->GetPointIds()->GetNumberOfIds() << endl;
 //		cout << "Intented modified id " << parent->vtkSegment->GetPointId(1) << endl;
-		vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
-		((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
+			vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
+			((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 //		cout << "Points = " << vtkTree->GetNumberOfPoints() << endl;
 //		cout << "Vessels = " << vtkTree->GetNumberOfLines() << endl;
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.update(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->xProx, ((SingleVessel *) parent)->xDist);
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
+		segmentIndex.insert(iCon->vtkSegmentId, iCon->xProx, iCon->xDist);
 	}
 
 }
@@ -799,6 +797,7 @@ void SingleVesselCCOOTree::addVesselMergeFast(point xProx, point xDist, Abstract
 void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction,
 	unordered_map<string, SingleVessel *>* stringToPointer) {
 	printf("SingleVesselCCOOTree::addVesselMerge\n");
+	buildDeferredStructures();
 	nTerms++;
 	nCommonTerminals++;
 
@@ -820,7 +819,7 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		newRoot->beta = rootRadius;
 		newRoot->radius = rootRadius;
 		newRoot->length = sqrt(dist ^ dist);
-		newRoot->viscosity = nu->getValue(newRoot->nLevel);
+		newRoot->viscosity = nuTable.getValue(newRoot->nLevel);
 		newRoot->resistance = (8 * newRoot->viscosity / M_PI) * newRoot->length;
 		newRoot->flow = qProx;
 		newRoot->treeVolume = M_PI * newRoot->length * rootRadius * rootRadius;
@@ -835,24 +834,29 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		dp = newRoot->resistance / psiFactor;
 
 		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
-		vtkTree->SetPoints(pts);
-
-		newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
-		vtkTree->SetLines(lines);
+		if (isLazyVtk) {
+			nextSegmentId = 0;
+			newRoot->vtkSegmentId = reserveSegmentId();
+		} else {
+			vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+			vtkIdType idProx = pts->InsertNextPoint(newRoot->xProx.p);
+			vtkIdType idDist = pts->InsertNextPoint(newRoot->xDist.p);
+			vtkTree->SetPoints(pts);
+
+			newRoot->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newRoot->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			newRoot->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
+			vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+			newRoot->vtkSegmentId = lines->InsertNextCell(newRoot->vtkSegment);
+			vtkTree->SetLines(lines);
+		}
 		elements[newRoot->vtkSegmentId] = newRoot;
 
 		root = newRoot;
 
 		//	Update tree locator
-		vtkTreeLocator->SetDataSet(vtkTree);
-		vtkTreeLocator->BuildLocator();
+		segmentIndex.clear();
+		segmentIndex.insert(newRoot->vtkSegmentId, newRoot->xProx, newRoot->xDist);
 	}
 	//	Non-root case & distal branching
 	else if(parent->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING){
@@ -875,8 +879,8 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		}
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -888,26 +892,28 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		updateTree(((SingleVessel *) root), this);
 
 		//	Update resistance, pressure and betas
-		double maxVariation = INFINITY;
-		while (maxVariation > variationTolerance) {
-			updateTreeViscositiesBeta(((SingleVessel *) root), &maxVariation);
-		}
+		solveViscositiesBeta((SingleVessel *) root);
 
 		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+		} else {
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		elements[iNew->vtkSegmentId] = iNew;
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			elements[iNew->vtkSegmentId] = iNew;
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
 
 	}
 	//	Non-root case & not distal branching
@@ -934,8 +940,8 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		}
 		iNew->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iNew->length = sqrt(dNew ^ dNew);
-		iNew->viscosity = nu->getValue(iNew->nLevel);
-		iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+		iNew->viscosity = nuTable.getValue(iNew->nLevel);
+		iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 		iNew->parent = parent;
 		iNew->ID = nTerms;
 		iNew->stage = currentStage;
@@ -956,7 +962,7 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		}
 		iCon->nLevel = ((SingleVessel *) parent)->nLevel + 1;
 		iCon->length = sqrt(dCon ^ dCon);
-		iCon->viscosity = nu->getValue(iCon->nLevel);
+		iCon->viscosity = nuTable.getValue(iCon->nLevel);
 		iCon->parent = parent;
 		iCon->ID = ((SingleVessel *) parent)->ID;
 		iCon->branchingMode = parent->branchingMode;
@@ -1008,48 +1014,54 @@ void SingleVesselCCOOTree::addVesselMerge(point xProx, point xDist, AbstractVasc
 		updateTree(((SingleVessel *) root), this);
 
 		//	Update resistance, pressure and betas
-		double maxVariation = INFINITY;
-		while (maxVariation > variationTolerance) {
-			updateTreeViscositiesBeta(((SingleVessel *) root), &maxVariation);
-		}
+		solveViscositiesBeta((SingleVessel *) root);
 
 		//	Update tree geometry
-		vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
+		if (isLazyVtk) {
+			iNew->vtkSegmentId = reserveSegmentId();
+			iCon->vtkSegmentId = reserveSegmentId();
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
+		} else {
+			vtkIdType idProx = vtkTree->GetPoints()->InsertNextPoint(xProx.p);
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xDist.p);
 
-		iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
-		iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			iNew->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iNew->vtkSegment->GetPointIds()->SetId(0, idProx); // the second index is the global index of the mesh point
+			iNew->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
+			iCon->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			iCon->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			iCon->vtkSegment->GetPointIds()->SetId(1, ((SingleVessel *) parent)->vtkSegment->GetPointId(1)); // the second 1 is the index of xDist
 
-		iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
-		iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
+			iNew->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iNew->vtkSegment);
+			iCon->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(iCon->vtkSegment);
 
-		elements[iNew->vtkSegmentId] = iNew;
-		elements[iCon->vtkSegmentId] = iCon;
+			elements[iNew->vtkSegmentId] = iNew;
+			elements[iCon->vtkSegmentId] = iCon;
 
 //		cout << "Parent VTK Cell ids : " << vtkTree->GetCell(parent->vtkSegmentId)->GetPointIds()->GetNumberOfIds() << endl;
 //		cout << "Intented modified id " << parent->vtkSegment->GetPointId(1) << endl;
-		vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
-		((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
+			vtkTree->ReplaceCellPoint(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->vtkSegment->GetPointId(1), idProx);
+			((SingleVessel *) parent)->vtkSegment->GetPointIds()->SetId(1, idProx);
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+			vtkTree->BuildCells();
+			vtkTree->Modified();
+		}
 
 //		cout << "Points = " << vtkTree->GetNumberOfPoints() << endl;
 //		cout << "Vessels = " << vtkTree->GetNumberOfLines() << endl;
 
 		//	Update tree locator
-		vtkTreeLocator->Update();
+		segmentIndex.update(((SingleVessel *) parent)->vtkSegmentId, ((SingleVessel *) parent)->xProx, ((SingleVessel *) parent)->xDist);
+		segmentIndex.insert(iNew->vtkSegmentId, iNew->xProx, iNew->xDist);
+		segmentIndex.insert(iCon->vtkSegmentId, iCon->xProx, iCon->xDist);
 	}
 
 }
 
 void SingleVesselCCOOTree::addValitatedVessel(SingleVessel *newVessel, SingleVessel *originalVessel, unordered_map<SingleVessel *, SingleVessel *>& copiedTo) {
-	
+	buildDeferredStructures();
 	(this->nTerms)++;
 	(this->nCommonTerminals++);
 
@@ -1081,24 +1093,29 @@ void SingleVesselCCOOTree::addValitatedVessel(SingleVessel *newVessel, SingleVes
 		this->dp = newVessel->resistance / psiFactor;
 
 		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(newVessel->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(newVessel->xDist.p);
-		this->vtkTree->SetPoints(pts);
-
-		newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newVessel->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		newVessel->vtkSegmentId = lines->InsertNextCell(newVessel->vtkSegment);
-		this->vtkTree->SetLines(lines);
+		if (isLazyVtk) {
+			nextSegmentId = 0;
+			newVessel->vtkSegmentId = reserveSegmentId();
+		} else {
+			vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+			vtkIdType idProx = pts->InsertNextPoint(newVessel->xProx.p);
+			vtkIdType idDist = pts->InsertNextPoint(newVessel->xDist.p);
+			this->vtkTree->SetPoints(pts);
+
+			newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newVessel->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
+			vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+			newVessel->vtkSegmentId = lines->InsertNextCell(newVessel->vtkSegment);
+			this->vtkTree->SetLines(lines);
+		}
 		this->elements[newVessel->vtkSegmentId] = newVessel;
 
 		this->root = newVessel;
 
 		//	Update tree locator
-		this->vtkTreeLocator->SetDataSet(vtkTree);
-		this->vtkTreeLocator->BuildLocator();
+		this->segmentIndex.clear();
+		this->segmentIndex.insert(newVessel->vtkSegmentId, newVessel->xProx, newVessel->xDist);
 	}
 	//	Non-root case 
 	// Because the vessel is already validated, it will always be distal
@@ -1129,32 +1146,34 @@ void SingleVesselCCOOTree::addValitatedVessel(SingleVessel *newVessel, SingleVes
 		updateTree(((SingleVessel *) this->root), this);
 
 		//	Update resistance, pressure and betas
-		double maxVariation = INFINITY;
-		while (maxVariation > this->variationTolerance) {
-			updateTreeViscositiesBeta(((SingleVessel *) this->root), &maxVariation);
-		}
+		solveViscositiesBeta((SingleVessel *) this->root);
 
 		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(newVessel->xDist.p);
+		if (isLazyVtk) {
+			newVessel->vtkSegmentId = reserveSegmentId();
+			this->elements[newVessel->vtkSegmentId] = newVessel;
+		} else {
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(newVessel->xDist.p);
 
-		newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newVessel->vtkSegment->GetPointIds()->SetId(0, parentInNewTree->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newVessel->vtkSegment->GetPointIds()->SetId(0, parentInNewTree->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
+			newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		newVessel->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(newVessel->vtkSegment);
-		this->elements[newVessel->vtkSegmentId] = newVessel;
+			newVessel->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(newVessel->vtkSegment);
+			this->elements[newVessel->vtkSegmentId] = newVessel;
 
-		this->vtkTree->BuildCells();
-		this->vtkTree->Modified();
+			this->vtkTree->BuildCells();
+			this->vtkTree->Modified();
+		}
 
 		//	Update tree locator
-		this->vtkTreeLocator->Update();
+		this->segmentIndex.insert(newVessel->vtkSegmentId, newVessel->xProx, newVessel->xDist);
 
 	}	
 }
 
 void SingleVesselCCOOTree::addValitatedVesselFast(SingleVessel *newVessel, SingleVessel *originalVessel, unordered_map<SingleVessel *, SingleVessel *>& copiedTo) {
-	
+	buildDeferredStructures();
 	(this->nTerms)++;
 	(this->nCommonTerminals++);
 
@@ -1186,24 +1205,29 @@ void SingleVesselCCOOTree::addValitatedVesselFast(SingleVessel *newVessel, Singl
 		this->dp = newVessel->resistance / psiFactor;
 
 		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(newVessel->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(newVessel->xDist.p);
-		this->vtkTree->SetPoints(pts);
-
-		newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newVessel->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		newVessel->vtkSegmentId = lines->InsertNextCell(newVessel->vtkSegment);
-		this->vtkTree->SetLines(lines);
+		if (isLazyVtk) {
+			nextSegmentId = 0;
+			newVessel->vtkSegmentId = reserveSegmentId();
+		} else {
+			vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
+			vtkIdType idProx = pts->InsertNextPoint(newVessel->xProx.p);
+			vtkIdType idDist = pts->InsertNextPoint(newVessel->xDist.p);
+			this->vtkTree->SetPoints(pts);
+
+			newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newVessel->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
+			newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
+			vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+			newVessel->vtkSegmentId = lines->InsertNextCell(newVessel->vtkSegment);
+			this->vtkTree->SetLines(lines);
+		}
 		this->elements[newVessel->vtkSegmentId] = newVessel;
 
 		this->root = newVessel;
 
 		//	Update tree locator
-		this->vtkTreeLocator->SetDataSet(vtkTree);
-		this->vtkTreeLocator->BuildLocator();
+		this->segmentIndex.clear();
+		this->segmentIndex.insert(newVessel->vtkSegmentId, newVessel->xProx, newVessel->xDist);
 	}
 	//	Non-root case 
 	// Because the vessel is already validated, it will always be distal
@@ -1231,20 +1255,25 @@ void SingleVesselCCOOTree::addValitatedVesselFast(SingleVessel *newVessel, Singl
 		newVessel->parent->addChild(newVessel);
 
 		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(newVessel->xDist.p);
+		if (isLazyVtk) {
+			newVessel->vtkSegmentId = reserveSegmentId();
+			this->elements[newVessel->vtkSegmentId] = newVessel;
+		} else {
+			vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(newVessel->xDist.p);
 
-		newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		newVessel->vtkSegment->GetPointIds()->SetId(0, parentInNewTree->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+			newVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
+			newVessel->vtkSegment->GetPointIds()->SetId(0, parentInNewTree->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
+			newVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
 
-		newVessel->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(newVessel->vtkSegment);
-		this->elements[newVessel->vtkSegmentId] = newVessel;
+			newVessel->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(newVessel->vtkSegment);
+			this->elements[newVessel->vtkSegmentId] = newVessel;
 
-		this->vtkTree->BuildCells();
-		this->vtkTree->Modified();
+			this->vtkTree->BuildCells();
+			this->vtkTree->Modified();
+		}
 
 		//	Update tree locator
-		this->vtkTreeLocator->Update();
+		this->segmentIndex.insert(newVessel->vtkSegmentId, newVessel->xProx, newVessel->xDist);
 
 	}	
 }
@@ -1357,15 +1386,18 @@ void SingleVesselCCOOTree::addValitatedVesselFast(SingleVessel *newVessel, Singl
 
 vector<AbstractVascularElement*> SingleVesselCCOOTree::getCloseSegments(point xNew, AbstractDomain *domain, int* nFound) {
 
-	vtkSmartPointer<vtkIdList> idSegments = vtkSmartPointer<vtkIdList>::New();
-	double *localBox = domain->getLocalNeighborhood(xNew, nCommonTerminals);
+	vector<long long> idSegments;
+	if (isSegmentIndexOutdated) {
+		buildSegmentIndex();
+	}
+	double *localBox = getCloseNeighborhood(xNew, domain);
 
-	vtkTreeLocator->FindCellsWithinBounds(localBox, idSegments);
+	segmentIndex.findWithinBounds(localBox, &idSegments);
 
 	vector<AbstractVascularElement*> closerSegments;
-	int nElements = (int) idSegments->GetNumberOfIds();
+	int nElements = (int) idSegments.size();
 	for (int i = 0; i < nElements; ++i) {
-		int elemIndex = idSegments->GetId(i);
+		long long elemIndex = idSegments[i];
 		AbstractVascularElement *candidate = elements[elemIndex];
 		if(domain->isValidElement(candidate))
 			if(candidate->branchingMode != AbstractVascularElement::NO_BRANCHING)
@@ -1376,59 +1408,18 @@ vector<AbstractVascularElement*> SingleVesselCCOOTree::getCloseSegments(point xN
 	return closerSegments;
 }
 
+double *SingleVesselCCOOTree::getCloseNeighborhood(point xNew, AbstractDomain *domain) {
+	return domain->getLocalNeighborhood(xNew, nCommonTerminals);
+}
+
 int SingleVesselCCOOTree::testVessel(point xNew, AbstractVascularElement *parent, AbstractDomain *domain, vector<AbstractVascularElement *> neighbors, double dLim, point* xBif, double* cost) {
 
 	vector<point> bifPoints;
 	parent->getBranchingPoints(&bifPoints, xNew);
-	SingleVessel *pVessel = (SingleVessel *) parent;
 
 	vector<double> costs(bifPoints.size(), INFINITY);
 	for (unsigned int i = 0; i < bifPoints.size(); ++i) {
-		point bif = bifPoints[i];
-		//	TODO Implement the BIG if as a filter design pattern for testing vessels. IMPORTANT! Benchmark that implementation against the hardcoded version to evaluate the performance since
-		//	its a highly covered piece of the code. Advantages: can dynamically modify the checks at different stages to enhance computation.
-		// Branching is distal or angles are valid
-		if (pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING || (areValidAngles(bif, xNew, pVessel, domain->getMinBifurcationAngle())
-				&&	isValidOpeningAngle(bif, xNew, pVessel, domain->getMinPlaneAngle()))
-			) {
-			/* x_n, bif is inside the domain ANDAND
-			((Vessel is perforator OR x_p,x_b is inside) AND
-			x_b, x_p is inside)
-			In other words
-			v_new is inside the domain AND
-			(parent vessel is distal OR
-			((v_p is inside the domain OR parente vessel is perforator) AND
-			v_s is inside the domain))
-			*/
-			if (domain->isSegmentInside(xNew, bif) && (pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING ||
-					((pVessel->vesselFunction == AbstractVascularElement::VESSEL_FUNCTION::PERFORATOR ||  domain->isSegmentInside(pVessel->xProx, bif)) && domain->isSegmentInside(pVessel->xDist, bif)) ) ) {
-				/* v_new, v_s and v_p do not intersect neighbouring vessel */
-				if (!isIntersectingVessels(xNew, bif, pVessel, neighbors) &&
-						!isIntersectingVessels(pVessel->xProx, bif, pVessel, neighbors) &&
-						!isIntersectingVessels(pVessel->xDist, bif, pVessel, neighbors)) {
-					// Is distal
-					if(pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING){
-						costs[i] = evaluate(xNew, pVessel, dLim);
-					}
-					// Is rigid/deformable/no_branching
-					else{
-						costs[i] = evaluate(xNew, bif, pVessel, dLim);
-//						cout << "Cost for xNew " << xNew << " and " << parent->vtkSegmentId << " with bifurcation at " << coordinates[majorIndex + j-1] << " is " << costs[majorIndex + j-1] << endl;
-					}
-				} else {
-					costs[i] = INFINITY;
-					// cout << "Intersection detected." << endl;
-				}
-			} else {
-				costs[i] = INFINITY;
-				// cout << "Cost for bifurcation outside the domain." << endl;
-			}
-		} else {
-			costs[i] = INFINITY;
-			// cout << "Small angle detected." << endl;
-		}
-//#pragma omp critical
-//			cout << "Cost of bifurcation at coordinates " << coordinates[majorIndex + j] << " is " << costs[majorIndex + j] << endl;
+		costs[i] = testBifurcation(xNew, parent, bifPoints[i], domain, neighbors, dLim);
 	}
 
 	*cost = INFINITY;
@@ -1443,42 +1434,132 @@ int SingleVesselCCOOTree::testVessel(point xNew, AbstractVascularElement *parent
 	return *cost != INFINITY;
 }
 
+double SingleVesselCCOOTree::testBifurcation(point xNew, AbstractVascularElement *parent, point xBif, AbstractDomain *domain, vector<AbstractVascularElement *> &neighbors, double dLim) {
+
+	SingleVessel *pVessel = (SingleVessel *) parent;
+	double cost;
+
+	//	TODO Implement the BIG if as a filter design pattern for testing vessels. IMPORTANT! Benchmark that implementation against the hardcoded version to evaluate the performance since
+	//	its a highly covered piece of the code. Advantages: can dynamically modify the checks at different stages to enhance computation.
+	// Branching is distal or angles are valid
+	if (pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING || (areValidAngles(xBif, xNew, pVessel, domain->getMinBifurcationAngle())
+			&&	isValidOpeningAngle(xBif, xNew, pVessel, domain->getMinPlaneAngle()))
+		) {
+		/* x_n, xBif is inside the domain ANDAND
+		((Vessel is perforator OR x_p,x_b is inside) AND
+		x_b, x_p is inside)
+		In other words
+		v_new is inside the domain AND
+		(parent vessel is distal OR
+		((v_p is inside the domain OR parente vessel is perforator) AND
+		v_s is inside the domain))
+		*/
+		if (domain->isSegmentInside(xNew, xBif) && (pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING ||
+				((pVessel->vesselFunction == AbstractVascularElement::VESSEL_FUNCTION::PERFORATOR ||  domain->isSegmentInside(pVessel->xProx, xBif)) && domain->isSegmentInside(pVessel->xDist, xBif)) ) ) {
+			/* v_new, v_s and v_p do not intersect neighbouring vessel */
+			if (!isIntersectingVessels(xNew, xBif, pVessel, neighbors) &&
+					!isIntersectingVessels(pVessel->xProx, xBif, pVessel, neighbors) &&
+					!isIntersectingVessels(pVessel->xDist, xBif, pVessel, neighbors)) {
+				// Is distal
+				if(pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING){
+					cost = evaluate(xNew, pVessel, dLim);
+				}
+				// Is rigid/deformable/no_branching
+				else{
+					cost = evaluate(xNew, xBif, pVessel, dLim);
+//						cout << "Cost for xNew " << xNew << " and " << parent->vtkSegmentId << " with bifurcation at " << coordinates[majorIndex + j-1] << " is " << costs[majorIndex + j-1] << endl;
+				}
+			} else {
+				cost = INFINITY;
+				// cout << "Intersection detected." << endl;
+			}
+		} else {
+			cost = INFINITY;
+			// cout << "Cost for bifurcation outside the domain." << endl;
+		}
+	} else {
+		cost = INFINITY;
+		// cout << "Small angle detected." << endl;
+	}
+
+	return cost;
+}
+
+double SingleVesselCCOOTree::getCostLowerBound(point xNew, AbstractVascularElement *parent) {
+
+	SingleVessel *pVessel = (SingleVessel *) parent;
+
+	//	Root of the evaluated subtree as in cloneUpTo
+	SingleVessel *subtreeRoot = pVessel;
+	for (int i = 0; i < instanceData->nLevelTest && subtreeRoot->parent; ++i) {
+		subtreeRoot = (SingleVessel*) subtreeRoot->parent;
+	}
+	double subtreeRadius = getUpdatedRadius(subtreeRoot);
+	double radiusRatio = subtreeRadius / subtreeRoot->radius;
+	double previousSubtreeVolume = subtreeRoot->treeVolume * radiusRatio * radiusRatio;
+
+	double keptVolume = 0.0;
+	if (subtreeRoot != pVessel || pVessel->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING) {
+		keptVolume = M_PI * subtreeRadius * subtreeRadius * subtreeRoot->length;
+	}
+
+	return instanceData->costEstimator->computeLowerBound(parent, getUpdatedRadius(pVessel), xNew, keptVolume - previousSubtreeVolume);
+}
+
 double SingleVesselCCOOTree::evaluate(point xNew, point xTest, SingleVessel *parent, double dLim) {
 
-	SingleVesselCCOOTree *clonedTree = cloneUpTo(instanceData->nLevelTest, parent);
-//	SingleVesselCCOOTree *clonedTree = this->clone();
+	//	The copy-free evaluation relies on the terminal counts cached by a previous full update
+	if (isCopyFreeEvaluation && ((SingleVessel *) root)->commonTerminals == nCommonTerminals) {
+		double diffCost = evaluateWithoutCopy(xNew, xTest, parent, dLim);
+		//	Estimators without a variation cost are evaluated on the copied tree
+		if (!isnan(diffCost)) {
+			return diffCost;
+		}
+	}
 
-	AbstractCostEstimator *localEstimator = instanceData->costEstimator->clone();
+	EvaluationScratch *scratch = getEvaluationScratch();
+	SingleVesselCCOOTree *clonedTree;
+	AbstractCostEstimator *localEstimator;
+	SingleVessel *clonedParent;
+	if (scratch) {
+		clonedTree = cloneUpTo(instanceData->nLevelTest, parent, scratch, &clonedParent);
+		localEstimator = scratch->estimator;
+	} else {
+		clonedTree = cloneUpTo(instanceData->nLevelTest, parent);
+//		clonedTree = this->clone();
+		localEstimator = instanceData->costEstimator->clone();
+
+		//	Fast-forward until parent in the cloned tree
+		auto it = clonedTree->elements.begin();
+		for (; ((SingleVessel *) (it->second))->vtkSegmentId != ((SingleVessel *) parent)->vtkSegmentId; ++it)
+			;
+		clonedParent = (SingleVessel *) (it->second);
+	}
 	localEstimator->previousState(clonedTree, parent, xNew, xTest, dLim);
+	localEstimator->updateParentRadius(getUpdatedRadius(parent));
 
 	clonedTree->nTerms++;
 	clonedTree->nCommonTerminals++;
 
-	//	Fast-forward until parent in the cloned tree
-	auto it = clonedTree->elements.begin();
-	for (; ((SingleVessel *) (it->second))->vtkSegmentId != ((SingleVessel *) parent)->vtkSegmentId; ++it)
-		;
-	SingleVessel *clonedParent = (SingleVessel *) (it->second);
-
 	//	Add segment iNew, iCon and iBif in the cloned tree updating nLevel and lengths
 	point dNew = xNew - xTest;
 	point dCon = clonedParent->xDist - xTest;
 	point dBif = xTest - clonedParent->xProx;
 
-	SingleVessel *iNew = new SingleVessel();
+	SingleVessel *iNew = scratch ? getScratchVessel(scratch) : new SingleVessel();
 	iNew->nLevel = clonedParent->nLevel + 1;
 	iNew->length = sqrt(dNew ^ dNew);
-	iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+	iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 	iNew->parent = clonedParent;
 
-	SingleVessel *iCon = new SingleVessel();
+	SingleVessel *iCon = scratch ? getScratchVessel(scratch) : new SingleVessel();
 	iCon->nLevel = clonedParent->nLevel + 1;
 	iCon->length = sqrt(dCon ^ dCon);
 	iCon->parent = clonedParent;
 
 	vector<AbstractVascularElement *> prevChildrenParent = clonedParent->getChildren();
 	if (prevChildrenParent.empty()) {
-		iCon->resistance = 8 * nu->getValue(iCon->nLevel) / M_PI * iCon->length;
+		iCon->resistance = 8 * nuTable.getValue(iCon->nLevel) / M_PI * iCon->length;
 	} else {
 		for (vector<AbstractVascularElement *>::iterator it = prevChildrenParent.begin(); it != prevChildrenParent.end(); ++it) {
 			iCon->addChild(*it);
@@ -1498,29 +1579,31 @@ double SingleVesselCCOOTree::evaluate(point xNew, point xTest, SingleVessel *par
 	//	Update post-order nLevel, flux, initial resistances and intial betas.
 	updateTree((SingleVessel *) clonedTree->root, clonedTree);
 
-	double maxVariation = INFINITY;
-	while (maxVariation > variationTolerance) {
-		updateTreeViscositiesBeta((SingleVessel *) clonedTree->root, &maxVariation);
-	}
+	solveViscositiesBeta((SingleVessel *) clonedTree->root);
 
 	//	Check the symmetry constraint only for the newest vessel.
 	if (!isSymmetricallyValid(iCon->beta, iNew->beta, iCon->nLevel)) {
-		delete localEstimator;
-		delete clonedTree;
-		delete iNew;
-		delete iCon;
+		if (!scratch) {
+			delete localEstimator;
+			delete clonedTree;
+			delete iNew;
+			delete iCon;
+		}
 		return INFINITY;
 	}
 
 	//	Compute cost and checks the geometric constraint only at the terminals - if the last is violated, cost is INFINITY
 	double diffCost = localEstimator->computeCost(clonedTree);
 
-	delete localEstimator;
-	delete clonedTree;
+	//	Scratch objects are kept for the next candidate of this thread
+	if (!scratch) {
+		delete localEstimator;
+		delete clonedTree;
 
-	// As iCon and iNew are not added to clonedTree->elements we have to manually delete it.
-	delete iNew;
-	delete iCon;
+		// As iCon and iNew are not added to clonedTree->elements we have to manually delete it.
+		delete iNew;
+		delete iCon;
+	}
 
 	return diffCost;
 
@@ -1528,31 +1611,48 @@ double SingleVesselCCOOTree::evaluate(point xNew, point xTest, SingleVessel *par
 
 double SingleVesselCCOOTree::evaluate(point xNew, SingleVessel *parent, double dLim) {
 
-	SingleVesselCCOOTree *clonedTree = cloneUpTo(instanceData->nLevelTest, parent);
-//	SingleVesselCCOOTree *clonedTree = this->clone();
+	if (isCopyFreeEvaluation && ((SingleVessel *) root)->commonTerminals == nCommonTerminals) {
+		double diffCost = evaluateWithoutCopy(xNew, parent->xDist, parent, dLim);
+		//	Estimators without a variation cost are evaluated on the copied tree
+		if (!isnan(diffCost)) {
+			return diffCost;
+		}
+	}
 
-	AbstractCostEstimator *localEstimator = instanceData->costEstimator->clone();
+	EvaluationScratch *scratch = getEvaluationScratch();
+	SingleVesselCCOOTree *clonedTree;
+	AbstractCostEstimator *localEstimator;
+	SingleVessel *clonedParent;
+	if (scratch) {
+		clonedTree = cloneUpTo(instanceData->nLevelTest, parent, scratch, &clonedParent);
+		localEstimator = scratch->estimator;
+	} else {
+		clonedTree = cloneUpTo(instanceData->nLevelTest, parent);
+//		clonedTree = this->clone();
+		localEstimator = instanceData->costEstimator->clone();
+
+		//	Fast-forward until parent in the cloned tree
+		auto it = clonedTree->elements.begin();
+		for (; ((SingleVessel *) (it->second))->vtkSegmentId != ((SingleVessel *) parent)->vtkSegmentId; ++it)
+			;
+		clonedParent = (SingleVessel *) (it->second);
+	}
 	localEstimator->previousState(clonedTree, parent, xNew, parent->xDist, dLim);
+	localEstimator->updateParentRadius(getUpdatedRadius(parent));
 
 	if(parent->getChildren().size()>0){
 		clonedTree->nTerms++;
 		clonedTree->nCommonTerminals++;
 	}
 
-	//	Fast-forward until parent in the cloned tree
-	auto it = clonedTree->elements.begin();
-	for (; ((SingleVessel *) (it->second))->vtkSegmentId != ((SingleVessel *) parent)->vtkSegmentId; ++it)
-		;
-	SingleVessel *clonedParent = (SingleVessel *) (it->second);
-
 	//	Add segment iNew, iCon and iBif in the cloned tree updating nLevel and lengths
 	point dNew = xNew - clonedParent->xDist;
 	point dBif = clonedParent->xDist - clonedParent->xProx;
 
-	SingleVessel *iNew = new SingleVessel();
+	SingleVessel *iNew = scratch ? getScratchVessel(scratch) : new SingleVessel();
 	iNew->nLevel = clonedParent->nLevel + 1;
 	iNew->length = sqrt(dNew ^ dNew);
-	iNew->resistance = 8 * nu->getValue(iNew->nLevel) / M_PI * iNew->length;
+	iNew->resistance = 8 * nuTable.getValue(iNew->nLevel) / M_PI * iNew->length;
 	iNew->parent = clonedParent;
 
 	vector<AbstractVascularElement *> prevChildrenParent = clonedParent->getChildren();
@@ -1566,63 +1666,333 @@ double SingleVesselCCOOTree::evaluate(point xNew, SingleVessel *parent, double d
 	//	Update post-order nLevel, flux, initial resistances and intial betas.
 	updateTree((SingleVessel *) clonedTree->root, clonedTree);
 
-	double maxVariation = INFINITY;
-	while (maxVariation > variationTolerance) {
-		updateTreeViscositiesBeta((SingleVessel *) clonedTree->root, &maxVariation);
-	}
+	solveViscositiesBeta((SingleVessel *) clonedTree->root);
 
 	//	FIXME Define symmetry law for N-ary bifurcations (Most different betas?)
 	//	Check the symmetry constraint only for the newest vessel.
 	if (!isSymmetricallyValid( ((SingleVessel *)clonedParent->getChildren()[0])->beta, iNew->beta, iNew->nLevel)) {
-		delete localEstimator;
-		delete clonedTree;
-		delete iNew;
+		if (!scratch) {
+			delete localEstimator;
+			delete clonedTree;
+			delete iNew;
+		}
 		return INFINITY;
 	}
 
 	//	Compute cost and checks the geometric constraint only at the terminals - if the last is unsatisfied, cost is INFINITY
 	double diffCost = localEstimator->computeCost(clonedTree);
 
-	delete localEstimator;
-	delete clonedTree;
+	//	Scratch objects are kept for the next candidate of this thread
+	if (!scratch) {
+		delete localEstimator;
+		delete clonedTree;
 
-	// As iNew is not added to clonedTree->elements we have to manually delete it
-	delete iNew;
+		// As iNew is not added to clonedTree->elements we have to manually delete it
+		delete iNew;
+	}
 
 	return diffCost;
 
 }
 
-int SingleVesselCCOOTree::isSymmetricallyValid(double beta1, double beta2, int nLevel) {
-	double epsRad;
-	if (beta1 > beta2)
-		epsRad = beta2 / beta1;
-	else
-		epsRad = beta1 / beta2;
+double SingleVesselCCOOTree::evaluateWithoutCopy(point xNew, point xTest, SingleVessel *parent, double dLim) {
 
-	return epsRad >= epsLim->getValue(nLevel);
-}
+	int isDistal = parent->branchingMode == AbstractVascularElement::BRANCHING_MODE::DISTAL_BRANCHING;
 
-void SingleVesselCCOOTree::print() {
-	cout << "Printing FixedRadiusRootCCOTree" << endl;
-	cout << "Root at " << xPerf << " with a radius of " << rootRadius << " mm and a flux of " << qProx << " cm^3/s" << endl;
-	cout << "Pressure=" << dp << " Pa and psi factor=" << psiFactor << " cm x s" << endl;
-	cout << "End terminals=" << nTerms << endl;
-	cout << endl << "Topology" << endl;
+	//	Path from the ancestor nLevelTest levels up to the parent
+	vector<SingleVessel *> path;
+	path.push_back(parent);
+	for (int i = 0; i < instanceData->nLevelTest && path.back()->parent; ++i) {
+		path.push_back((SingleVessel *) path.back()->parent);
+	}
+	SingleVessel *subtreeRoot = path.back();
+
+	//	Vessels of the candidate bifurcation: the path with their unmodified sibling subtrees, iCon and iNew.
+	vector<TrialVessel> trial;
+	trial.reserve(4 * path.size() + parent->getChildren().size() + 2);
+	int parentIndex = -1;
+	for (int i = path.size() - 1; i > 0; --i) {
+		parentIndex = addTrialVessel(trial, path[i], parentIndex, 0);
+		vector<AbstractVascularElement *> &pathChildren = path[i]->getChildren();
+		for (vector<AbstractVascularElement *>::iterator it = pathChildren.begin(); it != pathChildren.end(); ++it) {
+			if (*it != path[i - 1]) {
+				addTrialVessel(trial, (SingleVessel *) (*it), parentIndex, 1);
+			}
+		}
+	}
+	parentIndex = addTrialVessel(trial, parent, parentIndex, 0);
+
+	long long int commonTerminals = nCommonTerminals;
+	vector<AbstractVascularElement *> &parentChildren = parent->getChildren();
+	int iNew, iCon;
+	if (isDistal) {
+		for (vector<AbstractVascularElement *>::iterator it = parentChildren.begin(); it != parentChildren.end(); ++it) {
+			addTrialVessel(trial, (SingleVessel *) (*it), parentIndex, 1);
+		}
+		iNew = addTrialVessel(trial, NULL, parentIndex, 0);
+		//	Sibling used for the symmetry constraint
+		iCon = trial[parentIndex].firstChild;
+		if (!parentChildren.empty()) {
+			commonTerminals++;
+		}
+	} else {
+		point dBif = xTest - parent->xProx;
+		trial[parentIndex].length = sqrt(dBif ^ dBif);
+		iNew = addTrialVessel(trial, NULL, parentIndex, 0);
+		iCon = addTrialVessel(trial, NULL, parentIndex, 0);
+		point dCon = parent->xDist - xTest;
+		trial[iCon].length = sqrt(dCon ^ dCon);
+		//	As in addVessel, a terminal iCon starts as a common terminal.
+		for (vector<AbstractVascularElement *>::iterator it = parentChildren.begin(); it != parentChildren.end(); ++it) {
+			addTrialVessel(trial, (SingleVessel *) (*it), iCon, 1);
+		}
+		commonTerminals++;
+	}
+	point dNew = xNew - xTest;
+	trial[iNew].length = sqrt(dNew ^ dNew);
 
-	// TODO each vascular element must implement its own object printing
-//	for (vector<vessel *>::iterator it = elements.begin(); it != elements.end(); ++it) {
-//		cout << (*it)->print() << endl;
-//	}
+	//	New terminals start with the level-based resistance as in the copied tree.
+	for (unsigned int i = 0; i < trial.size(); ++i) {
+		if (!trial[i].vessel && trial[i].firstChild == -1) {
+			trial[i].resistance = 8 * nuTable.getValue(trial[i].nLevel) / M_PI * trial[i].length;
+		}
+	}
 
-}
+	//	The root of the evaluation has a fixed radius as the root of the copied tree.
+	double subtreeRadius = getUpdatedRadius(subtreeRoot);
+	double radiusRatio = subtreeRadius / subtreeRoot->radius;
+	double previousSubtreeVolume = subtreeRoot->treeVolume * radiusRatio * radiusRatio;
+	trial[0].beta = subtreeRadius;
 
-int SingleVesselCCOOTree::isIntersectingVessels(point p1, point p2, SingleVessel* parent, vector<AbstractVascularElement *> neighbors) {
+	updateTrialTree(trial, commonTerminals);
 
-	for (vector<AbstractVascularElement *>::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
-		double uv[2];
-		SingleVessel* currentNeighbor = (SingleVessel*) (*it);
-		int isIntersecting = 0;
+	double maxVariation = INFINITY;
+	FixedPointIteration iteration(variationTolerance, maxViscosityIterations, viscosityAccelerator);
+	if (iteration.isAccelerated()) {
+		vector<double *> &betas = iteration.getState();
+		for (unsigned i = 0; i < trial.size(); ++i) {
+			betas.push_back(&trial[i].beta);
+		}
+	}
+	while (iteration.next(maxVariation)) {
+		updateTrialViscositiesBeta(trial, &maxVariation);
+	}
+	countViscositySolve(iteration.getIterations());
+
+	//	Check the symmetry constraint only for the newest vessel.
+	if (!isSymmetricallyValid(trial[iCon].beta, trial[iNew].beta, isDistal ? trial[iNew].nLevel : trial[iCon].nLevel)) {
+		return INFINITY;
+	}
+
+	EvaluationScratch *scratch = getThreadScratch();
+	AbstractCostEstimator *localEstimator = scratch ? scratch->estimator : instanceData->costEstimator->clone();
+	localEstimator->previousState(this, parent, xNew, xTest, dLim);
+	localEstimator->updateParentRadius(getUpdatedRadius(parent));
+	//	The variation is taken from the evaluated subtree, as the copying evaluation, instead of the whole tree volume
+	double diffCost = localEstimator->computeVariationCost(trial[0].treeVolume - previousSubtreeVolume);
+	if (!scratch) {
+		delete localEstimator;
+	}
+
+	return diffCost;
+}
+
+int SingleVesselCCOOTree::addTrialVessel(vector<TrialVessel> &trial, SingleVessel *vessel, int parent, int isSubtree) {
+	TrialVessel trialVessel;
+	trialVessel.vessel = vessel;
+	trialVessel.isSubtree = isSubtree;
+	trialVessel.parent = parent;
+	trialVessel.firstChild = -1;
+	trialVessel.lastChild = -1;
+	trialVessel.nextSibling = -1;
+	trialVessel.nLevel = parent == -1 ? vessel->nLevel : trial[parent].nLevel + 1;
+	trialVessel.commonTerminals = 1;
+	trialVessel.reservedFlow = 0.0;
+	if (vessel) {
+		trialVessel.length = vessel->length;
+		trialVessel.beta = vessel->beta;
+		trialVessel.radius = vessel->radius;
+		trialVessel.localResistance = vessel->localResistance;
+		trialVessel.resistance = vessel->resistance;
+		trialVessel.flow = vessel->flow;
+		trialVessel.treeVolume = vessel->treeVolume;
+		trialVessel.commonTerminals = vessel->commonTerminals;
+		trialVessel.reservedFlow = vessel->reservedFlow;
+	}
+
+	int index = trial.size();
+	trial.push_back(trialVessel);
+	if (parent != -1) {
+		if (trial[parent].lastChild == -1) {
+			trial[parent].firstChild = index;
+		} else {
+			trial[trial[parent].lastChild].nextSibling = index;
+		}
+		trial[parent].lastChild = index;
+	}
+	return index;
+}
+
+void SingleVesselCCOOTree::updateTrialTree(vector<TrialVessel> &trial, long long int commonTerminals) {
+	double commonTerminalFlow = (qProx - qProx * qReservedFactor) / commonTerminals;
+
+	//	Children are always after their parent, so the reverse order is a post-order visit.
+	for (int i = trial.size() - 1; i >= 0; --i) {
+		TrialVessel &trialVessel = trial[i];
+		if (trialVessel.firstChild == -1) {
+			trialVessel.flow = trialVessel.commonTerminals * commonTerminalFlow + trialVessel.reservedFlow;
+			continue;
+		}
+
+		double totalFlow = 0.0;
+		double invTotalResistance = 0.0;
+		trialVessel.commonTerminals = 0;
+		trialVessel.reservedFlow = 0.0;
+		for (int j = trialVessel.firstChild; j != -1; j = trial[j].nextSibling) {
+			totalFlow += trial[j].flow;
+			invTotalResistance += 1 / trial[j].resistance;
+			trialVessel.commonTerminals += trial[j].commonTerminals;
+			trialVessel.reservedFlow += trial[j].reservedFlow;
+		}
+		trialVessel.flow = totalFlow;
+
+		double invResistanceContributions = 0.0;
+		if (trialVessel.firstChild == trialVessel.lastChild) {
+			TrialVessel &child = trial[trialVessel.firstChild];
+			child.beta = 1.0;
+			invResistanceContributions = 1 / child.resistance;
+		} else {
+			for (int j = trialVessel.firstChild; j != -1; j = trial[j].nextSibling) {
+				TrialVessel &child = trial[j];
+				double siblingsFlow = totalFlow - child.flow;
+				double siblingsResistance = 1 / (invTotalResistance - 1 / child.resistance);
+				double betaRatio = sqrt(sqrt((siblingsFlow * siblingsResistance) / (child.flow * child.resistance)));
+
+				child.beta = getMurrayBeta(betaRatio, child.nLevel);
+
+				double betaSqr = child.beta * child.beta;
+				invResistanceContributions += betaSqr * betaSqr / child.resistance;
+			}
+		}
+		trialVessel.localResistance = 8 * nuTable.getValue(trialVessel.nLevel) / M_PI * trialVessel.length;
+		trialVessel.resistance = trialVessel.localResistance + 1 / invResistanceContributions;
+	}
+}
+
+void SingleVesselCCOOTree::updateTrialViscositiesBeta(vector<TrialVessel> &trial, double *maxBetaVariation) {
+
+	trial[0].radius = trial[0].beta;
+	for (unsigned int i = 1; i < trial.size(); ++i) {
+		trial[i].radius = trial[i].beta * trial[trial[i].parent].radius;
+	}
+
+	*maxBetaVariation = 0.0;
+	for (int i = trial.size() - 1; i >= 0; --i) {
+		TrialVessel &trialVessel = trial[i];
+		double radiusSqr = trialVessel.radius * trialVessel.radius;
+
+		//	Unmodified subtrees are rescaled with their new radius since their betas do not change. The viscosities of
+		//	their deeper vessels are kept, so this is an approximation of the copying evaluation.
+		if (trialVessel.isSubtree && !trialVessel.vessel->getChildren().empty()) {
+			double radiusRatio = trialVessel.radius / trialVessel.vessel->radius;
+			trialVessel.localResistance = 8 * getNuFL(trialVessel.radius) / M_PI * trialVessel.length;
+			trialVessel.resistance = trialVessel.localResistance + (trialVessel.vessel->resistance - trialVessel.vessel->localResistance);
+			trialVessel.treeVolume = trialVessel.vessel->treeVolume * radiusRatio * radiusRatio;
+			continue;
+		}
+		if (trialVessel.firstChild == -1) {
+			trialVessel.resistance = 8 * getNuFL(trialVessel.radius) / M_PI * trialVessel.length;
+			trialVessel.treeVolume = radiusSqr * M_PI * trialVessel.length;
+			continue;
+		}
+
+		double totalChildrenFlow = 0.0;
+		double totalChildrenVolume = 0.0;
+		double invTotalResistance = 0.0;
+		for (int j = trialVessel.firstChild; j != -1; j = trial[j].nextSibling) {
+			totalChildrenFlow += trial[j].flow;
+			totalChildrenVolume += trial[j].treeVolume;
+			invTotalResistance += 1 / trial[j].resistance;
+		}
+
+		double invResistanceContributions = 0.0;
+		if (trialVessel.firstChild == trialVessel.lastChild) {
+			TrialVessel &child = trial[trialVessel.firstChild];
+			double betaVariation = abs(1.0 - child.beta);
+			child.beta = 1.0;
+			if (betaVariation > *maxBetaVariation)
+				*maxBetaVariation = betaVariation;
+
+			invResistanceContributions = 1 / child.resistance;
+		} else {
+			for (int j = trialVessel.firstChild; j != -1; j = trial[j].nextSibling) {
+				TrialVessel &child = trial[j];
+				double siblingsResistance = 1 / (invTotalResistance - 1 / child.resistance);
+				double betaRatio = sqrt(sqrt(((totalChildrenFlow - child.flow) * siblingsResistance) / (child.flow * child.resistance)));
+				double previousBeta = child.beta;
+				child.beta = getMurrayBeta(betaRatio, child.nLevel);
+
+				double betaVariation = abs(child.beta - previousBeta);
+				if (betaVariation > *maxBetaVariation)
+					*maxBetaVariation = betaVariation;
+
+				double betaSqr = child.beta * child.beta;
+				invResistanceContributions += betaSqr * betaSqr / child.resistance;
+			}
+		}
+
+		trialVessel.localResistance = 8 * getNuFL(trialVessel.radius) / M_PI * trialVessel.length;
+		trialVessel.resistance = trialVessel.localResistance + 1 / invResistanceContributions;
+		trialVessel.treeVolume = radiusSqr * M_PI * trialVessel.length + totalChildrenVolume;
+	}
+}
+
+double SingleVesselCCOOTree::getUpdatedRadius(SingleVessel *vessel) {
+	if (!isIncrementalUpdate) {
+		return vessel->radius;
+	}
+
+	vector<SingleVessel *> ancestors;
+	for (SingleVessel *currentVessel = vessel; currentVessel; currentVessel = (SingleVessel *) currentVessel->parent) {
+		ancestors.push_back(currentVessel);
+	}
+	double radius = ancestors.back()->beta;
+	for (int i = (int) ancestors.size() - 2; i >= 0; --i) {
+		radius = ancestors[i]->beta * radius;
+	}
+	return radius;
+}
+
+int SingleVesselCCOOTree::isSymmetricallyValid(double beta1, double beta2, int nLevel) {
+	double epsRad;
+	if (beta1 > beta2)
+		epsRad = beta2 / beta1;
+	else
+		epsRad = beta1 / beta2;
+
+	return epsRad >= epsLimTable.getValue(nLevel);
+}
+
+void SingleVesselCCOOTree::print() {
+	cout << "Printing FixedRadiusRootCCOTree" << endl;
+	cout << "Root at " << xPerf << " with a radius of " << rootRadius << " mm and a flux of " << qProx << " cm^3/s" << endl;
+	cout << "Pressure=" << dp << " Pa and psi factor=" << psiFactor << " cm x s" << endl;
+	cout << "End terminals=" << nTerms << endl;
+	cout << endl << "Topology" << endl;
+
+	// TODO each vascular element must implement its own object printing
+//	for (vector<vessel *>::iterator it = elements.begin(); it != elements.end(); ++it) {
+//		cout << (*it)->print() << endl;
+//	}
+
+}
+
+int SingleVesselCCOOTree::isIntersectingVessels(point p1, point p2, SingleVessel* parent, vector<AbstractVascularElement *> neighbors) {
+
+	for (vector<AbstractVascularElement *>::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+		double uv[2];
+		SingleVessel* currentNeighbor = (SingleVessel*) (*it);
+		int isIntersecting = 0;
 		if (currentNeighbor != parent) {
 			// TO DO check if this was changed in VTK 8.2 or 9.0
 			isIntersecting = vtkLine::Intersection3D(currentNeighbor->xProx.p, currentNeighbor->xDist.p, p1.p, p2.p, uv[0], uv[1]);
@@ -1649,48 +2019,153 @@ SingleVesselCCOOTree* SingleVesselCCOOTree::clone() {
 	return copy;
 }
 
+AbstractObjectCCOTree *SingleVesselCCOOTree::snapshot() {
+	SingleVesselCCOOTree *copy = clone();
+	copy->pointCounter = this->pointCounter;
+	//	Vessels of both trees share their ids
+	for (unordered_map<long long, AbstractVascularElement *>::iterator it = elements.begin(); it != elements.end(); ++it) {
+		SingleVessel *vessel = (SingleVessel *) it->second;
+		SingleVessel *copiedVessel = (SingleVessel *) copy->elements[it->first];
+		copiedVessel->terminalType = vessel->terminalType;
+		copiedVessel->qReservedFraction = vessel->qReservedFraction;
+		copiedVessel->stage = vessel->stage;
+		copiedVessel->branchingMode = vessel->branchingMode;
+		copiedVessel->vesselFunction = vessel->vesselFunction;
+		copiedVessel->localResistance = vessel->localResistance;
+		copiedVessel->pressure = vessel->pressure;
+		copiedVessel->ID = vessel->ID;
+	}
+	return copy;
+}
+
 SingleVessel* SingleVesselCCOOTree::cloneTree(SingleVessel* root, unordered_map<long long, AbstractVascularElement *> *segments) {
 
-	SingleVessel *copy = new SingleVessel();
+	SingleVessel *rootCopy = NULL;
+	//	Copy of the vessel being visited; its children are copied next
+	SingleVessel *currentCopy = NULL;
+	TreeTraversal::depthFirst(root,
+		[&](AbstractVascularElement *element) {
+			SingleVessel *vessel = (SingleVessel *) element;
+			SingleVessel *copy = new SingleVessel();
+
+			copy->parent = currentCopy;
+			copy->vtkSegmentId = vessel->vtkSegmentId;
+			copy->xProx = vessel->xProx;
+			copy->xDist = vessel->xDist;
+			copy->nLevel = vessel->nLevel;
+			copy->radius = vessel->radius;
+			copy->beta = vessel->beta;
+			copy->length = vessel->length;
+			copy->resistance = vessel->resistance;
+			copy->flow = vessel->flow;
+			copy->viscosity = vessel->viscosity;
+			copy->treeVolume = vessel->treeVolume;
+			copy->commonTerminals = vessel->commonTerminals;
+			copy->reservedFlow = vessel->reservedFlow;
+
+			(*segments)[copy->vtkSegmentId] = copy;
+
+			if (currentCopy) {
+				currentCopy->children.push_back(copy);
+			} else {
+				rootCopy = copy;
+			}
+			currentCopy = copy;
+		},
+		[&](AbstractVascularElement */*element*/) {
+			currentCopy = (SingleVessel *) currentCopy->parent;
+		});
 
-	copy->parent = NULL;
-	copy->vtkSegmentId = root->vtkSegmentId;
-	copy->xProx = root->xProx;
-	copy->xDist = root->xDist;
-	copy->nLevel = root->nLevel;
-	copy->radius = root->radius;
-	copy->beta = root->beta;
-	copy->length = root->length;
-	copy->resistance = root->resistance;
-	copy->flow = root->flow;
-	copy->viscosity = root->viscosity;
-	copy->treeVolume = root->treeVolume;
+	return rootCopy;
+}
 
-	(*segments)[copy->vtkSegmentId] = copy;
+int SingleVesselCCOOTree::splitSweep(SingleVessel *root, vector<SingleVessel *> &upper, vector<SingleVessel *> &subtrees) {
+	int nThreads = omp_get_max_threads();
+	if (parallelSweepCutoff <= 0 || root->commonTerminals < parallelSweepCutoff || nThreads < 2 || omp_in_parallel()) {
+		return 0;
+	}
 
-	vector<AbstractVascularElement *> rootChildren = root->getChildren();
-	for (unsigned int i = 0; i < rootChildren.size(); ++i) {
-		copy->children.push_back(cloneTree((SingleVessel*) rootChildren[i], segments));
-		copy->children[i]->parent = copy;
+	//	Several subtrees per thread so the dynamic schedule can balance them
+	long long int subtreeSize = max(root->commonTerminals / (16 * nThreads), 256ll);
+	vector<SingleVessel *> pending;
+	pending.push_back(root);
+	while (!pending.empty()) {
+		SingleVessel *vessel = pending.back();
+		pending.pop_back();
+		vector<AbstractVascularElement *> &vesselChildren = vessel->getChildren();
+		if (vessel->commonTerminals <= subtreeSize || vesselChildren.empty()) {
+			subtrees.push_back(vessel);
+			continue;
+		}
+		upper.push_back(vessel);
+		for (vector<AbstractVascularElement *>::reverse_iterator it = vesselChildren.rbegin(); it != vesselChildren.rend(); ++it) {
+			pending.push_back((SingleVessel *) (*it));
+		}
 	}
 
-	return copy;
+	//	Largest subtrees first
+	sort(subtrees.begin(), subtrees.end(), [](SingleVessel *a, SingleVessel *b) {
+		return a->commonTerminals > b->commonTerminals;
+	});
+	return 1;
 }
 
 void SingleVesselCCOOTree::updateTree(SingleVessel* root, SingleVesselCCOOTree* tree) {
+	vector<SingleVessel *> upper, subtrees;
+	if (splitSweep(root, upper, subtrees)) {
+		for (vector<SingleVessel *>::iterator it = upper.begin(); it != upper.end(); ++it) {
+			vector<AbstractVascularElement *> &vesselChildren = (*it)->getChildren();
+			for (vector<AbstractVascularElement *>::iterator it2 = vesselChildren.begin(); it2 != vesselChildren.end(); ++it2) {
+				((SingleVessel *) (*it2))->nLevel = (*it)->nLevel + 1;
+			}
+		}
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < (int) subtrees.size(); ++i) {
+			updateTree(subtrees[i], tree);
+		}
+		//	Children precede their parents in reverse pre-order
+		for (vector<SingleVessel *>::reverse_iterator it = upper.rbegin(); it != upper.rend(); ++it) {
+			updateTreeNode(*it, tree);
+		}
+		return;
+	}
+
+	TreeTraversal::depthFirst(root,
+		[](AbstractVascularElement *element) {
+			SingleVessel *vessel = (SingleVessel *) element;
+			vector<AbstractVascularElement *> &vesselChildren = vessel->getChildren();
+			for (vector<AbstractVascularElement *>::iterator it = vesselChildren.begin(); it != vesselChildren.end(); ++it) {
+				((SingleVessel *) (*it))->nLevel = vessel->nLevel + 1;
+			}
+		},
+		[this, tree](AbstractVascularElement *element) {
+			updateTreeNode((SingleVessel *) element, tree);
+		});
+}
+
+void SingleVesselCCOOTree::updateTreeNode(SingleVessel* root, SingleVesselCCOOTree* tree) {
 	if (root->getChildren().empty()) {
 		root->flow = root->getTerminalFlow(tree->qProx, tree->qProx * tree->qReservedFactor, tree->nCommonTerminals); //tree->qProx / tree->nTerms;
 //		cout << tree->qProx << " " << tree->qReservedFactor << " " << tree->nCommonTerminals << " " << root->flow << endl;
+		if (root->terminalType == AbstractVascularElement::TERMINAL_TYPE::RESERVED) {
+			root->commonTerminals = 0;
+			root->reservedFlow = root->flow;
+		} else {
+			root->commonTerminals = 1;
+			root->reservedFlow = 0.0;
+		}
 	} else {
-		vector<AbstractVascularElement *> rootChildren = root->getChildren();
+		vector<AbstractVascularElement *> &rootChildren = root->getChildren();
 		double totalFlow = 0.0;
 		double invTotalResistance = 0.0;
+		root->commonTerminals = 0;
+		root->reservedFlow = 0.0;
 		for (vector<AbstractVascularElement *>::iterator it = rootChildren.begin(); it != rootChildren.end(); ++it) {
 			SingleVessel *currentVessel = (SingleVessel *) (*it);
-			currentVessel->nLevel = root->nLevel + 1;
-			updateTree(currentVessel, tree);
 			totalFlow += currentVessel->flow;
 			invTotalResistance += 1 / currentVessel->resistance;
+			root->commonTerminals += currentVessel->commonTerminals;
+			root->reservedFlow += currentVessel->reservedFlow;
 		}
 		root->flow = totalFlow;
 
@@ -1706,14 +2181,14 @@ void SingleVesselCCOOTree::updateTree(SingleVessel* root, SingleVesselCCOOTree*
 				double siblingsResistance = 1 / (invTotalResistance - 1 / currentVessel->resistance);
 				double betaRatio = sqrt(sqrt((siblingsFlow * siblingsResistance) / (currentVessel->flow * currentVessel->resistance)));
 
-				currentVessel->beta = pow(1 + pow(betaRatio, gam->getValue(currentVessel->nLevel)), -1.0 / gam->getValue(currentVessel->nLevel));
+				currentVessel->beta = getMurrayBeta(betaRatio, currentVessel->nLevel);
 
 				double betaSqr = currentVessel->beta * currentVessel->beta;
 				//	Check! This expression
 				invResistanceContributions += betaSqr * betaSqr / currentVessel->resistance;
 			}
 		}
-		root->localResistance = 8 * nu->getValue(root->nLevel) / M_PI * root->length;
+		root->localResistance = 8 * nuTable.getValue(root->nLevel) / M_PI * root->length;
 		//	Check! Is not 1/ (1/localResistance + invResistanceContribution)?
 		root->resistance = root->localResistance + 1 / invResistanceContributions;
 	}
@@ -1742,33 +2217,57 @@ int SingleVesselCCOOTree::areValidAngles(point xBif, point xNew, SingleVessel* p
 }
 
 void SingleVesselCCOOTree::updateTreeViscositiesBeta(SingleVessel* root, double* maxBetaVariation) {
-	if (root->parent) {
-		root->radius = root->beta * ((SingleVessel*) root->parent)->radius;
-	} else {
-		root->radius = root->beta;
+	auto updateRadius = [](AbstractVascularElement *element) {
+		SingleVessel *vessel = (SingleVessel *) element;
+		if (vessel->parent) {
+			vessel->radius = vessel->beta * ((SingleVessel*) vessel->parent)->radius;
+		} else {
+			vessel->radius = vessel->beta;
+		}
+	};
+
+	vector<SingleVessel *> upper, subtrees;
+	if (splitSweep(root, upper, subtrees)) {
+		for (vector<SingleVessel *>::iterator it = upper.begin(); it != upper.end(); ++it) {
+			updateRadius(*it);
+		}
+		double maxVariation = 0.0;
+		#pragma omp parallel for schedule(dynamic, 1) reduction(max : maxVariation)
+		for (int i = 0; i < (int) subtrees.size(); ++i) {
+			double subtreeVariation;
+			updateTreeViscositiesBeta(subtrees[i], &subtreeVariation);
+			if (subtreeVariation > maxVariation) {
+				maxVariation = subtreeVariation;
+			}
+		}
+		*maxBetaVariation = maxVariation;
+		for (vector<SingleVessel *>::reverse_iterator it = upper.rbegin(); it != upper.rend(); ++it) {
+			updateViscositiesBetaNode(*it, maxBetaVariation);
+		}
+		return;
 	}
 
-	vector<AbstractVascularElement *> rootChildren = root->getChildren();
+	*maxBetaVariation = 0.0;
+	TreeTraversal::depthFirst(root, updateRadius,
+		[this, maxBetaVariation](AbstractVascularElement *element) {
+			updateViscositiesBetaNode((SingleVessel *) element, maxBetaVariation);
+		});
+}
+
+void SingleVesselCCOOTree::updateViscositiesBetaNode(SingleVessel* root, double* maxBetaVariation) {
+	vector<AbstractVascularElement *> &rootChildren = root->getChildren();
 	if (rootChildren.empty()) {
 		root->viscosity = getNuFL(root->radius);
 		root->resistance = 8 * root->viscosity / M_PI * root->length;
 		root->pressure = root->resistance * root->flow + refPressure;
 		root->treeVolume = root->radius * root->radius * M_PI * root->length;
-		*maxBetaVariation = 0.0;
 	} else {
 
 		double totalChildrenFlow = 0.0;
 		double totalChildrenVolume = 0.0;
 		double invTotalResistance = 0.0;
-		*maxBetaVariation = 0.0;
 		for (vector<AbstractVascularElement *>::iterator it = rootChildren.begin(); it != rootChildren.end(); ++it) {
 			SingleVessel *currentVessel = (SingleVessel *) (*it);
-			double betaVariation;
-			updateTreeViscositiesBeta(currentVessel, &betaVariation);
-
-			if (betaVariation > *maxBetaVariation)
-				*maxBetaVariation = betaVariation;
-
 			totalChildrenFlow += currentVessel->flow;
 			totalChildrenVolume += currentVessel->treeVolume;
 			invTotalResistance += 1 / currentVessel->resistance;
@@ -1791,7 +2290,7 @@ void SingleVesselCCOOTree::updateTreeViscositiesBeta(SingleVessel* root, double*
 				double siblingsResistance = 1 / (invTotalResistance - 1 / currentVessel->resistance);
 				double betaRatio = sqrt(sqrt(((totalChildrenFlow - currentVessel->flow) * siblingsResistance) / (currentVessel->flow * currentVessel->resistance)));
 				double previousBeta = currentVessel->beta;
-				currentVessel->beta = pow(1 + pow(betaRatio, gam->getValue(currentVessel->nLevel)), -1 / gam->getValue(currentVessel->nLevel));
+				currentVessel->beta = getMurrayBeta(betaRatio, currentVessel->nLevel);
 
 				double betaVariation = abs(currentVessel->beta - previousBeta);
 				if (betaVariation > *maxBetaVariation)
@@ -1813,6 +2312,284 @@ void SingleVesselCCOOTree::updateTreeViscositiesBeta(SingleVessel* root, double*
 
 }
 
+int SingleVesselCCOOTree::solveViscositiesBeta(SingleVessel *root) {
+	double maxVariation = INFINITY;
+	FixedPointIteration iteration(variationTolerance, maxViscosityIterations, viscosityAccelerator);
+	if (iteration.isAccelerated()) {
+		vector<double *> &betas = iteration.getState();
+		TreeTraversal::preOrder(root, [&betas](AbstractVascularElement *vessel) {
+			betas.push_back(&((SingleVessel *) vessel)->beta);
+		});
+	}
+	while (iteration.next(maxVariation)) {
+		updateTreeViscositiesBeta(root, &maxVariation);
+	}
+	countViscositySolve(iteration.getIterations());
+	return iteration.getIterations();
+}
+
+void SingleVesselCCOOTree::countViscositySolve(int iterations) {
+	//	Solves of concurrent evaluations share the counters
+	#pragma omp atomic
+	viscositySolves++;
+	#pragma omp atomic
+	viscosityIterations += iterations;
+}
+
+double SingleVesselCCOOTree::updateTreeIncremental(SingleVessel* bifurcation) {
+
+	updateLevels(bifurcation);
+
+	//	Vessels to update ordered from distal to proximal: non-terminal children of the bifurcation and the bifurcation-to-root path.
+	vector<SingleVessel *> path;
+	vector<AbstractVascularElement *> &bifurcationChildren = bifurcation->getChildren();
+	for (vector<AbstractVascularElement *>::iterator it = bifurcationChildren.begin(); it != bifurcationChildren.end(); ++it) {
+		SingleVessel *currentVessel = (SingleVessel *) (*it);
+		if (!currentVessel->getChildren().empty()) {
+			updateBifurcation(currentVessel);
+			path.push_back(currentVessel);
+		}
+	}
+	int nBifurcationChildren = path.size();
+	for (SingleVessel *currentVessel = bifurcation; currentVessel; currentVessel = (SingleVessel *) currentVessel->parent) {
+		updateBifurcation(currentVessel);
+		path.push_back(currentVessel);
+	}
+
+	//	Update resistance, pressure and betas along the path
+	double maxVariation = INFINITY;
+	double firstVariation = 0.0;
+	FixedPointIteration iteration(variationTolerance, maxViscosityIterations, viscosityAccelerator);
+	if (iteration.isAccelerated()) {
+		vector<double *> &betas = iteration.getState();
+		betas.push_back(&path.back()->beta);
+		for (vector<SingleVessel *>::iterator it = path.begin(); it != path.end(); ++it) {
+			vector<AbstractVascularElement *> &vesselChildren = (*it)->getChildren();
+			for (vector<AbstractVascularElement *>::iterator it2 = vesselChildren.begin(); it2 != vesselChildren.end(); ++it2) {
+				betas.push_back(&((SingleVessel *) (*it2))->beta);
+			}
+		}
+	}
+	while (iteration.next(maxVariation)) {
+		updatePathViscositiesBeta(path, nBifurcationChildren, &maxVariation);
+		if (iteration.getIterations() == 1) {
+			firstVariation = maxVariation;
+		}
+	}
+	countViscositySolve(iteration.getIterations());
+	return firstVariation;
+}
+
+void SingleVesselCCOOTree::reconcileIfNeeded(int insertions, double error) {
+	insertionsSinceReconciliation += insertions;
+	reconciliationError += error;
+	//	Without a bound set by the caller, the results stay within the tolerance of the full update
+	double errorBound = reconciliationTolerance > 0.0 ? reconciliationTolerance : variationTolerance;
+	if (!(reconciliationInterval > 0 && insertionsSinceReconciliation >= reconciliationInterval)
+			&& !(reconciliationError > errorBound)) {
+		return;
+	}
+	reconcile();
+}
+
+void SingleVesselCCOOTree::updateDeferredValues() {
+	if (insertionsSinceReconciliation > 0) {
+		reconcile();
+	}
+}
+
+void SingleVesselCCOOTree::reconcile() {
+	vector<SingleVessel *> vessels;
+	getVesselsInPreOrder(vessels);
+	vector<double> previousBetas(vessels.size());
+	for (unsigned i = 0; i < vessels.size(); ++i) {
+		previousBetas[i] = vessels[i]->beta;
+	}
+	double previousVolume = ((SingleVessel *) root)->treeVolume;
+
+	updateTree(((SingleVessel *) root), this);
+	solveViscositiesBeta((SingleVessel *) root);
+
+	double drift = 0.0;
+	for (unsigned i = 0; i < vessels.size(); ++i) {
+		drift = max(drift, abs(vessels[i]->beta - previousBetas[i]));
+	}
+	double volume = ((SingleVessel *) root)->treeVolume;
+	accumulatedDrift += drift;
+	if (isDriftLogged) {
+		cout << "Full update after " << insertionsSinceReconciliation << " incremental insertions: estimated error " << reconciliationError
+				<< " - beta drift " << drift << " - volume drift " << abs(volume - previousVolume) / volume << " - accumulated beta drift "
+				<< accumulatedDrift << endl;
+	}
+
+	insertionsSinceReconciliation = 0;
+	reconciliationError = 0.0;
+}
+
+void SingleVesselCCOOTree::updateLevels(SingleVessel* root) {
+	int childrenLevel = root->nLevel + 1;
+	vector<AbstractVascularElement *> &rootChildren = root->getChildren();
+	for (vector<AbstractVascularElement *>::iterator it = rootChildren.begin(); it != rootChildren.end(); ++it) {
+		SingleVessel *currentVessel = (SingleVessel *) (*it);
+		currentVessel->nLevel = childrenLevel;
+		vector<AbstractVascularElement *> &currentChildren = currentVessel->getChildren();
+		if (!currentChildren.empty() && ((SingleVessel *) currentChildren[0])->nLevel != childrenLevel + 1) {
+			updateLevels(currentVessel);
+		}
+	}
+}
+
+void SingleVesselCCOOTree::updateBifurcation(SingleVessel* vessel) {
+	vector<AbstractVascularElement *> &vesselChildren = vessel->getChildren();
+	if (vesselChildren.empty()) {
+		vessel->flow = vessel->getTerminalFlow(qProx, qProx * qReservedFactor, nCommonTerminals);
+		if (vessel->terminalType == AbstractVascularElement::TERMINAL_TYPE::RESERVED) {
+			vessel->commonTerminals = 0;
+			vessel->reservedFlow = vessel->flow;
+		} else {
+			vessel->commonTerminals = 1;
+			vessel->reservedFlow = 0.0;
+		}
+		return;
+	}
+
+	double commonTerminalFlow = (qProx - qProx * qReservedFactor) / nCommonTerminals;
+	double totalFlow = 0.0;
+	double invTotalResistance = 0.0;
+	vessel->commonTerminals = 0;
+	vessel->reservedFlow = 0.0;
+	for (vector<AbstractVascularElement *>::iterator it = vesselChildren.begin(); it != vesselChildren.end(); ++it) {
+		SingleVessel *currentVessel = (SingleVessel *) (*it);
+		if (currentVessel->getChildren().empty()) {
+			updateBifurcation(currentVessel);
+		} else {
+			currentVessel->flow = currentVessel->commonTerminals * commonTerminalFlow + currentVessel->reservedFlow;
+		}
+		totalFlow += currentVessel->flow;
+		invTotalResistance += 1 / currentVessel->resistance;
+		vessel->commonTerminals += currentVessel->commonTerminals;
+		vessel->reservedFlow += currentVessel->reservedFlow;
+	}
+	vessel->flow = totalFlow;
+
+	double invResistanceContributions = 0.0;
+	if (vesselChildren.size() == 1) {
+		SingleVessel *currentVessel = (SingleVessel *) vesselChildren[0];
+		currentVessel->beta = 1.0;
+		invResistanceContributions = 1 / currentVessel->resistance;
+	} else {
+		for (vector<AbstractVascularElement *>::iterator it = vesselChildren.begin(); it != vesselChildren.end(); ++it) {
+			SingleVessel *currentVessel = (SingleVessel *) (*it);
+			double siblingsFlow = totalFlow - currentVessel->flow;
+			double siblingsResistance = 1 / (invTotalResistance - 1 / currentVessel->resistance);
+			double betaRatio = sqrt(sqrt((siblingsFlow * siblingsResistance) / (currentVessel->flow * currentVessel->resistance)));
+
+			currentVessel->beta = getMurrayBeta(betaRatio, currentVessel->nLevel);
+
+			double betaSqr = currentVessel->beta * currentVessel->beta;
+			invResistanceContributions += betaSqr * betaSqr / currentVessel->resistance;
+		}
+	}
+	vessel->localResistance = 8 * nuTable.getValue(vessel->nLevel) / M_PI * vessel->length;
+	vessel->resistance = vessel->localResistance + 1 / invResistanceContributions;
+}
+
+void SingleVesselCCOOTree::updatePathViscositiesBeta(vector<SingleVessel *> &path, int nBifurcationChildren, double *maxBetaVariation) {
+
+	//	Radii are propagated from the root to the bifurcation
+	for (int i = path.size() - 1; i >= 0; --i) {
+		SingleVessel *currentVessel = path[i];
+		if (currentVessel->parent) {
+			currentVessel->radius = currentVessel->beta * ((SingleVessel*) currentVessel->parent)->radius;
+		} else {
+			currentVessel->radius = currentVessel->beta;
+		}
+	}
+
+	*maxBetaVariation = 0.0;
+	for (int i = 0; i < (int) path.size(); ++i) {
+		SingleVessel *vessel = path[i];
+		vector<AbstractVascularElement *> &vesselChildren = vessel->getChildren();
+
+		double totalChildrenFlow = 0.0;
+		double totalChildrenVolume = 0.0;
+		double invTotalResistance = 0.0;
+		for (vector<AbstractVascularElement *>::iterator it = vesselChildren.begin(); it != vesselChildren.end(); ++it) {
+			SingleVessel *currentVessel = (SingleVessel *) (*it);
+
+			int isInPath;
+			if (i < nBifurcationChildren) {
+				isInPath = 0;
+			} else if (i == nBifurcationChildren) {
+				isInPath = !currentVessel->getChildren().empty();
+			} else {
+				isInPath = currentVessel == path[i - 1];
+			}
+
+			//	Off-path vessels only update their own segment; the volume of their subtree is rescaled since its betas are unchanged.
+			if (!isInPath) {
+				double radius = currentVessel->beta * vessel->radius;
+				if (currentVessel->getChildren().empty()) {
+					currentVessel->radius = radius;
+					currentVessel->viscosity = getNuFL(radius);
+					currentVessel->resistance = 8 * currentVessel->viscosity / M_PI * currentVessel->length;
+					currentVessel->treeVolume = radius * radius * M_PI * currentVessel->length;
+				} else {
+					double radiusRatio = radius / currentVessel->radius;
+					double downstreamResistance = currentVessel->resistance - currentVessel->localResistance;
+					currentVessel->radius = radius;
+					currentVessel->viscosity = getNuFL(radius);
+					currentVessel->localResistance = 8 * currentVessel->viscosity / M_PI * currentVessel->length;
+					currentVessel->resistance = currentVessel->localResistance + downstreamResistance;
+					currentVessel->treeVolume *= radiusRatio * radiusRatio;
+				}
+				double radiusSqr = radius * radius;
+				currentVessel->pressure = currentVessel->resistance * currentVessel->flow / (radiusSqr * radiusSqr) + refPressure;
+			}
+
+			totalChildrenFlow += currentVessel->flow;
+			totalChildrenVolume += currentVessel->treeVolume;
+			invTotalResistance += 1 / currentVessel->resistance;
+		}
+
+		double invResistanceContributions = 0.0;
+		if (vesselChildren.size() == 1) {
+			SingleVessel *currentVessel = (SingleVessel *) vesselChildren[0];
+
+			double previousBeta = currentVessel->beta;
+			currentVessel->beta = 1.0;
+			double betaVariation = abs(currentVessel->beta - previousBeta);
+			if (betaVariation > *maxBetaVariation)
+				*maxBetaVariation = betaVariation;
+
+			invResistanceContributions = 1 / currentVessel->resistance;
+		} else {
+			for (vector<AbstractVascularElement *>::iterator it = vesselChildren.begin(); it != vesselChildren.end(); ++it) {
+				SingleVessel *currentVessel = (SingleVessel *) (*it);
+				double siblingsResistance = 1 / (invTotalResistance - 1 / currentVessel->resistance);
+				double betaRatio = sqrt(sqrt(((totalChildrenFlow - currentVessel->flow) * siblingsResistance) / (currentVessel->flow * currentVessel->resistance)));
+				double previousBeta = currentVessel->beta;
+				currentVessel->beta = getMurrayBeta(betaRatio, currentVessel->nLevel);
+
+				double betaVariation = abs(currentVessel->beta - previousBeta);
+				if (betaVariation > *maxBetaVariation)
+					*maxBetaVariation = betaVariation;
+
+				double betaSqr = currentVessel->beta * currentVessel->beta;
+				invResistanceContributions += betaSqr * betaSqr / currentVessel->resistance;
+			}
+		}
+
+		vessel->viscosity = getNuFL(vessel->radius);
+		vessel->localResistance = 8 * vessel->viscosity / M_PI * vessel->length;
+		vessel->resistance = vessel->localResistance + 1 / invResistanceContributions;
+		vessel->treeVolume = vessel->radius * vessel->radius * M_PI * vessel->length + totalChildrenVolume;
+
+		double radiusSqr = vessel->radius * vessel->radius;
+		vessel->pressure = vessel->resistance * vessel->flow / (radiusSqr * radiusSqr) + refPressure;
+	}
+}
+
 SingleVesselCCOOTree* SingleVesselCCOOTree::cloneUpTo(int levels, SingleVessel* parent) {
 
 	SingleVessel *subtreeRoot = parent;
@@ -1832,13 +2609,191 @@ SingleVesselCCOOTree* SingleVesselCCOOTree::cloneUpTo(int levels, SingleVessel*
 	copy->nTerms = this->nTerms;
 
 	copy->root = this->cloneTree(subtreeRoot, &(copy->elements));
-	((SingleVessel *) copy->root)->beta = subtreeRoot->radius;
-	((SingleVessel *) copy->root)->radius = subtreeRoot->radius;
+
+	//	The subtree volume is rescaled in case that the stored radius is outdated
+	double subtreeRadius = getUpdatedRadius(subtreeRoot);
+	double radiusRatio = subtreeRadius / subtreeRoot->radius;
+	((SingleVessel *) copy->root)->treeVolume *= radiusRatio * radiusRatio;
+	((SingleVessel *) copy->root)->beta = subtreeRadius;
+	((SingleVessel *) copy->root)->radius = subtreeRadius;
+
+	return copy;
+
+}
+
+SingleVesselCCOOTree* SingleVesselCCOOTree::cloneUpTo(int levels, SingleVessel* parent, EvaluationScratch *scratch, SingleVessel **clonedParent) {
+
+	SingleVessel *subtreeRoot = parent;
+
+	//	Identify N levels root
+	for (int i = 0; i < levels && subtreeRoot->parent; ++i) {
+		subtreeRoot = (SingleVessel*) subtreeRoot->parent;
+	}
+
+	//	Same parameters as the tree created by cloneUpTo
+	SingleVesselCCOOTree *copy = scratch->tree;
+	copy->xPerf = this->xPerf;
+	copy->rootRadius = this->rootRadius;
+	copy->qProx = this->qProx;
+	//	The tables of the scratch tree are only compiled again when the stage functions change
+	if (copy->gam != this->gam) {
+		copy->setGam(this->gam);
+	}
+	if (copy->epsLim != this->epsLim) {
+		copy->setEpsLim(this->epsLim);
+	}
+	if (copy->nu != this->nu) {
+		copy->setNu(this->nu);
+	}
+	copy->refPressure = this->refPressure;
+	copy->variationTolerance = this->variationTolerance;
+	copy->instanceData = this->instanceData;
+	copy->nCommonTerminals = this->nCommonTerminals;
+	copy->currentStage = this->currentStage;
+	copy->qReservedFactor = this->qReservedFactor;
+	copy->psiFactor = this->psiFactor;
+	copy->dp = this->dp;
+	copy->nTerms = this->nTerms;
+
+	scratch->nUsed = 0;
+	copy->root = this->cloneTree(subtreeRoot, scratch, parent, clonedParent);
+
+	//	The subtree volume is rescaled in case that the stored radius is outdated
+	double subtreeRadius = getUpdatedRadius(subtreeRoot);
+	double radiusRatio = subtreeRadius / subtreeRoot->radius;
+	((SingleVessel *) copy->root)->treeVolume *= radiusRatio * radiusRatio;
+	((SingleVessel *) copy->root)->beta = subtreeRadius;
+	((SingleVessel *) copy->root)->radius = subtreeRadius;
 
 	return copy;
 
 }
 
+SingleVessel* SingleVesselCCOOTree::cloneTree(SingleVessel* root, EvaluationScratch *scratch, SingleVessel *parent, SingleVessel **clonedParent) {
+
+	SingleVessel *rootCopy = NULL;
+	SingleVessel *currentCopy = NULL;
+	TreeTraversal::depthFirst(root,
+		[&](AbstractVascularElement *element) {
+			SingleVessel *vessel = (SingleVessel *) element;
+			SingleVessel *copy = getScratchVessel(scratch);
+
+			copy->vtkSegmentId = vessel->vtkSegmentId;
+			copy->xProx = vessel->xProx;
+			copy->xDist = vessel->xDist;
+			copy->nLevel = vessel->nLevel;
+			copy->radius = vessel->radius;
+			copy->beta = vessel->beta;
+			copy->length = vessel->length;
+			copy->resistance = vessel->resistance;
+			copy->flow = vessel->flow;
+			copy->viscosity = vessel->viscosity;
+			copy->treeVolume = vessel->treeVolume;
+			copy->commonTerminals = vessel->commonTerminals;
+			copy->reservedFlow = vessel->reservedFlow;
+
+			if (vessel == parent) {
+				*clonedParent = copy;
+			}
+
+			copy->parent = currentCopy;
+			if (currentCopy) {
+				currentCopy->children.push_back(copy);
+			} else {
+				rootCopy = copy;
+			}
+			currentCopy = copy;
+		},
+		[&](AbstractVascularElement */*element*/) {
+			currentCopy = (SingleVessel *) currentCopy->parent;
+		});
+
+	return rootCopy;
+}
+
+SingleVesselCCOOTree::EvaluationScratch *SingleVesselCCOOTree::getEvaluationScratch() {
+	if (!isScratchEvaluation) {
+		return NULL;
+	}
+	return getThreadScratch();
+}
+
+SingleVesselCCOOTree::EvaluationScratch *SingleVesselCCOOTree::getThreadScratch() {
+	unsigned int thread = omp_get_thread_num();
+	if (thread >= evaluationScratch.size()) {
+		return NULL;
+	}
+
+	//	Each thread only accesses its own entry
+	EvaluationScratch *scratch = evaluationScratch[thread];
+	if (!scratch) {
+		scratch = new EvaluationScratch();
+		scratch->tree = new SingleVesselCCOOTree(this->xPerf, this->rootRadius, this->qProx, this->getGam(), this->getEpsLim(), this->getNu(), this->refPressure,
+				this->variationTolerance, this->instanceData);
+		scratch->estimator = NULL;
+		scratch->estimatorSource = NULL;
+		scratch->nUsed = 0;
+		evaluationScratch[thread] = scratch;
+	}
+	if (scratch->estimatorSource != instanceData->costEstimator) {
+		delete scratch->estimator;
+		scratch->estimator = instanceData->costEstimator->clone();
+		scratch->estimatorSource = instanceData->costEstimator;
+	}
+
+	return scratch;
+}
+
+SingleVessel *SingleVesselCCOOTree::getScratchVessel(EvaluationScratch *scratch) {
+	if (scratch->nUsed == scratch->vessels.size()) {
+		scratch->vessels.push_back(new SingleVessel());
+	}
+	SingleVessel *vessel = scratch->vessels[scratch->nUsed++];
+
+	//	Attributes set by the constructors; the children vector keeps its capacity
+	vessel->parent = NULL;
+	vessel->children.clear();
+	vessel->stage = 0;
+	vessel->qReservedFraction = 0.0;
+	vessel->vesselFunction = AbstractVascularElement::VESSEL_FUNCTION::DISTRIBUTION;
+	vessel->branchingMode = AbstractVascularElement::BRANCHING_MODE::DEFORMABLE_PARENT;
+	vessel->terminalType = AbstractVascularElement::TERMINAL_TYPE::COMMON;
+	vessel->commonTerminals = 0;
+	vessel->reservedFlow = 0.0;
+
+	return vessel;
+}
+
+void SingleVesselCCOOTree::releaseEvaluationScratch() {
+	for (unsigned int i = 0; i < evaluationScratch.size(); ++i) {
+		EvaluationScratch *scratch = evaluationScratch[i];
+		if (!scratch) {
+			continue;
+		}
+		//	The scratch tree does not own its vessels
+		scratch->tree->root = NULL;
+		scratch->tree->elements.clear();
+		delete scratch->tree;
+		for (unsigned int j = 0; j < scratch->vessels.size(); ++j) {
+			delete scratch->vessels[j];
+		}
+		delete scratch->estimator;
+		delete scratch;
+	}
+	evaluationScratch.clear();
+}
+
+inline double SingleVesselCCOOTree::getMurrayBeta(double betaRatio, int nLevel) {
+	//	Kernels for the usual exponents avoid the two pow calls of the general expression
+	double gamma = gamTable.getValue(nLevel);
+	if (gamma == 3.0) {
+		return 1.0 / cbrt(1.0 + betaRatio * betaRatio * betaRatio);
+	} else if (gamma == 2.0) {
+		return 1.0 / sqrt(1.0 + betaRatio * betaRatio);
+	}
+	return pow(1 + pow(betaRatio, gamma), -1.0 / gamma);
+}
+
 /**
  * Function for radius in milimeters
  * @param radius Vessel radius in millimeters
@@ -1867,75 +2822,382 @@ void SingleVesselCCOOTree::saveTree(ofstream *outFile) {
 	*outFile << rootRadius << " " << variationTolerance << " ";
 }
 
-string SingleVesselCCOOTree::getTreeName() {
-	return "SingleVesselCCOOTree";
+int SingleVesselCCOOTree::save(string filename) {
+	if (BinaryTreeFormat::isBinaryFilename(filename)) {
+		return saveBinary(filename);
+	} else {
+		return saveText(filename);
+	}
 }
 
-void SingleVesselCCOOTree::createSegmentVtkLines(AbstractVascularElement *vessel) {
+void SingleVesselCCOOTree::getVesselsInPreOrder(vector<SingleVessel *> &vessels) {
+	vector<SingleVessel *> pending;
+	if (root) {
+		pending.push_back((SingleVessel *) root);
+	}
+	while (!pending.empty()) {
+		SingleVessel *vessel = pending.back();
+		pending.pop_back();
+		vessels.push_back(vessel);
+		for (vector<AbstractVascularElement *>::reverse_iterator it = vessel->getChildren().rbegin(); it != vessel->getChildren().rend(); ++it) {
+			pending.push_back((SingleVessel *) *it);
+		}
+	}
+}
 
-	SingleVessel *currentVessel = (SingleVessel *) vessel;
-	point xp = currentVessel->xProx;
-	point xd = currentVessel->xDist;
-	point dNew = xp - xd;
+int SingleVesselCCOOTree::saveText(string filename) {
+	vector<SingleVessel *> vessels;
+	getVesselsInPreOrder(vessels);
+
+	//	Each block is formatted by a single thread so the lines keep the pre-order of AbstractObjectCCOTree::save
+	const long long int blockSize = 4096;
+	long long int nBlocks = (vessels.size() + blockSize - 1) / blockSize;
+	vector<string> dataBlocks(nBlocks);
+	vector<string> connectivityBlocks(nBlocks);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (long long int i = 0; i < nBlocks; ++i) {
+		long long int end = min((long long int) vessels.size(), (i + 1) * blockSize);
+		for (long long int j = i * blockSize; j < end; ++j) {
+			vessels[j]->appendVesselData(dataBlocks[i]);
+			dataBlocks[i] += '\n';
+			vessels[j]->appendVesselConnectivity(connectivityBlocks[i]);
+			connectivityBlocks[i] += '\n';
+		}
+	}
 
-	//	BUG!! Parent may not have vtkSegment since it was not visited yet.
-	SingleVessel *currentParent = (SingleVessel *) currentVessel->parent;
-	if (currentParent) {
-		currentVessel->nLevel = currentParent->nLevel + 1;
-		currentVessel->beta = currentVessel->radius / currentParent->radius;
-		currentVessel->length = sqrt(dNew ^ dNew);
-		currentVessel->viscosity = nu->getValue(currentVessel->nLevel);
-		currentVessel->resistance = 8 * nu->getValue(currentVessel->nLevel) / M_PI * currentVessel->length;
-		currentVessel->pressure = 0.0;
+	ofstream treeFile;
+	treeFile.open(filename.c_str(), ios::out);
+	treeFile.setf(ios::scientific, ios::floatfield);
+	treeFile.precision(16);
 
-		//	Update tree geometry
-		vtkIdType idDist = vtkTree->GetPoints()->InsertNextPoint(xd.p);
+	treeFile << "*Tree" << endl;
+	saveTree(&treeFile);
+	treeFile << endl << endl;
 
-		currentVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		currentVessel->vtkSegment->GetPointIds()->SetId(0, currentParent->vtkSegment->GetPointId(1)); // the second index is the global index of the mesh point
-		currentVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second index is the global index of the mesh point
+	treeFile << "*Vessels" << endl << elements.size() << endl;
+	for (long long int i = 0; i < nBlocks; ++i) {
+		treeFile.write(dataBlocks[i].data(), dataBlocks[i].size());
+	}
+	treeFile << endl;
 
-		currentVessel->vtkSegmentId = vtkTree->GetLines()->InsertNextCell(currentVessel->vtkSegment);
+	treeFile << "*Connectivity" << endl;
+	for (long long int i = 0; i < nBlocks; ++i) {
+		treeFile.write(connectivityBlocks[i].data(), connectivityBlocks[i].size());
+	}
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
-	} else {
-		currentVessel->nLevel = 0;
-		currentVessel->beta = rootRadius;
-		currentVessel->radius = rootRadius;
-		currentVessel->length = sqrt(dNew ^ dNew);
-		currentVessel->viscosity = nu->getValue(currentVessel->nLevel);
-		currentVessel->resistance = (8 * currentVessel->viscosity / M_PI) * currentVessel->length;
-		currentVessel->flow = qProx;
-		currentVessel->treeVolume = M_PI * currentVessel->length * rootRadius * rootRadius;
-		currentVessel->pressure = 0.0;
+	treeFile.flush();
+	treeFile.close();
+	return !treeFile.fail();
+}
 
-		//	Tree quantities
-		psiFactor = pow(currentVessel->beta, 4) / currentVessel->flow;
-		dp = currentVessel->resistance / psiFactor;
+int SingleVesselCCOOTree::saveBinary(string filename) {
+	//	Pre-order, as the .cco text file
+	vector<SingleVessel *> vessels;
+	getVesselsInPreOrder(vessels);
+	unordered_map<SingleVessel *, int64_t> indexes;
+	for (size_t i = 0; i < vessels.size(); ++i) {
+		indexes[vessels[i]] = i;
+	}
+	int64_t nVessels = vessels.size();
+	int64_t nChildren = nVessels > 0 ? nVessels - 1 : 0;
+
+	vector<char> payload(BinaryTreeFormat::getPayloadSize(nVessels, nChildren));
+	BinaryTreeFormat::VesselRecord *records = (BinaryTreeFormat::VesselRecord *) payload.data();
+	int64_t *parents = (int64_t *) (records + nVessels);
+	int64_t *childOffsets = parents + nVessels;
+	int64_t *children = childOffsets + nVessels + 1;
+	int64_t nextChild = 0;
+	for (int64_t i = 0; i < nVessels; ++i) {
+		SingleVessel *vessel = vessels[i];
+		BinaryTreeFormat::VesselRecord &record = records[i];
+		record.id = vessel->vtkSegmentId;
+		for (int j = 0; j < 3; ++j) {
+			record.xProx[j] = vessel->xProx.p[j];
+			record.xDist[j] = vessel->xDist.p[j];
+		}
+		record.qReservedFraction = vessel->qReservedFraction;
+		record.radius = vessel->radius;
+		record.branchingMode = vessel->branchingMode;
+		record.vesselFunction = vessel->vesselFunction;
+		record.stage = vessel->stage;
+		record.terminalType = vessel->terminalType;
+
+		parents[i] = vessel->parent ? indexes[(SingleVessel *) vessel->parent] : -1;
+		childOffsets[i] = nextChild;
+		for (vector<AbstractVascularElement *>::iterator it = vessel->getChildren().begin(); it != vessel->getChildren().end(); ++it) {
+			children[nextChild++] = indexes[(SingleVessel *) *it];
+		}
+	}
+	childOffsets[nVessels] = nextChild;
 
-		//	Update tree geometry
-		vtkSmartPointer<vtkPoints> pts = vtkSmartPointer<vtkPoints>::New();
-		vtkIdType idProx = pts->InsertNextPoint(currentVessel->xProx.p);
-		vtkIdType idDist = pts->InsertNextPoint(currentVessel->xDist.p);
-		vtkTree->SetPoints(pts);
+	BinaryTreeFormat::Header header;
+	memset(&header, 0, sizeof(header));
+	header.flags = BinaryTreeFormat::isCompressedFilename(filename) ? BinaryTreeFormat::COMPRESSED : 0;
+	for (int j = 0; j < 3; ++j) {
+		header.xPerf[j] = xPerf.p[j];
+	}
+	header.qProx = qProx;
+	header.psiFactor = psiFactor;
+	header.dp = dp;
+	header.refPressure = refPressure;
+	header.rootRadius = rootRadius;
+	header.variationTolerance = variationTolerance;
+	header.nTerms = nTerms;
+	header.pointCounter = pointCounter;
+	header.nVessels = nVessels;
+	header.nChildren = nChildren;
+
+	return BinaryTreeFormat::write(filename, header, payload);
+}
 
-		currentVessel->vtkSegment = vtkSmartPointer<vtkLine>::New();
-		currentVessel->vtkSegment->GetPointIds()->SetId(0, idProx); // the second 0 is the index of xProx
-		currentVessel->vtkSegment->GetPointIds()->SetId(1, idDist); // the second 1 is the index of xDist
-		vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
-		currentVessel->vtkSegmentId = lines->InsertNextCell(currentVessel->vtkSegment);
-		vtkTree->SetLines(lines);
+int SingleVesselCCOOTree::loadBinary(string filename) {
+	BinaryTreeFormat file(filename);
+	if (!file.isValid()) {
+		return 0;
+	}
 
-		vtkTree->BuildCells();
-		vtkTree->Modified();
+	BinaryTreeFormat::Header &header = file.getHeader();
+	for (int j = 0; j < 3; ++j) {
+		xPerf.p[j] = header.xPerf[j];
 	}
+	qProx = header.qProx;
+	psiFactor = header.psiFactor;
+	dp = header.dp;
+	refPressure = header.refPressure;
+	rootRadius = header.rootRadius;
+	variationTolerance = header.variationTolerance;
+	pointCounter = header.pointCounter;
+
+	int64_t nVessels = header.nVessels;
+	const BinaryTreeFormat::VesselRecord *records = file.getVessels();
+	const int64_t *parents = file.getParents();
+	const int64_t *childOffsets = file.getChildOffsets();
+	const int64_t *children = file.getChildren();
+
+	vector<SingleVessel *> vessels(nVessels);
+	for (int64_t i = 0; i < nVessels; ++i) {
+		vessels[i] = new SingleVessel();
+	}
+	double accReservedFlowFraction = 0.0;
+	this->root = NULL;
+	for (int64_t i = 0; i < nVessels; ++i) {
+		SingleVessel *v = vessels[i];
+		const BinaryTreeFormat::VesselRecord &record = records[i];
+		v->vtkSegmentId = record.id;
+		for (int j = 0; j < 3; ++j) {
+			v->xProx.p[j] = record.xProx[j];
+			v->xDist.p[j] = record.xDist[j];
+		}
+		v->qReservedFraction = record.qReservedFraction;
+		accReservedFlowFraction += record.qReservedFraction;
+		v->radius = record.radius;
+		v->branchingMode = static_cast<AbstractVascularElement::BRANCHING_MODE>(record.branchingMode);
+		v->vesselFunction = static_cast<AbstractVascularElement::VESSEL_FUNCTION>(record.vesselFunction);
+		v->stage = record.stage;
+		v->terminalType = static_cast<AbstractVascularElement::TERMINAL_TYPE>(record.terminalType);
+
+		if (parents[i] == -1) {
+			v->parent = NULL;
+			this->root = v;
+		} else {
+			v->parent = vessels[parents[i]];
+		}
+		for (int64_t j = childOffsets[i]; j < childOffsets[i + 1]; ++j) {
+			v->addChild(vessels[children[j]]);
+		}
+		this->elements[v->vtkSegmentId] = v;
+	}
+	this->qReservedFactor = accReservedFlowFraction;
 
-	vector<AbstractVascularElement *> children = currentVessel->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
-		createSegmentVtkLines(*it);
+	this->nTerms = this->getNTerminals();
+	this->nCommonTerminals = getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON);
+	cout << "Tree loaded from " << filename << ": " << nVessels << " vessels - Terminals " << nTerms << " - Common terminals "
+			<< nCommonTerminals << " - qReserved fraction " << qReservedFactor << endl;
+	if (loadingProgress) {
+		loadingProgress(nVessels, nVessels);
 	}
 
+	return 1;
+}
+
+int SingleVesselCCOOTree::loadText(string filename, int isHeMoLabFormat) {
+	ifstream treeFile(filename.c_str(), ios::in | ios::binary);
+	if (!treeFile) {
+		cerr << "Could not open " << filename << endl;
+		return 0;
+	}
+	treeFile.seekg(0, ios::end);
+	string content(treeFile.tellg(), '\0');
+	treeFile.seekg(0, ios::beg);
+	treeFile.read(&content[0], content.size());
+	treeFile.close();
+
+	CCOTextReader reader(content);
+	if (!isHeMoLabFormat) {
+		if (!reader.skipTo("*Tree")) {
+			cerr << filename << " is not a .cco file" << endl;
+			return 0;
+		}
+		xPerf.p[0] = reader.readDouble();
+		xPerf.p[1] = reader.readDouble();
+		xPerf.p[2] = reader.readDouble();
+		qProx = reader.readDouble();
+		psiFactor = reader.readDouble();
+		dp = reader.readDouble();
+		nTerms = reader.readLong();
+		refPressure = reader.readDouble();
+		pointCounter = reader.readLong();
+		rootRadius = reader.readDouble();
+		variationTolerance = reader.readDouble();
+	}
+
+	if (!reader.skipTo("*Vessels")) {
+		cerr << filename << " is not a .cco file" << endl;
+		return 0;
+	}
+	long long int numVessels = reader.readLong();
+	double accReservedFlowFraction = 0.0;
+	for (long long int i = 0; i < numVessels; ++i) {
+		SingleVessel *v = new SingleVessel();
+		v->qReservedFraction = 0.0;
+		v->vtkSegmentId = reader.readLong();
+		v->xProx.p[0] = reader.readDouble();
+		v->xProx.p[1] = reader.readDouble();
+		v->xProx.p[2] = reader.readDouble();
+		v->xDist.p[0] = reader.readDouble();
+		v->xDist.p[1] = reader.readDouble();
+		v->xDist.p[2] = reader.readDouble();
+		reader.skipToken();						//	Tappering
+		reader.skipToken();						//	Proximal_Distal_Radius_switched
+		reader.skipToken();						//	Regions
+		double currentReservedFlow = reader.readDouble();	//	Reserved fraction
+		if (currentReservedFlow > 0.0) {
+			v->terminalType = AbstractVascularElement::TERMINAL_TYPE::RESERVED;
+			v->qReservedFraction = currentReservedFlow;
+			accReservedFlowFraction += currentReservedFlow;
+		}
+		//	Branching - 0:NO_BRANCHING, 1:RIGID_PARENT, 2:DEFORMABLE_PARENT, 3:DISTAL_BRANCHING, 4:ONLY_AT_PARENT_HOTSPOTS
+		v->branchingMode = static_cast<AbstractVascularElement::BRANCHING_MODE>(reader.readLong());
+		v->radius = reader.readDouble();
+		reader.skipToken();						//	Resistance 1
+		reader.skipToken();						//	Resistance 2
+		reader.skipToken();						//	Capacitance
+		reader.skipToken();						//	Pressure
+		//	Perforators - 0:DISTRIBUTION, 1:PERFORATOR, 2:TRANSPORT
+		v->vesselFunction = static_cast<AbstractVascularElement::VESSEL_FUNCTION>(reader.readLong());
+		reader.skipToken();						//	Heart
+		reader.skipToken();						//	Valves_SResistors_codes
+		v->stage = isHeMoLabFormat ? -1 : reader.readLong();
+		this->elements[v->vtkSegmentId] = v;
+
+		if (loadingProgress && (i + 1) % PROGRESS_INTERVAL == 0) {
+			loadingProgress(i + 1, numVessels);
+		}
+	}
+	this->qReservedFactor = accReservedFlowFraction;
+
+	//	Load connectivity among segments
+	if (!reader.skipTo("*Connectivity")) {
+		cerr << filename << " has no connectivity data" << endl;
+		return 0;
+	}
+	reader.skipLine();
+	long long int rootId = 0;
+	for (long long int i = 0; i < numVessels; ++i) {
+		long long int vtkId, parentId, childId;
+		reader.readLongInLine(&vtkId);
+		reader.readLongInLine(&parentId);
+		if (parentId == -1) {
+			elements[vtkId]->parent = NULL;
+			rootId = vtkId;
+		} else {
+			elements[vtkId]->parent = elements[parentId];
+		}
+		while (reader.readLongInLine(&childId)) {
+			elements[vtkId]->addChild(elements[childId]);
+		}
+		reader.skipLine();
+	}
+
+	this->root = elements[rootId];
+	if (isHeMoLabFormat) {
+		this->xPerf = ((SingleVessel *) root)->xProx;
+		this->rootRadius = ((SingleVessel *) root)->radius;
+		this->psiFactor = 0;
+		this->dp = 0.0;
+		this->pointCounter = 0l;
+	}
+	this->nTerms = this->getNTerminals();
+	this->nCommonTerminals = getNTerminals(AbstractVascularElement::TERMINAL_TYPE::COMMON);
+	cout << "Tree loaded from " << filename << ": " << numVessels << " vessels - Terminals " << nTerms << " - Common terminals "
+			<< nCommonTerminals << " - qReserved fraction " << qReservedFactor << endl;
+	if (loadingProgress) {
+		loadingProgress(numVessels, numVessels);
+	}
+
+	return 1;
+}
+
+string SingleVesselCCOOTree::getTreeName() {
+	return "SingleVesselCCOOTree";
+}
+
+void SingleVesselCCOOTree::initializeLoadedVessels() {
+	vector<SingleVessel *> vessels;
+	getVesselsInPreOrder(vessels);
+
+	for (size_t i = 0; i < vessels.size(); ++i) {
+		SingleVessel *currentVessel = vessels[i];
+		point dNew = currentVessel->xProx - currentVessel->xDist;
+		SingleVessel *currentParent = (SingleVessel *) currentVessel->parent;
+		if (currentParent) {
+			currentVessel->nLevel = currentParent->nLevel + 1;
+			currentVessel->beta = currentVessel->radius / currentParent->radius;
+			currentVessel->length = sqrt(dNew ^ dNew);
+			currentVessel->viscosity = nuTable.getValue(currentVessel->nLevel);
+			currentVessel->resistance = 8 * nuTable.getValue(currentVessel->nLevel) / M_PI * currentVessel->length;
+			currentVessel->pressure = 0.0;
+		} else {
+			currentVessel->nLevel = 0;
+			currentVessel->beta = rootRadius;
+			currentVessel->radius = rootRadius;
+			currentVessel->length = sqrt(dNew ^ dNew);
+			currentVessel->viscosity = nuTable.getValue(currentVessel->nLevel);
+			currentVessel->resistance = (8 * currentVessel->viscosity / M_PI) * currentVessel->length;
+			currentVessel->flow = qProx;
+			currentVessel->treeVolume = M_PI * currentVessel->length * rootRadius * rootRadius;
+			currentVessel->pressure = 0.0;
+
+			//	Tree quantities
+			psiFactor = pow(currentVessel->beta, 4) / currentVessel->flow;
+			dp = currentVessel->resistance / psiFactor;
+		}
+		//	Same ids as the cells of a VTK structure built in pre-order
+		currentVessel->vtkSegmentId = i;
+	}
+
+	isVtkTreeOutdated = 1;
+	isSegmentIndexOutdated = 1;
+}
+
+void SingleVesselCCOOTree::buildSegmentIndex() {
+	vector<SingleVessel *> vessels;
+	getVesselsInPreOrder(vessels);
+
+	segmentIndex.clear();
+	for (vector<SingleVessel *>::iterator it = vessels.begin(); it != vessels.end(); ++it) {
+		segmentIndex.insert((*it)->vtkSegmentId, (*it)->xProx, (*it)->xDist);
+	}
+	isSegmentIndexOutdated = 0;
+}
+
+void SingleVesselCCOOTree::buildDeferredStructures() {
+	if (isSegmentIndexOutdated) {
+		buildSegmentIndex();
+	}
+	if (!isLazyVtk && isVtkTreeOutdated) {
+		buildVtkTree();
+	}
 }
 
 //	NEVER TESTED
@@ -1953,6 +3215,7 @@ void SingleVesselCCOOTree::removeWitheredBranches(int stage) {
 
 void SingleVesselCCOOTree::remove(SingleVessel* vessel) {
 
+	buildDeferredStructures();
 	vector<AbstractVascularElement *> children = vessel->getChildren();
 	printf("children.size() = %lu\n", children.size());
 	for (vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
@@ -1977,8 +3240,13 @@ void SingleVesselCCOOTree::remove(SingleVessel* vessel) {
 
 	printf("vtkCellType = %d\n", vessel->vtkSegment->GetCellType());
 	printf("GetNumberOfPoints = %lld\n", vessel->vtkSegment->GetNumberOfPoints());
-	vtkTree->DeletePoint(vessel->vtkSegment->GetPointId(1));
-	vtkTree->DeleteCell(vessel->vtkSegmentId);	
+	if (isLazyVtk) {
+		isVtkTreeOutdated = 1;
+	} else {
+		vtkTree->DeletePoint(vessel->vtkSegment->GetPointId(1));
+		vtkTree->DeleteCell(vessel->vtkSegmentId);
+	}
+	segmentIndex.remove(vessel->vtkSegmentId);
 	
 	delete vessel;
 }
@@ -2025,3 +3293,118 @@ double SingleVesselCCOOTree::getVariationTolerance()
 string SingleVesselCCOOTree::getFilenameCCO() {
 	return this->filenameCCO;
 }
+
+int SingleVesselCCOOTree::getIsIncrementalUpdate() const
+{
+	return isIncrementalUpdate;
+}
+
+void SingleVesselCCOOTree::setIsIncrementalUpdate(int isIncrementalUpdate)
+{
+	if (!isIncrementalUpdate) {
+		updateDeferredValues();
+	}
+	this->isIncrementalUpdate = isIncrementalUpdate;
+}
+
+int SingleVesselCCOOTree::getIsCopyFreeEvaluation() const
+{
+	return isCopyFreeEvaluation;
+}
+
+void SingleVesselCCOOTree::setIsCopyFreeEvaluation(int isCopyFreeEvaluation)
+{
+	this->isCopyFreeEvaluation = isCopyFreeEvaluation;
+	if (isCopyFreeEvaluation && evaluationScratch.empty()) {
+		evaluationScratch.assign(omp_get_max_threads(), NULL);
+	}
+}
+
+int SingleVesselCCOOTree::getIsScratchEvaluation() const
+{
+	return isScratchEvaluation;
+}
+
+void SingleVesselCCOOTree::setIsScratchEvaluation(int isScratchEvaluation)
+{
+	releaseEvaluationScratch();
+	this->isScratchEvaluation = isScratchEvaluation;
+	if (isScratchEvaluation || isCopyFreeEvaluation) {
+		evaluationScratch.assign(omp_get_max_threads(), NULL);
+	}
+}
+
+AbstractFixedPointAccelerator *SingleVesselCCOOTree::getViscosityAccelerator() const
+{
+	return viscosityAccelerator;
+}
+
+void SingleVesselCCOOTree::setViscosityAccelerator(AbstractFixedPointAccelerator *viscosityAccelerator)
+{
+	this->viscosityAccelerator = viscosityAccelerator;
+}
+
+int SingleVesselCCOOTree::getMaxViscosityIterations() const
+{
+	return maxViscosityIterations;
+}
+
+void SingleVesselCCOOTree::setMaxViscosityIterations(int maxViscosityIterations)
+{
+	this->maxViscosityIterations = maxViscosityIterations;
+}
+
+long long int SingleVesselCCOOTree::getViscositySolves() const
+{
+	return viscositySolves;
+}
+
+long long int SingleVesselCCOOTree::getViscosityIterations() const
+{
+	return viscosityIterations;
+}
+
+long long int SingleVesselCCOOTree::getParallelSweepCutoff() const
+{
+	return parallelSweepCutoff;
+}
+
+void SingleVesselCCOOTree::setParallelSweepCutoff(long long int parallelSweepCutoff)
+{
+	this->parallelSweepCutoff = parallelSweepCutoff;
+}
+
+int SingleVesselCCOOTree::getReconciliationInterval() const
+{
+	return reconciliationInterval;
+}
+
+void SingleVesselCCOOTree::setReconciliationInterval(int reconciliationInterval)
+{
+	this->reconciliationInterval = reconciliationInterval;
+}
+
+double SingleVesselCCOOTree::getReconciliationTolerance() const
+{
+	return reconciliationTolerance;
+}
+
+void SingleVesselCCOOTree::setReconciliationTolerance(double reconciliationTolerance)
+{
+	this->reconciliationTolerance = reconciliationTolerance;
+}
+
+double SingleVesselCCOOTree::getAccumulatedDrift() const
+{
+	return accumulatedDrift;
+}
+
+int SingleVesselCCOOTree::getIsDriftLogged() const
+{
+	return isDriftLogged;
+}
+
+void SingleVesselCCOOTree::setIsDriftLogged(int isDriftLogged)
+{
+	this->isDriftLogged = isDriftLogged;
+}
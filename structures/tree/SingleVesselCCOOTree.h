@@ -19,9 +19,15 @@
 #include "../../constrains/AbstractConstraintFunction.h"
 #include "../vascularElements/SingleVessel.h"
 #include "AbstractObjectCCOTree.h"
+#include "acceleration/AbstractFixedPointAccelerator.h"
 
 using namespace std;
 
+/**
+ * Function called while a tree file is loaded with the amount of vessels read and the amount of vessels in the file.
+ */
+typedef void (*loadingProgressFunc)(long long int loadedVessels, long long int totalVessels);
+
 /**
  * N-furcation tree with only SingleVessel elements as vascular elements.
  */
@@ -33,11 +39,44 @@ class SingleVesselCCOOTree: public AbstractObjectCCOTree {
 	double variationTolerance;
 	/**	Amount of non-common terminals. */
 	long long int nCommonTerminals;
+	/** If the hemodynamic update of addVessel is restricted to the path between the new bifurcation and the root. */
+	int isIncrementalUpdate;
+	/** If the candidate evaluations use the values cached at each vessel instead of copying the tree. */
+	int isCopyFreeEvaluation;
+	/** If the copying candidate evaluations reuse a scratch tree and cost estimator per thread. */
+	int isScratchEvaluation;
+	/** If addVessel skips the hemodynamic update because the caller updates the tree afterwards (see addVessels). */
+	int isUpdateDeferred;
+	/** Accelerator of the viscosity-beta iterations (NULL for the plain iteration). Not owned by the tree. */
+	AbstractFixedPointAccelerator *viscosityAccelerator;
+	/** Maximum amount of sweeps of each viscosity-beta solve (0 for no limit). */
+	int maxViscosityIterations;
+	/** Amount of viscosity-beta solves performed. */
+	long long int viscositySolves;
+	/** Amount of viscosity-beta sweeps performed by all solves. */
+	long long int viscosityIterations;
+	/** Minimum amount of terminals of a tree to split updateTree and updateTreeViscositiesBeta among threads (0 to disable). */
+	long long int parallelSweepCutoff;
+	/** Incremental insertions between full updates (0 for no periodic full update). */
+	int reconciliationInterval;
+	/** Estimated error of the incremental updates that triggers a full update (0 to use variationTolerance). */
+	double reconciliationTolerance;
+	/** Incremental insertions since the last full update. */
+	int insertionsSinceReconciliation;
+	/** Estimated error accumulated by the incremental insertions since the last full update. */
+	double reconciliationError;
+	/** Sum of the maximum beta drifts corrected by all full updates. */
+	double accumulatedDrift;
+	/** If each full update of the incremental mode logs its drift. */
+	int isDriftLogged;
 	//	FIXME These classes should not have this kind of permissions, must rework the architecture to a POO strategy.
 	friend class PruningCCOOTree;
 	friend class BreadthFirstPruning;
 	friend class TreeMerger;
 public:
+	/**	Function notified of the loading progress of the file constructors (NULL to load silently). */
+	static loadingProgressFunc loadingProgress;
+
 	/**
 	 * Common tree creator.
 	 * @param xi	Root point.
@@ -60,7 +99,8 @@ public:
 //	SingleVesselCCOOTree(string filenameCCO, string filenameVTK, GeneratorData *instanceData);
 
 	/**
-	 * Creates a new tree from the .cco file @p filename in VItA format.
+	 * Creates a new tree from the .cco file @p filename in VItA format. Files with .ccb or .ccbz extension are read
+	 * in the binary format of BinaryTreeFormat.
 	 * @param filenameCCO Path to the .cco file.
 	 * @param gam	Murray law function.
 	 * @param epsLim	Sibling vessels ratio function.
@@ -69,7 +109,9 @@ public:
 	SingleVesselCCOOTree(string filenameCCO, GeneratorData *instanceData, AbstractConstraintFunction<double, int> *gam, AbstractConstraintFunction<double, int> *epsLim,
 			AbstractConstraintFunction<double, int> *nu);
 	/**
-	 * Creates a new tree from the .cco file @p filename in HeMoLab format.
+	 * Creates a new tree from the .cco file @p filename in HeMoLab format. Files with .ccb or .ccbz extension are
+	 * read in the binary format of BinaryTreeFormat and their flow, reference pressure and tolerance are replaced by
+	 * the given ones.
 	 * @param filenameCCO Path to the .cco file.
 	 * @param qi	Flow at the root.
 	 * @param gam	Murray law function.
@@ -95,6 +137,25 @@ public:
 	 * @return	Copy from the tree
 	 */
 	SingleVesselCCOOTree *clone();
+	/**
+	 * Returns a clone of the tree that also keeps the point counter and the vessel attributes written by save.
+	 * @return	Copy of the tree.
+	 */
+	AbstractObjectCCOTree *snapshot();
+	/**
+	 * Updates the whole tree if there are incremental insertions since the last full update, so the off-path
+	 * subtrees have the same values than with a full update. save, snapshot and the writers do not call it, so
+	 * saving never modifies the tree; StagedFRROTreeGenerator calls it at each save point.
+	 */
+	void updateDeferredValues();
+	/**
+	 * Saves the tree in @p filename. Files with .ccb extension are saved in the binary format of BinaryTreeFormat and
+	 * files with .ccbz extension in its block compressed variant; any other extension is saved as a .cco text file
+	 * (see saveText).
+	 * @param filename	File to save the tree data.
+	 * @return	1 if the file was completely written, 0 otherwise.
+	 */
+	int save(string filename);
 	/**
 	 * Returns the closest point in the CCOTree with respect to @p xNew point.
 	 * @param xNew	Point from which the minimum distance is computed.
@@ -112,6 +173,13 @@ public:
 	 * @return	Array of segments in the neighborhood of @p xNew.
 	 */
 	vector<AbstractVascularElement *> getCloseSegments(point xNew, AbstractDomain *domain, int *nFound);
+	/**
+	 * Returns the box searched by getCloseSegments, sized for the current amount of COMMON terminals.
+	 * @param xNew	Center point of the neighborhood of interest.
+	 * @param domain	Domain of the segments.
+	 * @return	Box as {xMin, xMax, yMin, yMax, zMin, zMax}, to be deleted by the caller.
+	 */
+	double *getCloseNeighborhood(point xNew, AbstractDomain *domain);
 
 	/**
 	 * Adds a new vessel to the CCO tree. @param xProx and @param xDist are the proximal and distal nodes of the new
@@ -122,6 +190,16 @@ public:
 	 * @param vesselFunction Vessel function of the added vessel.
 	 */
 	void addVessel(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction);
+	/**
+	 * Adds the vessels @p xProxs[i] - @p xDists[i] attached to @p parents[i] in order and updates the tree
+	 * hemodynamics once for all of them. With the incremental update, the path of each new bifurcation is updated
+	 * once all vessels are added.
+	 * @param xProxs	Proximal points of the new vessels.
+	 * @param xDists	Distal points of the new vessels.
+	 * @param parents	Parents of the new vessels.
+	 * @param vesselFunction	Function of the new vessels.
+	 */
+	void addVessels(vector<point> &xProxs, vector<point> &xDists, vector<AbstractVascularElement *> &parents, AbstractVascularElement::VESSEL_FUNCTION vesselFunction);
 
 	//	FIXME This function probably should be part of other class
 	void addVesselMergeFast(point xProx, point xDist, AbstractVascularElement *parent, AbstractVascularElement::VESSEL_FUNCTION vesselFunction, unordered_map<string, SingleVessel *>* stringToPointer);
@@ -170,6 +248,28 @@ public:
 	 * @return	If the connection of the tree with xNew is possible. If not @p cost is INFINITY.
 	 */
 	int testVessel(point xNew, AbstractVascularElement *parent, AbstractDomain *domain, vector<AbstractVascularElement *> neighbors, double dlim, point *xBif, double *cost);
+	/**
+	 * Tests the connection of @p xNew with @p parent at the bifurcation point @p xBif. It checks the angle, domain and
+	 * intersection restrictions and evaluates the cost of the candidate bifurcation.
+	 * @param xNew	Distal point for the new vessel to test.
+	 * @param parent	Parent vessel to test the @p xNew point connection.
+	 * @param xBif	Proximal point for the new vessel.
+	 * @param domain	Tree domain.
+	 * @param neighbors	Close neighbors used for intersection test.
+	 * @param dlim	Not used in the current implementation.
+	 * @return	Functional cost variation, INFINITY if the connection is not possible.
+	 */
+	double testBifurcation(point xNew, AbstractVascularElement *parent, point xBif, AbstractDomain *domain, vector<AbstractVascularElement *> &neighbors, double dlim);
+	/**
+	 * Returns a lower bound of the cost of connecting @p xNew to @p parent. The evaluation keeps the radius of the
+	 * root of the evaluated subtree (GeneratorData::nLevelTest levels above @p parent), and also its length unless
+	 * that root is @p parent itself split by the bifurcation. Therefore, the volume variation is bounded by the
+	 * volume of that vessel minus the current volume of the subtree. The cost estimator adds its own terms.
+	 * @param xNew	Distal point for the new vessel to test.
+	 * @param parent	Parent vessel to test the @p xNew point connection.
+	 * @return	Lower bound of the cost.
+	 */
+	double getCostLowerBound(point xNew, AbstractVascularElement *parent);
 
 	/**
 	 * Prints the current tree node by node.
@@ -210,6 +310,144 @@ public:
 
 	string getFilenameCCO();
 
+	/**
+	 * Getter of @p isIncrementalUpdate.
+	 * @return @p isIncrementalUpdate
+	 */
+	int getIsIncrementalUpdate() const;
+	/**
+	 * Setter of @p isIncrementalUpdate. When enabled, addVessel only recomputes flow, beta, resistance, viscosity
+	 * and volume along the path from the new bifurcation to the root (and the first vessel of each subtree
+	 * hanging from it) instead of sweeping the whole tree. Off-path subtrees keep their last computed values
+	 * until the next full sweep.
+	 * @param isIncrementalUpdate If the incremental update is used.
+	 */
+	void setIsIncrementalUpdate(int isIncrementalUpdate);
+	/**
+	 * Getter of @p reconciliationInterval.
+	 * @return @p reconciliationInterval
+	 */
+	int getReconciliationInterval() const;
+	/**
+	 * Setter of @p reconciliationInterval. With the incremental update, the whole tree is updated every
+	 * @p reconciliationInterval insertions to correct the drift of the off-path subtrees.
+	 * @param reconciliationInterval Insertions between full updates (0 for no periodic full update).
+	 */
+	void setReconciliationInterval(int reconciliationInterval);
+	/**
+	 * Getter of @p reconciliationTolerance.
+	 * @return @p reconciliationTolerance
+	 */
+	double getReconciliationTolerance() const;
+	/**
+	 * Setter of @p reconciliationTolerance. With the incremental update, the error of each insertion is estimated as
+	 * the beta variation of the first sweep along its path, since the off-path subtrees do not react to it. The
+	 * whole tree is updated when the sum of these estimates exceeds @p reconciliationTolerance or, if it is 0 (the
+	 * default), the tolerance of the viscosity iteration, so the results stay within that tolerance of the full
+	 * update. Larger bounds trade accuracy for throughput.
+	 * @param reconciliationTolerance Estimated error bound (0 to use the tolerance of the viscosity iteration).
+	 */
+	void setReconciliationTolerance(double reconciliationTolerance);
+	/**
+	 * Returns the sum of the maximum beta variations corrected by the full updates triggered by
+	 * @p reconciliationInterval or @p reconciliationTolerance.
+	 * @return	Accumulated drift.
+	 */
+	double getAccumulatedDrift() const;
+	/**
+	 * Getter of @p isDriftLogged.
+	 * @return @p isDriftLogged
+	 */
+	int getIsDriftLogged() const;
+	/**
+	 * Setter of @p isDriftLogged. When enabled, each full update of the incremental mode writes its amount of
+	 * insertions, estimated error, beta and volume drifts and the accumulated drift to the standard output.
+	 * Disabled by default.
+	 * @param isDriftLogged If the drift is logged.
+	 */
+	void setIsDriftLogged(int isDriftLogged);
+
+	/**
+	 * Getter of @p isCopyFreeEvaluation.
+	 * @return @p isCopyFreeEvaluation
+	 */
+	int getIsCopyFreeEvaluation() const;
+	/**
+	 * Setter of @p isCopyFreeEvaluation. When enabled, testVessel evaluates each candidate bifurcation without
+	 * copying the tree: only the vessels between the bifurcation and its ancestor GeneratorData::nLevelTest levels
+	 * up are recomputed, while the remaining subtrees are represented by their cached flow, resistance and volume.
+	 * It is an approximation: the remaining subtrees are rescaled with the new radius of their first vessel keeping
+	 * the viscosities of their deeper vessels, which depend on the radius, so a few selections may differ from the
+	 * copying evaluation. Disabled by default.
+	 * @param isCopyFreeEvaluation If the copy-free evaluation is used.
+	 */
+	void setIsCopyFreeEvaluation(int isCopyFreeEvaluation);
+
+	/**
+	 * Getter of @p isScratchEvaluation.
+	 * @return @p isScratchEvaluation
+	 */
+	int getIsScratchEvaluation() const;
+	/**
+	 * Setter of @p isScratchEvaluation. When enabled, each OpenMP thread keeps a scratch tree, the vessels used to copy
+	 * the evaluated subtree and a clone of the cost estimator. They are created at the first evaluation of the thread
+	 * and reset between candidates, so the copying evaluations do not create VTK objects nor clone the estimator.
+	 * Results are the same as the evaluations that copy the tree.
+	 * @param isScratchEvaluation If the scratch evaluation is used.
+	 */
+	void setIsScratchEvaluation(int isScratchEvaluation);
+	/**
+	 * Getter of @p viscosityAccelerator.
+	 * @return @p viscosityAccelerator
+	 */
+	AbstractFixedPointAccelerator *getViscosityAccelerator() const;
+	/**
+	 * Setter of @p viscosityAccelerator. The iterations that update the viscosities and betas until the variation of
+	 * the betas is below the tolerance use @p viscosityAccelerator to compute the betas of each sweep from the previous
+	 * ones (e.g. AndersonAccelerator or AitkenAccelerator). Results match the plain iteration within the tolerance.
+	 * @param viscosityAccelerator Accelerator (NULL for the plain iteration).
+	 */
+	void setViscosityAccelerator(AbstractFixedPointAccelerator *viscosityAccelerator);
+	/**
+	 * Getter of @p maxViscosityIterations.
+	 * @return @p maxViscosityIterations
+	 */
+	int getMaxViscosityIterations() const;
+	/**
+	 * Setter of @p maxViscosityIterations.
+	 * @param maxViscosityIterations Maximum amount of sweeps of each viscosity-beta solve (0 for no limit).
+	 */
+	void setMaxViscosityIterations(int maxViscosityIterations);
+	/**
+	 * Returns the amount of viscosity-beta solves performed by the tree.
+	 * @return	Solves performed.
+	 */
+	long long int getViscositySolves() const;
+	/**
+	 * Returns the amount of sweeps performed by all viscosity-beta solves of the tree.
+	 * @return	Sweeps performed.
+	 */
+	long long int getViscosityIterations() const;
+	/**
+	 * Updates the viscosities and betas of the tree with root @p root until the variation of the betas is below the
+	 * tolerance, using @p viscosityAccelerator if set.
+	 * @param root	Root of the tree.
+	 * @return	Sweeps performed.
+	 */
+	int solveViscositiesBeta(SingleVessel *root);
+	/**
+	 * Getter of @p parallelSweepCutoff.
+	 * @return @p parallelSweepCutoff
+	 */
+	long long int getParallelSweepCutoff() const;
+	/**
+	 * Setter of @p parallelSweepCutoff. Trees with at least @p parallelSweepCutoff terminals are updated by
+	 * updateTree and updateTreeViscositiesBeta in parallel, sweeping disjoint subtrees in different threads. Results
+	 * are the same as the ones of the serial sweeps.
+	 * @param parallelSweepCutoff Minimum amount of terminals (0 to disable).
+	 */
+	void setParallelSweepCutoff(long long int parallelSweepCutoff);
+
 protected:
 	/**
 	 * Returns a string with the tree atributes to create the .cco file.
@@ -218,6 +456,101 @@ protected:
 	void saveTree(ofstream *outFile);
 
 private:
+	/**
+	 * Returns the vessels of the tree in pre-order, the order of the saved files.
+	 * @param vessels	Vessels of the tree.
+	 */
+	void getVesselsInPreOrder(vector<SingleVessel *> &vessels);
+	/**
+	 * Adds the viscosity-beta solve of @p iterations sweeps to the solver statistics.
+	 * @param iterations	Sweeps of the solve.
+	 */
+	void countViscositySolve(int iterations);
+	/**
+	 * Saves the tree as a .cco text file. The output is the same as AbstractObjectCCOTree::save, but the vessel
+	 * lines are formatted in parallel into per-block buffers that are then written in order.
+	 * @param filename	File to save the tree data.
+	 * @return	1 if the file was completely written, 0 otherwise.
+	 */
+	int saveText(string filename);
+	/**
+	 * Saves the tree in the binary format of BinaryTreeFormat.
+	 * @param filename	File to save the tree data.
+	 * @return	1 if the file was completely written, 0 otherwise.
+	 */
+	int saveBinary(string filename);
+	/**
+	 * Reads the tree parameters and vessels of the binary file @p filename in a single pass over its memory mapping.
+	 * The VTK structure is not created.
+	 * @param filename	File with the tree data.
+	 * @return	1 if the file was read.
+	 */
+	int loadBinary(string filename);
+	/**
+	 * Reads the tree parameters and vessels of the .cco text file @p filename. The whole file is read at once and
+	 * parsed with a tokenizer over its content, and only a summary line is printed. The VTK structure is not created.
+	 * @param filename	File with the tree data.
+	 * @param isHeMoLabFormat	If the file is in HeMoLab format, without tree data nor vessel stages. The root
+	 * point and radius are taken from the root vessel and the stages set to -1.
+	 * @return	1 if the file was read.
+	 */
+	int loadText(string filename, int isHeMoLabFormat);
+	/**
+	 * Vessel of a candidate bifurcation in the evaluations without tree copies. It is either a vessel recomputed
+	 * by the evaluation, a new terminal, or an unmodified subtree represented by the values cached at its root.
+	 */
+	struct TrialVessel {
+		/** Tree vessel represented (NULL for new vessels). */
+		SingleVessel *vessel;
+		/** If it represents the unmodified subtree of @p vessel. */
+		int isSubtree;
+		/** Index of the parent (-1 for the root of the evaluation). */
+		int parent;
+		/** Index of the first child (-1 if it has no children). */
+		int firstChild;
+		/** Index of the last child (-1 if it has no children). */
+		int lastChild;
+		/** Index of the next sibling (-1 if it is the last child). */
+		int nextSibling;
+		/** Bifurcation level. */
+		int nLevel;
+		/** Vessel length. */
+		double length;
+		/** Radius relative to the parent vessel. */
+		double beta;
+		/** Vessel radius. */
+		double radius;
+		/** Local fluid-dynamic resistance. */
+		double localResistance;
+		/** Reduced fluid-dynamic resistance. */
+		double resistance;
+		/** Flow in this vessel. */
+		double flow;
+		/** Volume of this down tree branch. */
+		double treeVolume;
+		/** Amount of COMMON terminals in this down tree branch. */
+		long long int commonTerminals;
+		/** Flow of the RESERVED terminals in this down tree branch. */
+		double reservedFlow;
+	};
+	/**
+	 * Objects reused by the copying evaluations of one thread.
+	 */
+	struct EvaluationScratch {
+		/** Tree that holds the copied subtree. Its vessels belong to @p vessels and not to its elements. */
+		SingleVesselCCOOTree *tree;
+		/** Clone of @p estimatorSource. */
+		AbstractCostEstimator *estimator;
+		/** Cost estimator from which @p estimator was cloned. */
+		AbstractCostEstimator *estimatorSource;
+		/** Vessels used to copy the subtree and to create iNew and iCon. */
+		vector<SingleVessel *> vessels;
+		/** Amount of @p vessels used by the current candidate. */
+		unsigned int nUsed;
+	};
+	/** Scratch objects of each OpenMP thread (NULL until its first evaluation). */
+	vector<EvaluationScratch *> evaluationScratch;
+
 	/**
 	 * Clones the subtree with parent vessel @p levels .
 	 * @param root	Root of the tree to clone.
@@ -232,6 +565,46 @@ private:
 	 * @return Cloned subtree.
 	 */
 	SingleVessel *cloneTree(SingleVessel *root, unordered_map<long long, AbstractVascularElement *> *segments);
+	/**
+	 * Same as cloneUpTo but the subtree is copied into the scratch tree of @p scratch.
+	 * @param levels	Levels above @p parent copied.
+	 * @param parent	Parent vessel of the candidate.
+	 * @param scratch	Scratch objects of the current thread.
+	 * @param clonedParent	Copy of @p parent.
+	 * @return Scratch tree with the copied subtree.
+	 */
+	SingleVesselCCOOTree *cloneUpTo(int levels, SingleVessel *parent, EvaluationScratch *scratch, SingleVessel **clonedParent);
+	/**
+	 * Same as cloneTree but the copies are taken from the vessels of @p scratch.
+	 * @param root	Root of the subtree to clone.
+	 * @param scratch	Scratch objects of the current thread.
+	 * @param parent	Parent vessel of the candidate.
+	 * @param clonedParent	Copy of @p parent, set when it is part of the subtree.
+	 * @return Cloned subtree.
+	 */
+	SingleVessel *cloneTree(SingleVessel *root, EvaluationScratch *scratch, SingleVessel *parent, SingleVessel **clonedParent);
+	/**
+	 * Returns the scratch objects of the current thread, creating them at its first call. The cost estimator is cloned
+	 * again if GeneratorData::costEstimator changed.
+	 * @return Scratch objects or NULL if the scratch evaluation is disabled.
+	 */
+	EvaluationScratch *getEvaluationScratch();
+	/**
+	 * Same as getEvaluationScratch regardless of @p isScratchEvaluation. The copy-free evaluation uses it to reuse the
+	 * cost estimator of the thread.
+	 * @return Scratch objects or NULL if the scratch objects are not allocated.
+	 */
+	EvaluationScratch *getThreadScratch();
+	/**
+	 * Returns an unused vessel of @p scratch with the attributes of a new vessel.
+	 * @param scratch	Scratch objects of the current thread.
+	 * @return Vessel.
+	 */
+	SingleVessel *getScratchVessel(EvaluationScratch *scratch);
+	/**
+	 * Deletes the scratch objects of all threads.
+	 */
+	void releaseEvaluationScratch();
 	/**
 	 * Returns a partial variation of the cost functional due to the new segment inclusion.
 	 * @param xNew	Proximal point of the new vessel.
@@ -247,6 +620,44 @@ private:
 	 * @param dLim Minimum distance from the new vessel to the tree.
 	 */
 	double evaluate(point xNew, SingleVessel *parent, double dLim);
+	/**
+	 * Returns a partial variation of the cost functional due to the new segment inclusion without copying the tree.
+	 * The betas are only recomputed from @p parent to its ancestor GeneratorData::nLevelTest levels up, while the other
+	 * subtrees are represented by their cached terminals, resistance and volume (rescaled with their new radius).
+	 * @param xNew	Distal point of the new vessel.
+	 * @param xTest Proximal point of the new vessel (distal point of @p parent for DISTAL_BRANCHING vessels).
+	 * @param parent Parent to the new vessel.
+	 * @param dLim Minimum distance from the new vessel to the tree.
+	 */
+	double evaluateWithoutCopy(point xNew, point xTest, SingleVessel *parent, double dLim);
+	/**
+	 * Appends a vessel to the candidate bifurcation @p trial as the last child of @p parent.
+	 * @param trial	Vessels of the candidate bifurcation.
+	 * @param vessel	Tree vessel represented (NULL for new vessels).
+	 * @param parent	Index of the parent in @p trial (-1 for the root of the evaluation).
+	 * @param isSubtree	If the unmodified subtree of @p vessel is represented by its cached values.
+	 * @return Index of the added vessel.
+	 */
+	int addTrialVessel(vector<TrialVessel> &trial, SingleVessel *vessel, int parent, int isSubtree);
+	/**
+	 * Updates flows, betas and resistances of the candidate bifurcation @p trial as updateTree does for the tree.
+	 * @param trial	Vessels of the candidate bifurcation.
+	 * @param commonTerminals	Amount of COMMON terminals of the tree with the candidate bifurcation.
+	 */
+	void updateTrialTree(vector<TrialVessel> &trial, long long int commonTerminals);
+	/**
+	 * Updates the candidate bifurcation @p trial as updateTreeViscositiesBeta does for the tree.
+	 * @param trial	Vessels of the candidate bifurcation.
+	 * @param maxBetaVariation	The maximum variation of the beta value due to the update.
+	 */
+	void updateTrialViscositiesBeta(vector<TrialVessel> &trial, double *maxBetaVariation);
+	/**
+	 * Returns the radius of @p vessel. Under incremental updates, the radius stored outside the last updated paths
+	 * may be outdated, so it is recomputed from the betas of its ancestors.
+	 * @param vessel Vessel of the tree.
+	 * @return Radius of @p vessel.
+	 */
+	double getUpdatedRadius(SingleVessel *vessel);
 	/**
 	 * Updates the tree values for the current topology in only one tree "in order" swept (O(N)).
 	 * As the recursion deepens, the level number is computed for each element. As the
@@ -256,6 +667,53 @@ private:
 	 * @param tree Tree to update.
 	 */
 	void updateTree(SingleVessel *root, SingleVesselCCOOTree *tree);
+	/**
+	 * Computes the flow, resistance and children betas of @p root from the values of its children. Step of updateTree
+	 * for each vessel in post-order.
+	 * @param root Vessel to update.
+	 * @param tree Tree to update.
+	 */
+	void updateTreeNode(SingleVessel *root, SingleVesselCCOOTree *tree);
+	/**
+	 * Updates the tree values after a topological change at @p bifurcation visiting only the vessels from
+	 * @p bifurcation to the root (O(depth)). Flows are obtained from the terminal counts cached at each vessel,
+	 * the subtrees hanging from the path are rescaled with the new radius of their first vessel and the
+	 * viscosity-beta iterations are restricted to the path.
+	 * @param bifurcation Vessel whose children were modified.
+	 * @return	Maximum beta variation of the first sweep along the path.
+	 */
+	double updateTreeIncremental(SingleVessel *bifurcation);
+	/**
+	 * Accounts @p insertions incremental insertions with estimated error @p error and updates the whole tree if
+	 * @p reconciliationInterval or the error bound is reached. The beta drift corrected by the full update
+	 * is logged.
+	 * @param insertions	Amount of insertions.
+	 * @param error	Estimated error of the insertions.
+	 */
+	void reconcileIfNeeded(int insertions, double error);
+	/**
+	 * Updates the whole tree and logs the beta drift corrected since the last full update.
+	 */
+	void reconcile();
+	/**
+	 * Updates the nLevel of the subtree with root @p root, descending only where the level is outdated.
+	 * @param root Root of the subtree to update.
+	 */
+	void updateLevels(SingleVessel *root);
+	/**
+	 * Updates the terminal counts, flows, betas and resistance of @p vessel from the cached values of its children.
+	 * It is equivalent to one node of updateTree.
+	 * @param vessel Vessel to update.
+	 */
+	void updateBifurcation(SingleVessel *vessel);
+	/**
+	 * One viscosity-beta iteration restricted to the vessels in @p path (ordered from distal to proximal).
+	 * Children outside @p path are rescaled with their new radius without descending into their subtrees.
+	 * @param path Vessels to update, the first elements being the non-terminal children of the bifurcation.
+	 * @param nBifurcationChildren Amount of non-terminal children of the bifurcation at the begin of @p path.
+	 * @param maxBetaVariation	The maximum variation of the beta value due to the update.
+	 */
+	void updatePathViscositiesBeta(vector<SingleVessel *> &path, int nBifurcationChildren, double *maxBetaVariation);
 	/**
 	 * For a giving pair of beta between sibling of a parent vessel, it analyze the symmetry constrain given by
 	 * epsLim function.
@@ -300,6 +758,31 @@ private:
 	 * @param maxBetaVariation	The maximum variation of the beta value due to the update.
 	 */
 	void updateTreeViscositiesBeta(SingleVessel *root, double *maxBetaVariation);
+	/**
+	 * Computes the viscosity, resistance, volume and pressure of @p root and the betas of its children from the values
+	 * of its children. Step of updateTreeViscositiesBeta for each vessel in post-order.
+	 * @param root	Vessel to update.
+	 * @param maxBetaVariation	Maximum beta variation, updated with the variations of the children of @p root.
+	 */
+	void updateViscositiesBetaNode(SingleVessel *root, double *maxBetaVariation);
+	/**
+	 * Splits the tree with root @p root for a parallel sweep if it has at least @p parallelSweepCutoff terminals and
+	 * the caller is not already in a parallel region. The tree is split in @p subtrees, that can be swept
+	 * independently, and the vessels above them in @p upper.
+	 * @param root	Tree root.
+	 * @param upper	Vessels above @p subtrees in pre-order.
+	 * @param subtrees	Roots of the subtrees, from the largest to the smallest.
+	 * @return	1 if the sweep must be performed in parallel.
+	 */
+	int splitSweep(SingleVessel *root, vector<SingleVessel *> &upper, vector<SingleVessel *> &subtrees);
+	/**
+	 * Returns the beta of a child vessel given by the Murray's law, (1 + betaRatio^gamma)^(-1/gamma), with gamma the
+	 * value of @p gam at @p nLevel. Gamma values 3 and 2 use cbrt and sqrt kernels.
+	 * @param betaRatio	Ratio between the radii of the siblings and the child.
+	 * @param nLevel	Level of the child.
+	 * @return Beta of the child.
+	 */
+	double getMurrayBeta(double betaRatio, int nLevel);
 	/**
 	 * Returns the viscosity estimated with the Fahraeus-Lindquist model.
 	 * @param radius
@@ -308,9 +791,20 @@ private:
 	double getNuFL(double radius);
 
 	/**
-	 * Creates the VTK lines and points associated to a HeMoLab file loaded.
+	 * Initializes the level, geometry and viscosity of the vessels of a loaded tree and numbers their
+	 * @p vtkSegmentId in pre-order. The VTK structure and the segment index are flagged as outdated, so they are
+	 * only built if the tree is queried, modified or written afterwards.
+	 */
+	void initializeLoadedVessels();
+	/**
+	 * Rebuilds @p segmentIndex inserting the vessels in pre-order.
+	 */
+	void buildSegmentIndex();
+	/**
+	 * Builds the structures deferred by initializeLoadedVessels that are needed to modify the tree: the segment
+	 * index and, if @p isLazyVtk is not set, the VTK structure.
 	 */
-	void createSegmentVtkLines(AbstractVascularElement *rootVessel);
+	void buildDeferredStructures();
 
 	double getVariationTolerance();
 
@@ -8,6 +8,7 @@
  */
 
 #include "SproutingVolumetricCostEstimator.h"
+#include "TreeTraversal.h"
 #include "../vascularElements/SingleVessel.h"
 
 SproutingVolumetricCostEstimator::SproutingVolumetricCostEstimator(double volumeFactor, double proteolyticFactor, double diffusionFactor): AbstractCostEstimator(){
@@ -25,6 +26,39 @@ SproutingVolumetricCostEstimator::~SproutingVolumetricCostEstimator(){
 void SproutingVolumetricCostEstimator::previousState(AbstractObjectCCOTree* tree, AbstractVascularElement* parent, point iNew, point iTest, double dLim){
 	previousVolume = ((SingleVessel *) tree->getRoot())->treeVolume;
 
+	distToParent = computeDistToParent(parent, iNew);
+
+	parentRadius = ((SingleVessel *)parent)->radius;
+}
+
+void SproutingVolumetricCostEstimator::updateParentRadius(double parentRadius){
+	this->parentRadius = parentRadius;
+}
+
+double SproutingVolumetricCostEstimator::computeCost(AbstractObjectCCOTree* tree){
+	double volCost = volumeFactor * (computeTreeCost(tree->getRoot()) - previousVolume);
+	double proteolysisCost = proteolyticFactor * parentRadius; // 500.0
+	double stimulusCost = diffusionFactor * (distToParent * distToParent);
+	cout << "Volumetric cost = " << volCost << ", Protease degradation cost = " << proteolysisCost << ", VEGF/FGF difussion cost = " << stimulusCost << endl;
+	return volCost + proteolysisCost + stimulusCost ;
+}
+
+double SproutingVolumetricCostEstimator::computeVariationCost(double volumeVariation){
+	double volCost = volumeFactor * volumeVariation;
+	double proteolysisCost = proteolyticFactor * parentRadius;
+	double stimulusCost = diffusionFactor * (distToParent * distToParent);
+	return volCost + proteolysisCost + stimulusCost ;
+}
+
+double SproutingVolumetricCostEstimator::computeLowerBound(AbstractVascularElement *parent, double parentRadius, point iNew, double volumeVariationBound){
+	double volCost = volumeFactor * volumeVariationBound;
+	double proteolysisCost = proteolyticFactor * parentRadius;
+	double distToParent = computeDistToParent(parent, iNew);
+	double stimulusCost = diffusionFactor * (distToParent * distToParent);
+	return volCost + proteolysisCost + stimulusCost;
+}
+
+double SproutingVolumetricCostEstimator::computeDistToParent(AbstractVascularElement *parent, point iNew){
 	point a = ((SingleVessel *)parent)->xProx;
 	point b = ((SingleVessel *)parent)->xDist;
 	//	Parent-to-iNew distance
@@ -41,26 +75,13 @@ void SproutingVolumetricCostEstimator::previousState(AbstractObjectCCOTree* tree
 	}
 	//	Closest segment between iNew and parent vessel
 	point proj = (iNew - a) - m * t;
-	distToParent = sqrt(proj ^ proj);
-
-	parentRadius = ((SingleVessel *)parent)->radius;
-}
-
-double SproutingVolumetricCostEstimator::computeCost(AbstractObjectCCOTree* tree){
-	double volCost = volumeFactor * (computeTreeCost(tree->getRoot()) - previousVolume);
-	double proteolysisCost = proteolyticFactor * parentRadius; // 500.0
-	double stimulusCost = diffusionFactor * (distToParent * distToParent);
-	cout << "Volumetric cost = " << volCost << ", Protease degradation cost = " << proteolysisCost << ", VEGF/FGF difussion cost = " << stimulusCost << endl;
-	return volCost + proteolysisCost + stimulusCost ;
+	return sqrt(proj ^ proj);
 }
 
 double SproutingVolumetricCostEstimator::computeTreeCost(AbstractVascularElement* root) {
-	double currentCost = ((SingleVessel *)root)->getVolume();
-	vector<AbstractVascularElement *> children = root->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
-		currentCost += computeTreeCost(*it);
-	}
-	return currentCost;
+	return TreeTraversal::sum<double>(root, [](AbstractVascularElement *element) {
+		return ((SingleVessel *) element)->getVolume();
+	});
 }
 
 AbstractCostEstimator* SproutingVolumetricCostEstimator::clone(){
@@ -53,6 +53,11 @@ public:
 	 * @param dLim	Minimum radius distance from the new vessel to the tree.
 	 */
 	void previousState(AbstractObjectCCOTree *tree, AbstractVascularElement *parent, point iNew, point iTest, double dLim);
+	/**
+	 * Replaces the radius of the parent used by the wall degradation term.
+	 * @param parentRadius	Current radius of the parent.
+	 */
+	void updateParentRadius(double parentRadius);
 
 	/**
 	 * Computes the functional cost of the given tree.
@@ -60,6 +65,22 @@ public:
 	 * @return Cost of the given tree.
 	 */
 	double computeCost(AbstractObjectCCOTree* tree);
+	/**
+	 * Computes the functional cost of a tree whose volume changed by @p volumeVariation.
+	 * @param volumeVariation	Volume variation of the tree at the current step.
+	 * @return Cost of the tree.
+	 */
+	double computeVariationCost(double volumeVariation);
+	/**
+	 * Returns a lower bound of the cost of connecting @p iNew to @p parent. The wall degradation and diffusion terms
+	 * only depend on @p parent and @p iNew, so they are computed exactly and added to the bound of the volume term.
+	 * @param parent	Vascular element where the new vessel will be connected.
+	 * @param parentRadius	Current radius of @p parent.
+	 * @param iNew	Distal position of the new vessel.
+	 * @param volumeVariationBound	Lower bound of the tree volume variation due to the new vessel.
+	 * @return Lower bound of the cost.
+	 */
+	double computeLowerBound(AbstractVascularElement *parent, double parentRadius, point iNew, double volumeVariationBound);
 	/**
 	 * @return @p volumeFactor
 	 */
@@ -75,6 +96,13 @@ public:
 
 	void logCostEstimator(FILE *fp);
 private:
+	/**
+	 * Returns the distance between @p iNew and the segment of @p parent.
+	 * @param parent	Candidate parent vessel.
+	 * @param iNew	Distal position of the new vessel.
+	 * @return	Distance to the parent vessel.
+	 */
+	double computeDistToParent(AbstractVascularElement *parent, point iNew);
 	/**
 	 * Computes the volume for the tree with root @p root.
 	 * @param root	Root of the tree.
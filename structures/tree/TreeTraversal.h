@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * TreeTraversal.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef TREE_TREETRAVERSAL_H_
+#define TREE_TREETRAVERSAL_H_
+
+#include <vector>
+
+#include "../vascularElements/AbstractVascularElement.h"
+
+using namespace std;
+
+/**
+ * Depth-first traversals of the trees of AbstractVascularElement with an explicit stack, so the depth of the tree
+ * is not limited by the call stack (e.g. long chains of TRANSPORT or PERFORATOR vessels). The children of each
+ * element are accessed by reference and the stack grows with the depth of the tree, so there is no heap
+ * allocation per element. Elements must not be added or removed from the visited subtree during the traversal.
+ */
+class TreeTraversal {
+	/**	Initial capacity of the stack. */
+	static const unsigned int INITIAL_DEPTH = 64;
+
+	/**	Element in the stack and next child to visit. */
+	struct Frame {
+		AbstractVascularElement *element;
+		unsigned int nextChild;
+	};
+
+	/**	Element in the stack of sum, with the sum of its subtree for the already visited children. */
+	template<typename T>
+	struct SumFrame {
+		AbstractVascularElement *element;
+		unsigned int nextChild;
+		T sum;
+	};
+
+	/**	Visitor that does nothing. */
+	struct Skip {
+		void operator()(AbstractVascularElement */*element*/) {
+		}
+	};
+
+public:
+	/**
+	 * Depth-first traversal of the subtree of @p root. @p enter is called for each element before its children
+	 * (pre-order) and @p leave after all its children (post-order).
+	 * @param root	Root of the subtree.
+	 * @param enter	Callable with an AbstractVascularElement * argument.
+	 * @param leave	Callable with an AbstractVascularElement * argument.
+	 */
+	template<typename Enter, typename Leave>
+	static void depthFirst(AbstractVascularElement *root, Enter enter, Leave leave) {
+		vector<Frame> stack;
+		stack.reserve(INITIAL_DEPTH);
+		enter(root);
+		stack.push_back(Frame { root, 0 });
+		while (!stack.empty()) {
+			Frame &frame = stack.back();
+			vector<AbstractVascularElement *> &children = frame.element->getChildren();
+			if (frame.nextChild < children.size()) {
+				AbstractVascularElement *child = children[frame.nextChild++];
+				enter(child);
+				stack.push_back(Frame { child, 0 });
+			} else {
+				AbstractVascularElement *element = frame.element;
+				stack.pop_back();
+				leave(element);
+			}
+		}
+	}
+
+	/**
+	 * Calls @p visit for each element of the subtree of @p root in pre-order.
+	 * @param root	Root of the subtree.
+	 * @param visit	Callable with an AbstractVascularElement * argument.
+	 */
+	template<typename Visit>
+	static void preOrder(AbstractVascularElement *root, Visit visit) {
+		depthFirst(root, visit, Skip());
+	}
+
+	/**
+	 * Calls @p visit for each element of the subtree of @p root in post-order.
+	 * @param root	Root of the subtree.
+	 * @param visit	Callable with an AbstractVascularElement * argument.
+	 */
+	template<typename Visit>
+	static void postOrder(AbstractVascularElement *root, Visit visit) {
+		depthFirst(root, Skip(), visit);
+	}
+
+	/**
+	 * Returns the sum of @p value over the subtree of @p root. The sums are accumulated as value(element) plus the
+	 * sum of each child subtree in order, so the result is the same as the one of the recursive sum.
+	 * @param root	Root of the subtree.
+	 * @param value	Callable with an AbstractVascularElement * argument that returns a T.
+	 * @return	Sum over the subtree.
+	 */
+	template<typename T, typename Value>
+	static T sum(AbstractVascularElement *root, Value value) {
+		vector<SumFrame<T> > stack;
+		stack.reserve(INITIAL_DEPTH);
+		stack.push_back(SumFrame<T> { root, 0, value(root) });
+		while (true) {
+			SumFrame<T> &frame = stack.back();
+			vector<AbstractVascularElement *> &children = frame.element->getChildren();
+			if (frame.nextChild < children.size()) {
+				AbstractVascularElement *child = children[frame.nextChild++];
+				stack.push_back(SumFrame<T> { child, 0, value(child) });
+			} else {
+				T subtreeSum = frame.sum;
+				stack.pop_back();
+				if (stack.empty()) {
+					return subtreeSum;
+				}
+				stack.back().sum += subtreeSum;
+			}
+		}
+	}
+};
+
+#endif /* TREE_TREETRAVERSAL_H_ */
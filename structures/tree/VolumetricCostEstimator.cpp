@@ -8,6 +8,7 @@
  */
 
 #include "VolumetricCostEstimator.h"
+#include "TreeTraversal.h"
 #include "../vascularElements/SingleVessel.h"
 
 VolumetricCostEstimator::VolumetricCostEstimator() : AbstractCostEstimator(){
@@ -21,18 +22,22 @@ double VolumetricCostEstimator::computeCost(AbstractObjectCCOTree *tree){
 	return computeTreeCost(tree->getRoot()) - previousVolume;
 }
 
+double VolumetricCostEstimator::computeVariationCost(double volumeVariation){
+	return volumeVariation;
+}
+
+double VolumetricCostEstimator::computeLowerBound(AbstractVascularElement */*parent*/, double /*parentRadius*/, point /*iNew*/, double volumeVariationBound){
+	return volumeVariationBound;
+}
+
 void VolumetricCostEstimator::previousState(AbstractObjectCCOTree *tree, AbstractVascularElement* parent, point iNew, point iTest, double dLim){
 	previousVolume = ((SingleVessel *) tree->getRoot())->treeVolume;
 }
 
 double VolumetricCostEstimator::computeTreeCost(AbstractVascularElement* root) {
-
-	double currentCost = ((SingleVessel *)root)->getVolume();
-	vector<AbstractVascularElement *> children = root->getChildren();
-	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
-		currentCost += computeTreeCost(*it);
-	}
-	return currentCost;
+	return TreeTraversal::sum<double>(root, [](AbstractVascularElement *element) {
+		return ((SingleVessel *) element)->getVolume();
+	});
 }
 
 AbstractCostEstimator* VolumetricCostEstimator::clone(){
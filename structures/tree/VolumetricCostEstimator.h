@@ -51,6 +51,21 @@ public:
 	 * @return Cost of the given tree.
 	 */
 	double computeCost(AbstractObjectCCOTree *tree);
+	/**
+	 * Computes the functional cost of a tree whose volume changed by @p volumeVariation.
+	 * @param volumeVariation	Volume variation of the tree at the current step.
+	 * @return Cost of the tree.
+	 */
+	double computeVariationCost(double volumeVariation);
+	/**
+	 * Returns a lower bound of the cost of connecting @p iNew to @p parent, i.e. @p volumeVariationBound.
+	 * @param parent	Vascular element where the new vessel will be connected.
+	 * @param parentRadius	Current radius of @p parent.
+	 * @param iNew	Distal position of the new vessel.
+	 * @param volumeVariationBound	Lower bound of the tree volume variation due to the new vessel.
+	 * @return Lower bound of the cost.
+	 */
+	double computeLowerBound(AbstractVascularElement *parent, double parentRadius, point iNew, double volumeVariationBound);
 
 	void logCostEstimator(FILE *fp);
 
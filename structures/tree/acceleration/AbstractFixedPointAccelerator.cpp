@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AbstractFixedPointAccelerator.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "AbstractFixedPointAccelerator.h"
+
+AbstractFixedPointAccelerator::AbstractFixedPointAccelerator() {
+}
+
+AbstractFixedPointAccelerator::~AbstractFixedPointAccelerator() {
+}
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AbstractFixedPointAccelerator.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef STRUCTURES_TREE_ACCELERATION_ABSTRACTFIXEDPOINTACCELERATOR_H_
+#define STRUCTURES_TREE_ACCELERATION_ABSTRACTFIXEDPOINTACCELERATOR_H_
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Abstract class for the acceleration of a fixed-point iteration x = G(x). Given the current iterate and its image
+ * by G, it computes the next iterate from the history of previous iterates. Without acceleration the next iterate
+ * is the image itself (Picard iteration).
+ */
+class AbstractFixedPointAccelerator {
+public:
+	AbstractFixedPointAccelerator();
+	virtual ~AbstractFixedPointAccelerator();
+
+	/**
+	 * Returns a new accelerator with the same parameters and an empty history. Each thread uses its own clone, so
+	 * concurrent solves do not share their history.
+	 * @return	Accelerator clone.
+	 */
+	virtual AbstractFixedPointAccelerator *clone() = 0;
+	/**
+	 * Computes the next iterate.
+	 * @param x	Current iterate. It is replaced by the next iterate.
+	 * @param g	Image G(x) of the current iterate.
+	 */
+	virtual void accelerate(vector<double> &x, vector<double> &g) = 0;
+	/**
+	 * Discards the history, so the next call to accelerate behaves as the first one.
+	 */
+	virtual void reset() = 0;
+};
+
+#endif /* STRUCTURES_TREE_ACCELERATION_ABSTRACTFIXEDPOINTACCELERATOR_H_ */
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AitkenAccelerator.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "AitkenAccelerator.h"
+
+#include <cmath>
+
+AitkenAccelerator::AitkenAccelerator() {
+	this->omega = 1.0;
+}
+
+AitkenAccelerator::~AitkenAccelerator() {
+}
+
+AbstractFixedPointAccelerator *AitkenAccelerator::clone() {
+	return new AitkenAccelerator();
+}
+
+void AitkenAccelerator::reset() {
+	omega = 1.0;
+	previousResidual.clear();
+}
+
+void AitkenAccelerator::accelerate(vector<double> &x, vector<double> &g) {
+	size_t n = x.size();
+	vector<double> residual(n);
+	for (size_t i = 0; i < n; ++i) {
+		residual[i] = g[i] - x[i];
+	}
+
+	if (previousResidual.size() == n) {
+		double numerator = 0.0;
+		double denominator = 0.0;
+		for (size_t i = 0; i < n; ++i) {
+			double difference = residual[i] - previousResidual[i];
+			numerator += previousResidual[i] * difference;
+			denominator += difference * difference;
+		}
+		if (denominator > 0.0) {
+			omega = -omega * numerator / denominator;
+		}
+		if (!isfinite(omega)) {
+			omega = 1.0;
+		}
+	}
+	previousResidual = residual;
+
+	for (size_t i = 0; i < n; ++i) {
+		x[i] += omega * residual[i];
+	}
+}
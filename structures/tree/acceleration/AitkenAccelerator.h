@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AitkenAccelerator.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef STRUCTURES_TREE_ACCELERATION_AITKENACCELERATOR_H_
+#define STRUCTURES_TREE_ACCELERATION_AITKENACCELERATOR_H_
+
+#include "AbstractFixedPointAccelerator.h"
+
+/**
+ * Vector Aitken extrapolation (Irons-Tuck relaxation). The next iterate is x + omega * (G(x) - x), where the
+ * relaxation factor omega is updated from the last two residuals. The first iterate is the Picard one.
+ */
+class AitkenAccelerator: public AbstractFixedPointAccelerator {
+	/**	Current relaxation factor. */
+	double omega;
+	/**	Residual of the previous iterate. */
+	vector<double> previousResidual;
+public:
+	AitkenAccelerator();
+	virtual ~AitkenAccelerator();
+
+	AbstractFixedPointAccelerator *clone();
+	void accelerate(vector<double> &x, vector<double> &g);
+	void reset();
+};
+
+#endif /* STRUCTURES_TREE_ACCELERATION_AITKENACCELERATOR_H_ */
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AndersonAccelerator.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "AndersonAccelerator.h"
+
+#include <cmath>
+
+AndersonAccelerator::AndersonAccelerator(int depth) {
+	this->depth = depth > 0 ? depth : 1;
+}
+
+AndersonAccelerator::~AndersonAccelerator() {
+}
+
+AbstractFixedPointAccelerator *AndersonAccelerator::clone() {
+	return new AndersonAccelerator(depth);
+}
+
+void AndersonAccelerator::reset() {
+	previousResidual.clear();
+	previousImage.clear();
+	residualDifferences.clear();
+	imageDifferences.clear();
+}
+
+void AndersonAccelerator::accelerate(vector<double> &x, vector<double> &g) {
+	size_t n = x.size();
+	vector<double> residual(n);
+	for (size_t i = 0; i < n; ++i) {
+		residual[i] = g[i] - x[i];
+	}
+
+	if (previousResidual.size() == n) {
+		vector<double> residualDifference(n), imageDifference(n);
+		for (size_t i = 0; i < n; ++i) {
+			residualDifference[i] = residual[i] - previousResidual[i];
+			imageDifference[i] = g[i] - previousImage[i];
+		}
+		residualDifferences.push_back(residualDifference);
+		imageDifferences.push_back(imageDifference);
+		if ((int) residualDifferences.size() > depth) {
+			residualDifferences.pop_front();
+			imageDifferences.pop_front();
+		}
+	}
+	previousResidual = residual;
+	previousImage = g;
+
+	x = g;
+	int m = residualDifferences.size();
+	if (m == 0) {
+		return;
+	}
+
+	//	Normal equations of min || residual - residualDifferences * gamma ||
+	vector<double> a(m * (m + 1), 0.0);
+	for (int j = 0; j < m; ++j) {
+		for (int k = j; k < m; ++k) {
+			double dot = 0.0;
+			for (size_t i = 0; i < n; ++i) {
+				dot += residualDifferences[j][i] * residualDifferences[k][i];
+			}
+			a[j * (m + 1) + k] = dot;
+			a[k * (m + 1) + j] = dot;
+		}
+		double dot = 0.0;
+		for (size_t i = 0; i < n; ++i) {
+			dot += residualDifferences[j][i] * residual[i];
+		}
+		a[j * (m + 1) + m] = dot;
+	}
+
+	//	Gaussian elimination with partial pivoting
+	double scale = 0.0;
+	for (int j = 0; j < m; ++j) {
+		scale = fmax(scale, a[j * (m + 1) + j]);
+	}
+	for (int j = 0; j < m; ++j) {
+		int pivot = j;
+		for (int k = j + 1; k < m; ++k) {
+			if (fabs(a[k * (m + 1) + j]) > fabs(a[pivot * (m + 1) + j])) {
+				pivot = k;
+			}
+		}
+		if (!(fabs(a[pivot * (m + 1) + j]) > 1e-14 * scale)) {
+			//	Linearly dependent history
+			reset();
+			return;
+		}
+		if (pivot != j) {
+			for (int k = 0; k <= m; ++k) {
+				swap(a[j * (m + 1) + k], a[pivot * (m + 1) + k]);
+			}
+		}
+		for (int k = j + 1; k < m; ++k) {
+			double factor = a[k * (m + 1) + j] / a[j * (m + 1) + j];
+			for (int l = j; l <= m; ++l) {
+				a[k * (m + 1) + l] -= factor * a[j * (m + 1) + l];
+			}
+		}
+	}
+	vector<double> gamma(m);
+	for (int j = m - 1; j >= 0; --j) {
+		double value = a[j * (m + 1) + m];
+		for (int k = j + 1; k < m; ++k) {
+			value -= a[j * (m + 1) + k] * gamma[k];
+		}
+		gamma[j] = value / a[j * (m + 1) + j];
+	}
+
+	for (int j = 0; j < m; ++j) {
+		for (size_t i = 0; i < n; ++i) {
+			x[i] -= gamma[j] * imageDifferences[j][i];
+		}
+	}
+}
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * AndersonAccelerator.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef STRUCTURES_TREE_ACCELERATION_ANDERSONACCELERATOR_H_
+#define STRUCTURES_TREE_ACCELERATION_ANDERSONACCELERATOR_H_
+
+#include <deque>
+
+#include "AbstractFixedPointAccelerator.h"
+
+/**
+ * Anderson mixing over the last @p depth iterates. The next iterate is the combination of the last images whose
+ * residuals G(x) - x have minimum norm in the least squares sense. The first iterate, and any iterate with a
+ * singular least squares problem, is the Picard one.
+ */
+class AndersonAccelerator: public AbstractFixedPointAccelerator {
+	/**	Maximum amount of differences kept in the history. */
+	int depth;
+	/**	Residual of the previous iterate. */
+	vector<double> previousResidual;
+	/**	Image of the previous iterate. */
+	vector<double> previousImage;
+	/**	Differences between consecutive residuals, the latest at the back. */
+	deque<vector<double> > residualDifferences;
+	/**	Differences between consecutive images, the latest at the back. */
+	deque<vector<double> > imageDifferences;
+public:
+	/**
+	 * Constructor.
+	 * @param depth	Maximum amount of previous iterates used to compute the next one.
+	 */
+	AndersonAccelerator(int depth);
+	virtual ~AndersonAccelerator();
+
+	AbstractFixedPointAccelerator *clone();
+	void accelerate(vector<double> &x, vector<double> &g);
+	void reset();
+};
+
+#endif /* STRUCTURES_TREE_ACCELERATION_ANDERSONACCELERATOR_H_ */
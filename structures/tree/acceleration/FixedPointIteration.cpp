@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * FixedPointIteration.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "FixedPointIteration.h"
+
+#include <cmath>
+
+FixedPointIteration::Workspace::Workspace() {
+	this->source = NULL;
+	this->accelerator = NULL;
+}
+
+FixedPointIteration::Workspace::~Workspace() {
+	delete accelerator;
+}
+
+FixedPointIteration::Workspace &FixedPointIteration::getWorkspace() {
+	static thread_local Workspace workspace;
+	return workspace;
+}
+
+FixedPointIteration::FixedPointIteration(double tolerance, int maxIterations, AbstractFixedPointAccelerator *accelerator) {
+	this->tolerance = tolerance;
+	this->maxIterations = maxIterations;
+	this->iterations = 0;
+	this->workspace = NULL;
+	if (accelerator) {
+		workspace = &getWorkspace();
+		if (workspace->source != accelerator) {
+			delete workspace->accelerator;
+			workspace->accelerator = accelerator->clone();
+			workspace->source = accelerator;
+		} else {
+			workspace->accelerator->reset();
+		}
+		workspace->state.clear();
+	}
+}
+
+int FixedPointIteration::isAccelerated() const {
+	return workspace != NULL;
+}
+
+vector<double *> &FixedPointIteration::getState() {
+	return workspace->state;
+}
+
+int FixedPointIteration::next(double variation) {
+	if (iterations > 0 && !(variation > tolerance)) {
+		return 0;
+	}
+	if (maxIterations > 0 && iterations >= maxIterations) {
+		return 0;
+	}
+
+	if (workspace) {
+		vector<double *> &state = workspace->state;
+		vector<double> &x = workspace->x;
+		vector<double> &g = workspace->g;
+		size_t n = state.size();
+		if (iterations == 0) {
+			x.resize(n);
+			g.resize(n);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = *state[i];
+			}
+		} else {
+			for (size_t i = 0; i < n; ++i) {
+				g[i] = *state[i];
+			}
+			workspace->accelerator->accelerate(x, g);
+			int isPositive = 1;
+			for (size_t i = 0; i < n && isPositive; ++i) {
+				isPositive = x[i] > 0.0 && isfinite(x[i]);
+			}
+			if (!isPositive) {
+				x = g;
+				workspace->accelerator->reset();
+			}
+			for (size_t i = 0; i < n; ++i) {
+				*state[i] = x[i];
+			}
+		}
+	}
+
+	++iterations;
+	return 1;
+}
+
+int FixedPointIteration::getIterations() const {
+	return iterations;
+}
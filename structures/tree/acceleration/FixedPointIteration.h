@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * FixedPointIteration.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef STRUCTURES_TREE_ACCELERATION_FIXEDPOINTITERATION_H_
+#define STRUCTURES_TREE_ACCELERATION_FIXEDPOINTITERATION_H_
+
+#include <vector>
+
+#include "AbstractFixedPointAccelerator.h"
+
+using namespace std;
+
+/**
+ * Control of a fixed-point iteration whose sweeps update a positive state in place, such as the viscosity-beta
+ * iteration of the trees. It is used as
+ *
+ *	double variation = INFINITY;
+ *	FixedPointIteration iteration(tolerance, maxIterations, accelerator);
+ *	if (iteration.isAccelerated()) {
+ *		vector<double *> &state = iteration.getState();
+ *		//	Add the pointers to the state values
+ *	}
+ *	while (iteration.next(variation)) {
+ *		sweep(&variation);
+ *	}
+ *
+ * Between sweeps, the state left by the last sweep is replaced by the iterate computed by the accelerator. The
+ * state of the last sweep is kept once it converges, as in the plain iteration. Accelerated iterates that are not
+ * positive are replaced by the plain one.
+ *
+ * Each thread keeps a clone of the last accelerator used and the buffers of the iteration, so solves only allocate
+ * memory when the state grows. The clone is reset at the start of each solve. Solves in the same thread must not be
+ * nested.
+ */
+class FixedPointIteration {
+	/**	Accelerator and buffers of the solves of a thread. */
+	struct Workspace {
+		/**	Accelerator from which @p accelerator was cloned. */
+		AbstractFixedPointAccelerator *source;
+		/**	Clone of @p source. */
+		AbstractFixedPointAccelerator *accelerator;
+		/**	State updated by the sweeps. */
+		vector<double *> state;
+		/**	Current iterate. */
+		vector<double> x;
+		/**	State left by the last sweep. */
+		vector<double> g;
+
+		Workspace();
+		~Workspace();
+	};
+
+	/**
+	 * Returns the workspace of the calling thread.
+	 * @return	Workspace.
+	 */
+	static Workspace &getWorkspace();
+
+	/**	Workspace of the calling thread (NULL for the plain iteration). */
+	Workspace *workspace;
+	double tolerance;
+	/**	Maximum amount of sweeps (0 for no limit). */
+	int maxIterations;
+	/**	Sweeps performed. */
+	int iterations;
+public:
+	/**
+	 * Constructor.
+	 * @param tolerance	Maximum variation of the last sweep to stop the iteration.
+	 * @param maxIterations	Maximum amount of sweeps (0 for no limit).
+	 * @param accelerator	Accelerator of the iteration (NULL for the plain iteration). Each thread uses its own
+	 * clone, so it can be shared among concurrent solves.
+	 */
+	FixedPointIteration(double tolerance, int maxIterations, AbstractFixedPointAccelerator *accelerator);
+	/**
+	 * Returns if the iteration has an accelerator, in which case the state must be set with getState.
+	 * @return	1 if the iteration is accelerated.
+	 */
+	int isAccelerated() const;
+	/**
+	 * Returns the pointers to the state values updated by each sweep, empty at the start of the solve. Only
+	 * available for accelerated iterations.
+	 * @return	State pointers.
+	 */
+	vector<double *> &getState();
+	/**
+	 * Returns if another sweep must be performed and sets the state for that sweep.
+	 * @param variation	Variation of the last sweep.
+	 * @return	1 if another sweep is needed.
+	 */
+	int next(double variation);
+	/**
+	 * Returns the amount of sweeps performed.
+	 * @return	Sweeps performed.
+	 */
+	int getIterations() const;
+};
+
+#endif /* STRUCTURES_TREE_ACCELERATION_FIXEDPOINTITERATION_H_ */
@@ -73,10 +73,7 @@ SingleVesselCCOOTree* BreadthFirstPruning::pruneTreeFast(SingleVesselCCOOTree *t
 	newTree->updateTree(((SingleVessel *) newTree->root), newTree);
 
     //	Update resistance, pressure and betas
-	double maxVariation = INFINITY;
-	while (maxVariation > newTree->variationTolerance) {
-	    newTree->updateTreeViscositiesBeta(((SingleVessel *) newTree->root), &maxVariation);
-	}    
+	newTree->solveViscositiesBeta((SingleVessel *) newTree->root);
 
     delete toPreserve;
     return newTree;
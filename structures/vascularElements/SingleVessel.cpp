@@ -9,17 +9,31 @@
 
 #include "SingleVessel.h"
 
+#include <cstdio>
+
+#include "VesselPool.h"
+
 int SingleVessel::bifurcationTests = 6;
 
 SingleVessel::SingleVessel() :
 		AbstractVascularElement() {
 	vessels.push_back(this);
 	branchingMode = BRANCHING_MODE::DEFORMABLE_PARENT;
+	commonTerminals = 0;
+	reservedFlow = 0.0;
 }
 
 SingleVessel::~SingleVessel() {
 }
 
+void *SingleVessel::operator new(size_t size) {
+	return VesselPool::allocate(size);
+}
+
+void SingleVessel::operator delete(void *vessel, size_t size) {
+	VesselPool::release(vessel, size);
+}
+
 AbstractVascularElement* SingleVessel::getParent() {
 	return parent;
 }
@@ -107,6 +121,29 @@ void SingleVessel::saveVesselConnectivity(ofstream* treeFile) {
 
 }
 
+void SingleVessel::appendVesselData(string &buffer) {
+	//	%.16e prints the same characters as the scientific precision 16 of AbstractObjectCCOTree::save
+	static const char *zero = "0.0000000000000000e+00";
+	char line[512];
+	int length = snprintf(line, sizeof(line), "%lld %.16e %.16e %.16e %.16e %.16e %.16e %s %s %s %.16e %d %.16e %s %s %s %s %d %s %s %d",
+			(long long) vtkSegmentId, xProx.p[0], xProx.p[1], xProx.p[2], xDist.p[0], xDist.p[1], xDist.p[2],
+			zero, zero, zero, qReservedFraction, (int) branchingMode, radius, zero, zero, zero, zero,
+			(int) vesselFunction, zero, zero, stage);
+	buffer.append(line, length);
+}
+
+void SingleVessel::appendVesselConnectivity(string &buffer) {
+	char id[32];
+	int length = snprintf(id, sizeof(id), "%lld %lld", (long long) vtkSegmentId,
+			parent ? (long long) ((SingleVessel *) parent)->vtkSegmentId : -1ll);
+	buffer.append(id, length);
+
+	for (std::vector<AbstractVascularElement *>::iterator it = children.begin(); it != children.end(); ++it) {
+		length = snprintf(id, sizeof(id), " %lld", (long long) ((SingleVessel *) (*it))->vtkSegmentId);
+		buffer.append(id, length);
+	}
+}
+
 void SingleVessel::getBranchingPoints(vector<point>* branchingPoints, point xNew) {
 
 	int bifPartition = SingleVessel::bifurcationTests;
@@ -61,10 +61,27 @@ public:
 	long long int ID;
 	/** Volume of this down tree branch.*/
 	double treeVolume;
+	/** Amount of COMMON terminals in this down tree branch. */
+	long long int commonTerminals;
+	/** Flow of the RESERVED terminals in this down tree branch. */
+	double reservedFlow;
 
 	SingleVessel();
 	~SingleVessel();
 
+	/**
+	 * Allocates the vessel from the per-thread VesselPool.
+	 * @param size	Size of the object.
+	 * @return	Memory block for the vessel.
+	 */
+	static void *operator new(size_t size);
+	/**
+	 * Returns the vessel memory to the VesselPool.
+	 * @param vessel	Memory block of the vessel.
+	 * @param size	Size of the object.
+	 */
+	static void operator delete(void *vessel, size_t size);
+
 	/**
 	 * Fill @p branchingPoints with the potential points for branching in the current vessel, accorading to the @p branchingMode.
 	 * @param branchingPoints Vector filled with the possible branching points of this vessel.
@@ -143,6 +160,16 @@ public:
 
 	void saveVesselData(ofstream *treeFile);
 	void saveVesselConnectivity(ofstream *treeFile);
+	/**
+	 * Appends to @p buffer the same text written by saveVesselData in a stream with scientific precision 16.
+	 * @param buffer	Text buffer.
+	 */
+	void appendVesselData(string &buffer);
+	/**
+	 * Appends to @p buffer the same text written by saveVesselConnectivity.
+	 * @param buffer	Text buffer.
+	 */
+	void appendVesselConnectivity(string &buffer);
 
 	string coordToString();
 
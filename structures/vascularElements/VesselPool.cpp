@@ -0,0 +1,187 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * VesselPool.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "VesselPool.h"
+#include "SingleVessel.h"
+
+#include <cstdlib>
+#include <new>
+
+//	Blocks are rounded up to keep the alignment of the system allocator
+const size_t VesselPool::blockSize = ((sizeof(SingleVessel) + alignof(max_align_t) - 1) / alignof(max_align_t)) * alignof(max_align_t);
+int VesselPool::blocksPerChunk = 4096;
+mutex VesselPool::poolLock;
+VesselPool::FreeBlock *VesselPool::sharedFreeList = nullptr;
+long long int VesselPool::nSharedFree = 0;
+set<VesselPool::LocalCache *> VesselPool::caches;
+long long int VesselPool::carvedBlocks = 0;
+VesselPool::Statistics VesselPool::retired = {0, 0, 0, 0, 0, 0};
+
+namespace {
+	/**	Set once the cache of the current thread is destroyed at thread exit. */
+	thread_local int isCacheRetired = 0;
+}
+
+VesselPool::LocalCache::LocalCache() {
+	this->freeList = nullptr;
+	this->nFree = 0;
+	this->allocations = 0;
+	this->releases = 0;
+	this->fallbacks = 0;
+	lock_guard<mutex> lock(poolLock);
+	caches.insert(this);
+}
+
+VesselPool::LocalCache::~LocalCache() {
+	lock_guard<mutex> lock(poolLock);
+	while (freeList) {
+		FreeBlock *block = freeList;
+		freeList = block->next;
+		block->next = sharedFreeList;
+		sharedFreeList = block;
+		++nSharedFree;
+	}
+	nFree = 0;
+	retired.allocations += allocations;
+	retired.releases += releases;
+	retired.fallbacks += fallbacks;
+	caches.erase(this);
+	isCacheRetired = 1;
+}
+
+VesselPool::LocalCache *VesselPool::getLocalCache() {
+	//	Vessels may be released by static destructors after the thread cache is gone
+	if (isCacheRetired) {
+		return nullptr;
+	}
+	static thread_local LocalCache cache;
+	return &cache;
+}
+
+VesselPool::FreeBlock *VesselPool::takeShared(long long int amount, long long int *taken) {
+	if (!sharedFreeList) {
+		char *chunk = (char *) malloc(blockSize * blocksPerChunk);
+		if (!chunk) {
+			throw bad_alloc();
+		}
+		for (int i = blocksPerChunk - 1; i >= 0; --i) {
+			FreeBlock *block = (FreeBlock *) (chunk + i * blockSize);
+			block->next = sharedFreeList;
+			sharedFreeList = block;
+		}
+		nSharedFree += blocksPerChunk;
+		carvedBlocks += blocksPerChunk;
+		++retired.chunks;
+		retired.reservedBytes += blockSize * blocksPerChunk;
+	}
+
+	FreeBlock *head = sharedFreeList;
+	FreeBlock *tail = head;
+	*taken = 1;
+	while (*taken < amount && tail->next) {
+		tail = tail->next;
+		++(*taken);
+	}
+	sharedFreeList = tail->next;
+	tail->next = nullptr;
+	nSharedFree -= *taken;
+	return head;
+}
+
+void VesselPool::giveBack(LocalCache *cache, long long int amount) {
+	lock_guard<mutex> lock(poolLock);
+	for (long long int i = 0; i < amount && cache->freeList; ++i) {
+		FreeBlock *block = cache->freeList;
+		cache->freeList = block->next;
+		block->next = sharedFreeList;
+		sharedFreeList = block;
+		++nSharedFree;
+		--cache->nFree;
+	}
+}
+
+void *VesselPool::allocate(size_t size) {
+	LocalCache *cache = getLocalCache();
+	if (size > blockSize) {
+		if (cache) {
+			++cache->fallbacks;
+		} else {
+			lock_guard<mutex> lock(poolLock);
+			++retired.fallbacks;
+		}
+		return ::operator new(size);
+	}
+
+	if (!cache) {
+		lock_guard<mutex> lock(poolLock);
+		long long int taken;
+		FreeBlock *block = takeShared(1, &taken);
+		++retired.allocations;
+		return block;
+	}
+
+	if (!cache->freeList) {
+		lock_guard<mutex> lock(poolLock);
+		cache->freeList = takeShared(blocksPerChunk, &cache->nFree);
+	}
+	FreeBlock *block = cache->freeList;
+	cache->freeList = block->next;
+	--cache->nFree;
+	++cache->allocations;
+	return block;
+}
+
+void VesselPool::release(void *block, size_t size) {
+	if (!block) {
+		return;
+	}
+	LocalCache *cache = getLocalCache();
+	if (size > blockSize) {
+		::operator delete(block);
+		return;
+	}
+
+	if (!cache) {
+		lock_guard<mutex> lock(poolLock);
+		FreeBlock *freeBlock = (FreeBlock *) block;
+		freeBlock->next = sharedFreeList;
+		sharedFreeList = freeBlock;
+		++nSharedFree;
+		++retired.releases;
+		return;
+	}
+
+	FreeBlock *freeBlock = (FreeBlock *) block;
+	freeBlock->next = cache->freeList;
+	cache->freeList = freeBlock;
+	++cache->nFree;
+	++cache->releases;
+
+	//	Threads that mostly release vessels created elsewhere give the excess back
+	if (cache->nFree > 4 * (long long int) blocksPerChunk) {
+		giveBack(cache, 2 * (long long int) blocksPerChunk);
+	}
+}
+
+VesselPool::Statistics VesselPool::getStatistics() {
+	lock_guard<mutex> lock(poolLock);
+	Statistics stats = retired;
+	for (set<LocalCache *>::iterator it = caches.begin(); it != caches.end(); ++it) {
+		stats.allocations += (*it)->allocations;
+		stats.releases += (*it)->releases;
+		stats.fallbacks += (*it)->fallbacks;
+	}
+	stats.freeBlocks = carvedBlocks - (stats.allocations - stats.releases);
+	return stats;
+}
+
+void VesselPool::setBlocksPerChunk(int blocksPerChunk) {
+	lock_guard<mutex> lock(poolLock);
+	VesselPool::blocksPerChunk = blocksPerChunk;
+}
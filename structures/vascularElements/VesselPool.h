@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * VesselPool.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef VASCULARELEMENTS_VESSELPOOL_H_
+#define VASCULARELEMENTS_VESSELPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Pool allocator for SingleVessel objects. Each thread keeps its own list of free blocks, so the
+ * allocations done by evaluate/cloneUpTo inside the OpenMP loops and the ones done by addVessel do not
+ * contend on the system allocator. Blocks are carved from large chunks that are reused for the whole
+ * process lifetime; a thread that accumulates too many free blocks (e.g. when vessels are deleted in a
+ * different thread than the one that created them) gives part of them back to a shared list.
+ */
+class VesselPool {
+public:
+	/**
+	 * Allocator statistics aggregated among all threads.
+	 */
+	struct Statistics {
+		/**	Blocks handed out by the pool. */
+		long long int allocations;
+		/**	Blocks returned to the pool. */
+		long long int releases;
+		/**	Allocations with an unexpected size served by the system allocator. */
+		long long int fallbacks;
+		/**	Chunks requested to the system allocator. */
+		long long int chunks;
+		/**	Bytes reserved in chunks. */
+		long long int reservedBytes;
+		/**	Blocks reserved in chunks that are not in use. */
+		long long int freeBlocks;
+	};
+
+	/**
+	 * Returns a block for an object of @p size bytes.
+	 * @param size	Size of the object.
+	 * @return	Block of memory.
+	 */
+	static void *allocate(size_t size);
+	/**
+	 * Returns @p block to the pool.
+	 * @param block	Block obtained from allocate.
+	 * @param size	Size of the object.
+	 */
+	static void release(void *block, size_t size);
+	/**
+	 * Returns the statistics of the pool.
+	 * @return	Pool statistics.
+	 */
+	static Statistics getStatistics();
+	/**
+	 * Setter of the amount of blocks per chunk (4096 by default).
+	 * @param blocksPerChunk	Amount of blocks per chunk.
+	 */
+	static void setBlocksPerChunk(int blocksPerChunk);
+
+private:
+	/**	Free block header. */
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+	/**	Per-thread free list and counters. */
+	struct LocalCache {
+		FreeBlock *freeList;
+		long long int nFree;
+		atomic<long long int> allocations;
+		atomic<long long int> releases;
+		atomic<long long int> fallbacks;
+		LocalCache();
+		~LocalCache();
+	};
+
+	static LocalCache *getLocalCache();
+	static FreeBlock *takeShared(long long int amount, long long int *taken);
+	static void giveBack(LocalCache *cache, long long int amount);
+
+	/**	Size of each block. */
+	static const size_t blockSize;
+	/**	Amount of blocks per chunk. */
+	static int blocksPerChunk;
+	/**	Lock for the shared state. */
+	static mutex poolLock;
+	/**	Free blocks shared among threads. */
+	static FreeBlock *sharedFreeList;
+	/**	Amount of blocks in @p sharedFreeList. */
+	static long long int nSharedFree;
+	/**	Caches of the running threads. */
+	static set<LocalCache *> caches;
+	/**	Blocks carved from chunks. */
+	static long long int carvedBlocks;
+	/**	Statistics of the finished threads and chunk counters. */
+	static Statistics retired;
+};
+
+/**
+ * Overload operator to print the statistics @p stats in a stream object.
+ * @param os	Stream output.
+ * @param stats	Statistics to print.
+ * @return	Streamed output.
+ */
+inline ostream& operator<<(ostream& os, VesselPool::Statistics stats) {
+	os << "Vessel pool: " << stats.allocations << " allocations, " << stats.releases << " releases ("
+			<< stats.allocations - stats.releases << " live, " << stats.freeBlocks << " free), " << stats.fallbacks
+			<< " fallbacks, " << stats.chunks << " chunks (" << stats.reservedBytes / 1024 << " KB).";
+	return os;
+}
+
+#endif /* VASCULARELEMENTS_VESSELPOOL_H_ */
@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * BinaryFormatTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include "TestTrees.h"
+#include "../structures/tree/BinaryTreeFormat.h"
+
+/**
+ * Returns the bytes of the file @p filename.
+ */
+vector<char> readBytes(string filename) {
+	ifstream file(filename.c_str(), ios::in | ios::binary);
+	return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+/**
+ * Writes @p bytes to the file @p filename.
+ */
+void writeBytes(string filename, vector<char> &bytes) {
+	ofstream file(filename.c_str(), ios::out | ios::binary);
+	file.write(bytes.data(), bytes.size());
+}
+
+/**
+ * Loads the tree saved in @p filename with the test parameters.
+ */
+SingleVesselCCOOTree *loadTestTree(string filename) {
+	cout.setstate(ios::failbit);
+	SingleVesselCCOOTree *tree = new SingleVesselCCOOTree(filename, createTestGeneratorData(), getTestConstraints(3.0, 1)[0],
+			getTestConstraints(0.0, 1)[0], getTestConstraints(3.6, 1)[0]);
+	cout.clear();
+	return tree;
+}
+
+/**
+ * Saves @p bytes in @p filename and returns if loading it gives no tree.
+ */
+int isRejected(string filename, vector<char> &bytes) {
+	writeBytes(filename, bytes);
+	SingleVesselCCOOTree *tree = loadTestTree(filename);
+	int isRejected = tree->getRoot() == NULL;
+	delete tree;
+	remove(filename.c_str());
+	return isRejected;
+}
+
+/**
+ * Checks that trees saved in the .ccb and .ccbz formats are loaded back with the same vessels, and that truncated
+ * or corrupted files are rejected.
+ */
+int main() {
+	long long int nTerminals = 150;
+	int nFailed = 0;
+
+	StagedFRROTreeGenerator *generator = createBoxGenerator(nTerminals, 17);
+	generateSilently(generator, nTerminals);
+	SingleVesselCCOOTree *tree = (SingleVesselCCOOTree *) generator->getTree();
+
+	nFailed += check(tree->save("binaryFormatTest.ccb") && tree->save("binaryFormatTest.ccbz") && tree->save("binaryFormatTest.cco"),
+			"trees are saved in the binary and text formats");
+
+	SingleVesselCCOOTree *binaryTree = loadTestTree("binaryFormatTest.ccb");
+	SingleVesselCCOOTree *compressedTree = loadTestTree("binaryFormatTest.ccbz");
+	SingleVesselCCOOTree *textTree = loadTestTree("binaryFormatTest.cco");
+	nFailed += check(binaryTree->getNTerms() == tree->getNTerms() && binaryTree->getPointCounter() == tree->getPointCounter(),
+			".ccb keeps the terminals and the point counter");
+	nFailed += check(getMaxRadiusDifference(binaryTree, tree) == 0.0, ".ccb round trip keeps the vessels");
+	nFailed += check(getMaxRadiusDifference(compressedTree, binaryTree) == 0.0, ".ccbz loads the same tree as .ccb");
+	nFailed += check(getMaxRadiusDifference(binaryTree, textTree) == 0.0, ".ccb loads the same tree as .cco");
+
+	vector<char> bytes = readBytes("binaryFormatTest.ccb");
+	vector<char> compressedBytes = readBytes("binaryFormatTest.ccbz");
+	remove("binaryFormatTest.ccb");
+	remove("binaryFormatTest.ccbz");
+	remove("binaryFormatTest.cco");
+
+	vector<char> corrupted(bytes.begin(), bytes.begin() + bytes.size() / 2);
+	nFailed += check(isRejected("corruptedTest.ccb", corrupted), "truncated .ccb is rejected");
+
+	corrupted = bytes;
+	corrupted[0] = 'X';
+	nFailed += check(isRejected("corruptedTest.ccb", corrupted), ".ccb with a wrong magic is rejected");
+
+	corrupted = bytes;
+	((BinaryTreeFormat::Header *) corrupted.data())->version = BinaryTreeFormat::VERSION + 1;
+	nFailed += check(isRejected("corruptedTest.ccb", corrupted), ".ccb with a newer version is rejected");
+
+	corrupted = bytes;
+	int64_t nVessels = ((BinaryTreeFormat::Header *) corrupted.data())->nVessels;
+	int64_t *parents = (int64_t *) (corrupted.data() + sizeof(BinaryTreeFormat::Header) + nVessels * sizeof(BinaryTreeFormat::VesselRecord));
+	parents[1] = nVessels + 5;
+	nFailed += check(isRejected("corruptedTest.ccb", corrupted), ".ccb with an out of range parent is rejected");
+
+	corrupted = vector<char>(compressedBytes.begin(), compressedBytes.end() - 16);
+	nFailed += check(isRejected("corruptedTest.ccbz", corrupted), "truncated .ccbz is rejected");
+
+	corrupted = compressedBytes;
+	for (unsigned int i = corrupted.size() / 2; i < corrupted.size() / 2 + 32; ++i) {
+		corrupted[i] = ~corrupted[i];
+	}
+	nFailed += check(isRejected("corruptedTest.ccbz", corrupted), ".ccbz with a corrupted block is rejected");
+
+	return nFailed;
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * BoxDomain.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef TEST_BOXDOMAIN_H_
+#define TEST_BOXDOMAIN_H_
+
+#include <cmath>
+#include <random>
+
+#include "../structures/domain/AbstractDomain.h"
+
+/**
+ * Cube [-halfSide, halfSide]^3 sampled with its own random generator. It has no VTK geometry, so the regression
+ * tests do not depend on domain files.
+ */
+class BoxDomain : public AbstractDomain {
+	/** Half of the side of the cube. */
+	double halfSide;
+	/** Random generator of the sampled points. */
+	mt19937 generator;
+	/** Points given back to the domain. */
+	deque<point> randomInnerPoints;
+	/** Empty geometry. */
+	vtkSmartPointer<vtkPolyData> vtkGeometry;
+public:
+	/**
+	 * Constructor.
+	 * @param instanceData	Parameters of the generation.
+	 * @param halfSide	Half of the side of the cube.
+	 * @param seed	Seed of the random generator.
+	 */
+	BoxDomain(GeneratorData *instanceData, double halfSide, int seed) : AbstractDomain(instanceData), generator(seed) {
+		this->halfSide = halfSide;
+	}
+
+	int isSegmentInside(point xs, point xf) {
+		for (int i = 0; i < 3; ++i) {
+			if (fabs(xs.p[i]) > halfSide || fabs(xf.p[i]) > halfSide) {
+				return 0;
+			}
+		}
+		return 1;
+	}
+
+	double getCharacteristicLength() {
+		return halfSide;
+	}
+
+	double getDLim(long long int nVessels, double factor) {
+		return halfSide * cbrt(factor / nVessels);
+	}
+
+	double *getLocalNeighborhood(point p, long long int nVessels) {
+		double *localBox = new double[6];
+		double radius = instanceData->closeNeighborhoodFactor * getDLim(nVessels, instanceData->perfusionAreaFactor);
+		for (int i = 0; i < 3; ++i) {
+			localBox[2 * i] = p.p[i] - radius;
+			localBox[2 * i + 1] = p.p[i] + radius;
+		}
+		return localBox;
+	}
+
+	double getSize() {
+		return 8 * halfSide * halfSide * halfSide;
+	}
+
+	point getRandomPoint() {
+		++pointCounter;
+		if (!randomInnerPoints.empty()) {
+			point p = randomInnerPoints.front();
+			randomInnerPoints.pop_front();
+			return p;
+		}
+		uniform_real_distribution<double> distribution(-halfSide, halfSide);
+		point p;
+		for (int i = 0; i < 3; ++i) {
+			p.p[i] = distribution(generator);
+		}
+		return p;
+	}
+
+	deque<point>& getRandomInnerPoints() {
+		return randomInnerPoints;
+	}
+
+	void saveState(ostream &os) {
+		AbstractDomain::saveState(os);
+		os << generator << endl;
+	}
+
+	void loadState(istream &is) {
+		AbstractDomain::loadState(is);
+		is >> generator;
+	}
+
+	vtkSmartPointer<vtkPolyData>& getVtkGeometry() {
+		return vtkGeometry;
+	}
+
+	vtkSmartPointer<vtkSelectEnclosedPoints> getEnclosedPoints() {
+		return vtkSmartPointer<vtkSelectEnclosedPoints>();
+	}
+
+	void logDomainFiles(FILE *fp) {
+		fprintf(fp, "BoxDomain\n");
+	}
+
+	int getDraw() {
+		return 0;
+	}
+
+	int getSeed() {
+		return 0;
+	}
+};
+
+#endif /* TEST_BOXDOMAIN_H_ */
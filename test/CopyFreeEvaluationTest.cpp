@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * CopyFreeEvaluationTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "TestTrees.h"
+#include "../structures/tree/SproutingVolumetricCostEstimator.h"
+
+/**
+ * Returns the maximum difference between the costs of the copy-free and the copying evaluation of random terminals
+ * connected to every vessel of the tree of @p generator, relative to the largest cost of each terminal.
+ */
+double getMaxCostDifference(StagedFRROTreeGenerator *generator, int nPoints) {
+	SingleVesselCCOOTree *tree = (SingleVesselCCOOTree *) generator->getTree();
+	AbstractDomain *domain = generator->getDomain();
+	vector<SingleVessel *> vessels = getTestVessels(tree);
+	vector<AbstractVascularElement *> neighbors(vessels.begin(), vessels.end());
+	double dLim = generator->getDLim();
+	double maxDifference = 0.0;
+	for (int i = 0; i < nPoints; ++i) {
+		point xNew = domain->getRandomPoint();
+		double maxCost = 0.0;
+		double maxPointDifference = 0.0;
+		for (unsigned int j = 0; j < vessels.size(); ++j) {
+			point xBif, xBifCopyFree;
+			double cost, costCopyFree;
+			tree->setIsCopyFreeEvaluation(0);
+			tree->testVessel(xNew, vessels[j], domain, neighbors, dLim, &xBif, &cost);
+			tree->setIsCopyFreeEvaluation(1);
+			tree->testVessel(xNew, vessels[j], domain, neighbors, dLim, &xBifCopyFree, &costCopyFree);
+			if (cost == INFINITY || costCopyFree == INFINITY) {
+				if (cost != costCopyFree) {
+					return INFINITY;
+				}
+				continue;
+			}
+			maxCost = max(maxCost, fabs(cost));
+			maxPointDifference = max(maxPointDifference, fabs(costCopyFree - cost));
+		}
+		if (maxCost > 0.0) {
+			maxDifference = max(maxDifference, maxPointDifference / maxCost);
+		}
+	}
+	tree->setIsCopyFreeEvaluation(0);
+	return maxDifference;
+}
+
+/**
+ * Returns the test parameters with the volumetric cost estimator or, if @p isSprouting, with the sprouting one.
+ */
+GeneratorData *createEstimatorData(int isSprouting) {
+	GeneratorData *instanceData = createTestGeneratorData();
+	if (isSprouting) {
+		instanceData->costEstimator = new SproutingVolumetricCostEstimator(10.0, 1.0, 0.05);
+	}
+	return instanceData;
+}
+
+/**
+ * Checks that the copy-free evaluation gives the costs of the evaluation on a copy of the tree, and so the same tree,
+ * for the volumetric and the sprouting cost estimators.
+ */
+int main() {
+	long long int nTerminals = 100;
+	int nFailed = 0;
+
+	vector<string> names = {"volumetric", "sprouting"};
+
+	for (int i = 0; i < 2; ++i) {
+		StagedFRROTreeGenerator *generator = createBoxGenerator(nTerminals, 3, createEstimatorData(i));
+		generateSilently(generator, nTerminals);
+		cout.setstate(ios::failbit);
+		double difference = getMaxCostDifference(generator, 20);
+		cout.clear();
+		cout << "Maximum relative cost difference with the " << names[i] << " estimator: " << difference << endl;
+		//	The copy-free evaluation keeps the viscosities of the vessels deeper in the unmodified subtrees
+		nFailed += check(difference < 5e-3, "copy-free costs match the copying costs with the " + names[i] + " estimator");
+
+		StagedFRROTreeGenerator *copyFreeGenerator = createBoxGenerator(nTerminals, 3, createEstimatorData(i));
+		((SingleVesselCCOOTree *) copyFreeGenerator->getTree())->setIsCopyFreeEvaluation(1);
+		generateSilently(copyFreeGenerator, nTerminals);
+		difference = getMaxRadiusDifference(copyFreeGenerator->getTree(), generator->getTree());
+		nFailed += check(difference == 0.0, "copy-free evaluation builds the same tree with the " + names[i] + " estimator");
+	}
+
+	return nFailed;
+}
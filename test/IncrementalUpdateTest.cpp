@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * IncrementalUpdateTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "TestTrees.h"
+
+/**
+ * Checks that the incremental update of SingleVesselCCOOTree with its default error bound gives the same tree as the
+ * full update within the viscosity tolerance.
+ */
+int main() {
+	long long int nTerminals = 200;
+	int nFailed = 0;
+
+	StagedFRROTreeGenerator *fullGenerator = createBoxGenerator(nTerminals, 7);
+	generateSilently(fullGenerator, nTerminals);
+
+	StagedFRROTreeGenerator *incrementalGenerator = createBoxGenerator(nTerminals, 7);
+	((SingleVesselCCOOTree *) incrementalGenerator->getTree())->setIsIncrementalUpdate(1);
+	generateSilently(incrementalGenerator, nTerminals);
+	double difference = getMaxRadiusDifference(incrementalGenerator->getTree(), fullGenerator->getTree());
+	cout << "Maximum relative radius difference: " << difference << endl;
+	nFailed += check(difference < 1e-4, "incremental update matches the full update");
+
+	return nFailed;
+}
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * JournalReplayTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "TestTrees.h"
+#include "../io/task/CheckpointSavingTask.h"
+#include "../io/task/JournalCheckpointSavingTask.h"
+
+/**
+ * Loads the tree saved in @p filename with the test parameters.
+ */
+SingleVesselCCOOTree *loadTestTree(string filename) {
+	cout.setstate(ios::failbit);
+	SingleVesselCCOOTree *tree = new SingleVesselCCOOTree(filename, createTestGeneratorData(), getTestConstraints(3.0, 1)[0],
+			getTestConstraints(0.0, 1)[0], getTestConstraints(3.6, 1)[0]);
+	cout.clear();
+	return tree;
+}
+
+/**
+ * Loads the base snapshot of @p journalFilename and replays the journal on it.
+ * @return	Replayed tree.
+ */
+SingleVesselCCOOTree *replayTestJournal(string journalFilename, long long int *nAdded) {
+	vector<AbstractConstraintFunction<double, int> *> gams = getTestConstraints(3.0, 1);
+	vector<AbstractConstraintFunction<double, int> *> epsLims = getTestConstraints(0.0, 1);
+	vector<AbstractConstraintFunction<double, int> *> nus = getTestConstraints(3.6, 1);
+	SingleVesselCCOOTree *tree = loadTestTree(JournalCheckpointSavingTask::getBaseFilename(journalFilename));
+	cout.setstate(ios::failbit);
+	*nAdded = JournalCheckpointSavingTask::replay(journalFilename, tree, gams, epsLims, nus);
+	cout.clear();
+	return tree;
+}
+
+/**
+ * Removes the directory @p path and its files.
+ */
+void removeDirectory(string path) {
+	DIR *directory = opendir(path.c_str());
+	if (directory) {
+		for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory)) {
+			string name = entry->d_name;
+			if (name != "." && name != "..") {
+				remove((path + "/" + name).c_str());
+			}
+		}
+		closedir(directory);
+	}
+	remove(path.c_str());
+}
+
+/**
+ * Checks that the tree replayed from a journal is the same as the full checkpoint saved at the same save point,
+ * also when the journal ends with an interrupted append.
+ */
+int main() {
+	long long int nTerminals = 200;
+	int nFailed = 0;
+	string path = "journalReplayTest";
+	removeDirectory(path);
+	mkdir(path.c_str(), 0755);
+
+	StagedFRROTreeGenerator *generator = createBoxGenerator(nTerminals, 29);
+	vector<AbstractSavingTask *> savingTasks = {new CheckpointSavingTask(path, "full"), new JournalCheckpointSavingTask(path, "journal", 3)};
+	generator->setSavingTasks(savingTasks);
+	generateSilently(generator, 25);
+	delete generator;
+
+	string journalFilename = path + "/journal.jnl";
+	SingleVesselCCOOTree *checkpointTree = loadTestTree(path + "/full" + to_string(nTerminals - 1) + ".cco");
+	long long int nAdded;
+	SingleVesselCCOOTree *replayedTree = replayTestJournal(journalFilename, &nAdded);
+	cout << "Vessels added by the journal: " << nAdded << endl;
+	nFailed += check(nAdded > 0, "journal has insertions after its base snapshot");
+	nFailed += check(replayedTree->getPointCounter() == checkpointTree->getPointCounter(), "replay restores the point counter");
+	nFailed += check(getMaxRadiusDifference(replayedTree, checkpointTree) == 0.0, "replayed tree matches the full checkpoint");
+
+	{
+		ofstream journal(journalFilename.c_str(), ios::app);
+		journal << "V 1 0.1 0.2 0.3 0.4\nC 310";
+	}
+	long long int nAddedInterrupted;
+	SingleVesselCCOOTree *interruptedTree = replayTestJournal(journalFilename, &nAddedInterrupted);
+	nFailed += check(nAddedInterrupted == nAdded && getMaxRadiusDifference(interruptedTree, checkpointTree) == 0.0,
+			"interrupted append is ignored by the replay");
+
+	removeDirectory(path);
+	return nFailed;
+}
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * ReconciliationTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include "TestTrees.h"
+
+/**
+ * Checks that the incremental update reconciled every few insertions or by a loose error bound gives the same tree
+ * as the full update once the deferred values are flushed, and that the reconciliations report their drift.
+ */
+int main() {
+	long long int nTerminals = 200;
+	int nFailed = 0;
+
+	StagedFRROTreeGenerator *fullGenerator = createBoxGenerator(nTerminals, 11);
+	generateSilently(fullGenerator, nTerminals);
+
+	StagedFRROTreeGenerator *periodicGenerator = createBoxGenerator(nTerminals, 11);
+	SingleVesselCCOOTree *periodicTree = (SingleVesselCCOOTree *) periodicGenerator->getTree();
+	periodicTree->setIsIncrementalUpdate(1);
+	periodicTree->setReconciliationInterval(10);
+	periodicTree->setReconciliationTolerance(INFINITY);
+	generateSilently(periodicGenerator, nTerminals);
+	double difference = getMaxRadiusDifference(periodicTree, fullGenerator->getTree());
+	cout << "Maximum relative radius difference with a full update every 10 insertions: " << difference << endl;
+	nFailed += check(difference < 1e-4, "periodic full updates match the full update");
+	nFailed += check(periodicTree->getAccumulatedDrift() > 0.0, "periodic full updates report their drift");
+
+	StagedFRROTreeGenerator *boundedGenerator = createBoxGenerator(nTerminals, 11);
+	SingleVesselCCOOTree *boundedTree = (SingleVesselCCOOTree *) boundedGenerator->getTree();
+	boundedTree->setIsIncrementalUpdate(1);
+	boundedTree->setReconciliationTolerance(0.1);
+	generateSilently(boundedGenerator, nTerminals);
+	difference = getMaxRadiusDifference(boundedTree, fullGenerator->getTree());
+	cout << "Maximum relative radius difference with an error bound of 0.1: " << difference << endl;
+	nFailed += check(difference < 1e-4, "full updates by error bound match the full update");
+
+	return nFailed;
+}
@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * SegmentIndexTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include "TestTrees.h"
+#include "../structures/tree/SegmentAABBTree.h"
+
+/**
+ * Returns if the bounding box of the segment @p a - @p b intersects @p bounds.
+ */
+int isSegmentBoxWithin(point a, point b, double *bounds) {
+	for (int i = 0; i < 3; ++i) {
+		if (min(a.p[i], b.p[i]) > bounds[2 * i + 1] || max(a.p[i], b.p[i]) < bounds[2 * i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Returns the squared distance between @p p and the segment @p a - @p b.
+ */
+double getSegmentDistance2(point a, point b, point p) {
+	point ab = b - a;
+	point ap = p - a;
+	double t = (ab ^ ab) > 0.0 ? max(0.0, min(1.0, (ap ^ ab) / (ab ^ ab))) : 0.0;
+	point closest = a + ab * t;
+	point d = p - closest;
+	return d ^ d;
+}
+
+/**
+ * Compares the box and closest segment queries of a SegmentAABBTree with a brute force search over its segments,
+ * after random insertions, updates and removals.
+ * @return	Amount of failed checks.
+ */
+int checkIndex(mt19937 &generator) {
+	uniform_real_distribution<double> coordinate(-10.0, 10.0);
+	uniform_real_distribution<double> offset(-1.0, 1.0);
+	auto randomPoint = [&]() {
+		point p = {coordinate(generator), coordinate(generator), coordinate(generator)};
+		return p;
+	};
+	auto randomSegment = [&](point *a, point *b) {
+		*a = randomPoint();
+		point d = {offset(generator), offset(generator), offset(generator)};
+		*b = *a + d;
+	};
+
+	SegmentAABBTree index;
+	map<long long, pair<point, point> > segments;
+	for (long long id = 0; id < 1000; ++id) {
+		point a, b;
+		randomSegment(&a, &b);
+		index.insert(id, a, b);
+		segments[id] = make_pair(a, b);
+	}
+	for (long long id = 0; id < 1000; id += 3) {
+		point a, b;
+		randomSegment(&a, &b);
+		index.update(id, a, b);
+		segments[id] = make_pair(a, b);
+	}
+	for (long long id = 1; id < 1000; id += 7) {
+		index.remove(id);
+		segments.erase(id);
+	}
+
+	int nFailed = check(index.size() == (long long) segments.size(), "index size matches the segments");
+
+	int nMismatches = 0;
+	for (int i = 0; i < 500; ++i) {
+		point center = randomPoint();
+		double halfSide = 2.0 * fabs(offset(generator));
+		double bounds[6] = {center.p[0] - halfSide, center.p[0] + halfSide, center.p[1] - halfSide, center.p[1] + halfSide,
+				center.p[2] - halfSide, center.p[2] + halfSide};
+		vector<long long> ids, expectedIds;
+		index.findWithinBounds(bounds, &ids);
+		for (map<long long, pair<point, point> >::iterator it = segments.begin(); it != segments.end(); ++it) {
+			if (isSegmentBoxWithin(it->second.first, it->second.second, bounds)) {
+				expectedIds.push_back(it->first);
+			}
+		}
+		if (ids != expectedIds) {
+			++nMismatches;
+		}
+	}
+	nFailed += check(nMismatches == 0, "box queries match the brute force search");
+
+	nMismatches = 0;
+	for (int i = 0; i < 500; ++i) {
+		point p = randomPoint();
+		point closest;
+		long long id;
+		double dist2;
+		index.findClosest(p, &closest, &id, &dist2);
+		long long expectedId = -1;
+		double expectedDist2 = INFINITY;
+		for (map<long long, pair<point, point> >::iterator it = segments.begin(); it != segments.end(); ++it) {
+			double candidateDist2 = getSegmentDistance2(it->second.first, it->second.second, p);
+			if (candidateDist2 < expectedDist2) {
+				expectedDist2 = candidateDist2;
+				expectedId = it->first;
+			}
+		}
+		if (id != expectedId || fabs(dist2 - expectedDist2) > 1e-12 * max(1.0, expectedDist2)) {
+			++nMismatches;
+		}
+	}
+	nFailed += check(nMismatches == 0, "closest segment queries match the brute force search");
+
+	return nFailed;
+}
+
+/**
+ * Compares the neighborhood and closest point queries of a grown tree with a brute force search over its vessels.
+ * @return	Amount of failed checks.
+ */
+int checkTree(mt19937 &generator) {
+	long long int nTerminals = 200;
+	StagedFRROTreeGenerator *treeGenerator = createBoxGenerator(nTerminals, 5);
+	generateSilently(treeGenerator, nTerminals);
+	SingleVesselCCOOTree *tree = (SingleVesselCCOOTree *) treeGenerator->getTree();
+	AbstractDomain *domain = treeGenerator->getDomain();
+	vector<SingleVessel *> vessels = getTestVessels(tree);
+
+	uniform_real_distribution<double> coordinate(-5.0, 5.0);
+	int nNeighborMismatches = 0;
+	int nClosestMismatches = 0;
+	for (int i = 0; i < 200; ++i) {
+		point xNew = {coordinate(generator), coordinate(generator), coordinate(generator)};
+
+		int nFound;
+		vector<AbstractVascularElement *> neighbors = tree->getCloseSegments(xNew, domain, &nFound);
+		double *bounds = tree->getCloseNeighborhood(xNew, domain);
+		vector<AbstractVascularElement *> expectedNeighbors;
+		for (unsigned int j = 0; j < vessels.size(); ++j) {
+			if (isSegmentBoxWithin(vessels[j]->xProx, vessels[j]->xDist, bounds) && domain->isValidElement(vessels[j])
+					&& vessels[j]->branchingMode != AbstractVascularElement::NO_BRANCHING) {
+				expectedNeighbors.push_back(vessels[j]);
+			}
+		}
+		delete[] bounds;
+		sort(neighbors.begin(), neighbors.end());
+		sort(expectedNeighbors.begin(), expectedNeighbors.end());
+		if (neighbors != expectedNeighbors || nFound != (int) expectedNeighbors.size()) {
+			++nNeighborMismatches;
+		}
+
+		point xBif;
+		double dist;
+		tree->getClosestTreePoint(xNew, &xBif, &dist);
+		double expectedDist2 = INFINITY;
+		for (unsigned int j = 0; j < vessels.size(); ++j) {
+			expectedDist2 = min(expectedDist2, getSegmentDistance2(vessels[j]->xProx, vessels[j]->xDist, xNew));
+		}
+		if (fabs(dist - sqrt(expectedDist2)) > 1e-12) {
+			++nClosestMismatches;
+		}
+	}
+
+	int nFailed = check(nNeighborMismatches == 0, "close segments of the tree match the brute force search");
+	nFailed += check(nClosestMismatches == 0, "closest tree point matches the brute force search");
+	return nFailed;
+}
+
+/**
+ * Checks the segment index used for the neighborhood and closest point queries against brute force searches.
+ */
+int main() {
+	mt19937 generator(13);
+	int nFailed = checkIndex(generator);
+	nFailed += checkTree(generator);
+	return nFailed;
+}
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * TestTrees.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#ifndef TEST_TESTTREES_H_
+#define TEST_TESTTREES_H_
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "BoxDomain.h"
+#include "../constrains/ConstantConstraintFunction.h"
+#include "../core/GeneratorData.h"
+#include "../core/StagedFRROTreeGenerator.h"
+#include "../structures/domain/StagedDomain.h"
+#include "../structures/tree/SingleVesselCCOOTree.h"
+#include "../structures/tree/TreeTraversal.h"
+#include "../structures/vascularElements/SingleVessel.h"
+
+using namespace std;
+
+/**
+ * Murray's law, symmetry and viscosity functions of every stage of the test trees.
+ */
+inline vector<AbstractConstraintFunction<double, int> *> getTestConstraints(double value, int nStages) {
+	return vector<AbstractConstraintFunction<double, int> *>(nStages, new ConstantConstraintFunction<double, int>(value));
+}
+
+/**
+ * Generator parameters of the test trees.
+ */
+inline GeneratorData *createTestGeneratorData() {
+	return new GeneratorData(16000, 2000, 0.9, 1.0, 1.0, 0.25, 7);
+}
+
+/**
+ * Creates a generator of a tree rooted at the bottom of a single-stage BoxDomain of half side 5.
+ * @param nTerminals	Amount of terminals of the tree.
+ * @param seed	Seed of the domain.
+ * @param instanceData	Generator parameters.
+ * @return	Generator.
+ */
+inline StagedFRROTreeGenerator *createBoxGenerator(long long int nTerminals, int seed, GeneratorData *instanceData) {
+	StagedDomain *domain = new StagedDomain();
+	domain->addStage(nTerminals, new BoxDomain(instanceData, 5.0, seed));
+	point xi = {0.0, 0.0, -5.0};
+	StagedFRROTreeGenerator *generator = new StagedFRROTreeGenerator(domain, xi, 0.5, 8.0, nTerminals, getTestConstraints(3.0, 1),
+			getTestConstraints(0.0, 1), getTestConstraints(3.6, 1), 0.0, 1e-6);
+	generator->getTree()->setIsLazyVtk(1);
+	return generator;
+}
+
+/**
+ * Creates a generator of a tree rooted at the bottom of a single-stage BoxDomain of half side 5 with the test
+ * parameters.
+ * @param nTerminals	Amount of terminals of the tree.
+ * @param seed	Seed of the domain.
+ * @return	Generator.
+ */
+inline StagedFRROTreeGenerator *createBoxGenerator(long long int nTerminals, int seed) {
+	return createBoxGenerator(nTerminals, seed, createTestGeneratorData());
+}
+
+/**
+ * Generates the tree of @p generator without writing its progress to the standard output.
+ * @param generator	Generator.
+ * @param saveInterval	Terminals between save points.
+ */
+inline void generateSilently(StagedFRROTreeGenerator *generator, long long int saveInterval) {
+	cout.setstate(ios::failbit);
+	generator->generate(saveInterval, ".");
+	cout.clear();
+}
+
+/**
+ * Returns the vessels of @p tree in pre-order.
+ */
+inline vector<SingleVessel *> getTestVessels(AbstractObjectCCOTree *tree) {
+	vector<SingleVessel *> vessels;
+	TreeTraversal::preOrder(tree->getRoot(), [&vessels](AbstractVascularElement *vessel) {
+		vessels.push_back((SingleVessel *) vessel);
+	});
+	return vessels;
+}
+
+/**
+ * Returns the maximum relative difference between the radii of the vessels of two trees with the same geometry.
+ * @return	Maximum relative difference, INFINITY if the trees have different vessels.
+ */
+inline double getMaxRadiusDifference(AbstractObjectCCOTree *tree, AbstractObjectCCOTree *otherTree) {
+	vector<SingleVessel *> vessels = getTestVessels(tree);
+	vector<SingleVessel *> otherVessels = getTestVessels(otherTree);
+	if (vessels.size() != otherVessels.size()) {
+		return INFINITY;
+	}
+	double maxDifference = 0.0;
+	for (unsigned int i = 0; i < vessels.size(); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (vessels[i]->xProx.p[j] != otherVessels[i]->xProx.p[j] || vessels[i]->xDist.p[j] != otherVessels[i]->xDist.p[j]) {
+				return INFINITY;
+			}
+		}
+		maxDifference = max(maxDifference, fabs(vessels[i]->radius - otherVessels[i]->radius) / otherVessels[i]->radius);
+	}
+	return maxDifference;
+}
+
+/**
+ * Prints the result of a check and returns 1 if it failed.
+ */
+inline int check(bool isPassed, string description) {
+	cout << (isPassed ? "PASSED: " : "FAILED: ") << description << endl;
+	return isPassed ? 0 : 1;
+}
+
+#endif /* TEST_TESTTREES_H_ */
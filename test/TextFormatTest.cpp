@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * TextFormatTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include "TestTrees.h"
+
+/**
+ * Returns the bytes of the file @p filename.
+ */
+vector<char> readBytes(string filename) {
+	ifstream file(filename.c_str(), ios::in | ios::binary);
+	return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+/**
+ * Checks that the buffered .cco writer of SingleVesselCCOOTree writes the same bytes as the stream writer of
+ * AbstractObjectCCOTree, for a tree with more vessels than a formatting block.
+ */
+int main() {
+	long long int nTerminals = 2100;
+	int nFailed = 0;
+
+	StagedFRROTreeGenerator *generator = createBoxGenerator(nTerminals, 19);
+	SingleVesselCCOOTree *tree = (SingleVesselCCOOTree *) generator->getTree();
+	tree->setIsIncrementalUpdate(1);
+	tree->setIsCopyFreeEvaluation(1);
+	generateSilently(generator, nTerminals);
+
+	nFailed += check(tree->save("textFormatTest.cco") && tree->AbstractObjectCCOTree::save("textFormatTestBaseline.cco"),
+			"tree is saved by both writers");
+	vector<char> bytes = readBytes("textFormatTest.cco");
+	vector<char> baselineBytes = readBytes("textFormatTestBaseline.cco");
+	remove("textFormatTest.cco");
+	remove("textFormatTestBaseline.cco");
+	cout << "Saved " << tree->getSegments().size() << " vessels in " << bytes.size() << " bytes" << endl;
+	nFailed += check(!bytes.empty() && bytes == baselineBytes, "buffered writer output is identical to the stream writer output");
+
+	return nFailed;
+}
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+/* Copyright 2020 Gonzalo Maso Talou */
+/*
+ * ThreadIndependenceTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Gonzalo D. Maso Talou
+ */
+
+#include <omp.h>
+
+#include "TestTrees.h"
+
+/**
+ * Grows a tree with @p nThreads OpenMP threads. With @p mode 1, the copy-free and scratch evaluations, the
+ * incremental update, parallel sweeps, speculative draws and candidate pruning are enabled; with @p mode 2, the
+ * terminals are added in batches.
+ */
+StagedFRROTreeGenerator *generateWithThreads(long long int nTerminals, int nThreads, int mode) {
+	omp_set_num_threads(nThreads);
+	StagedFRROTreeGenerator *generator = createBoxGenerator(nTerminals, 23);
+	if (mode == 1) {
+		SingleVesselCCOOTree *tree = (SingleVesselCCOOTree *) generator->getTree();
+		tree->setIsCopyFreeEvaluation(1);
+		tree->setIsScratchEvaluation(1);
+		tree->setIsIncrementalUpdate(1);
+		tree->setParallelSweepCutoff(20);
+		generator->setSpeculativeDraws(4);
+		generator->setIsCandidatePruning(1);
+	} else if (mode == 2) {
+		generator->setBatchSize(8);
+	}
+	generateSilently(generator, nTerminals);
+	return generator;
+}
+
+/**
+ * Checks that the generated tree does not depend on the amount of OpenMP threads, with the default settings,
+ * with the parallel evaluation and update options and with batches.
+ */
+int main() {
+	long long int nTerminals = 200;
+	int nFailed = 0;
+
+	vector<string> names = {"default settings", "parallel options", "batches"};
+	for (int i = 0; i < 3; ++i) {
+		StagedFRROTreeGenerator *serialGenerator = generateWithThreads(nTerminals, 1, i);
+		StagedFRROTreeGenerator *parallelGenerator = generateWithThreads(nTerminals, 4, i);
+		double difference = getMaxRadiusDifference(parallelGenerator->getTree(), serialGenerator->getTree());
+		nFailed += check(difference == 0.0, "1 and 4 threads give the same tree with " + names[i]);
+		nFailed += check(parallelGenerator->getDomain()->getPointCounter() == serialGenerator->getDomain()->getPointCounter(),
+				"1 and 4 threads draw the same points with " + names[i]);
+	}
+
+	return nFailed;
+}